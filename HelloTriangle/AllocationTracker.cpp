@@ -0,0 +1,180 @@
+#include "HelloTriangleApplication.h"
+
+#include <new>
+
+/*
+* Allocation tracking
+*   A frame of the render loop should not touch the heap once the renderer has warmed up: everything it needs is created up front
+*   and reused, so the frame time never depends on the state of the allocator. Two hooks count what is allocated anyway:
+*       - the global operator new and operator delete, which every standard container and string goes through
+*       - VkAllocationCallbacks given to the instance and the device with --check-allocations, which the driver uses for the host
+*         memory of commands such as vkQueueSubmit and vkQueuePresentKHR
+*   Counts are kept per thread, so the shader workers compiling in the background do not show up in the frames of the render loop.
+*   Every frame adds what it allocated to the metrics. With --check-allocations, each frame after the warmup which allocated is
+*   printed and the run fails once it is over, e.g. together with --frames or --replay as an automated check. A frame which
+*   recreates the swapchain or swaps in a rebuilt pipeline is expected to allocate and is left out.
+*   malloc itself is not hooked, there is no portable way to: the C libraries the frame calls into are not counted.
+*/
+
+//frames until the renderer is in its steady state, the same as for the object tracker
+const uint64_t ALLOCATION_WARMUP_FRAMES = 100;
+//frames which allocated that are printed one by one, the rest only show up in the summary
+const uint64_t MAX_REPORTED_ALLOCATION_FRAMES = 10;
+
+//of the calling thread, plain integers so that reading them never allocates or locks
+static thread_local uint64_t threadHeapAllocations = 0;
+static thread_local uint64_t threadAllocatedBytes = 0;
+
+static void countAllocation(size_t size) {
+    threadHeapAllocations++;
+    threadAllocatedBytes += size;
+}
+
+/* Global Operators */
+//the array, nothrow and sized forms of the standard library call these, replacing them counts every form
+void* operator new(size_t size) {
+    countAllocation(size);
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    countAllocation(size);
+    size_t bytes = size > 0 ? size : 1;
+#ifdef _WIN32
+    void* memory = _aligned_malloc(bytes, static_cast<size_t>(alignment));
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, std::max(static_cast<size_t>(alignment), sizeof(void*)), bytes) != 0) {
+        memory = nullptr;
+    }
+#endif
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+/* Vulkan Host Allocations */
+//stored in front of every block handed to the driver: a reallocation has to know how much to copy, and a free where the block starts
+struct HostAllocationHeader {
+    void* block;
+    size_t size;
+};
+
+static void* VKAPI_PTR allocateHostMemory(void*, size_t size, size_t alignment, VkSystemAllocationScope) {
+    countAllocation(size);
+
+    alignment = std::max(alignment, alignof(HostAllocationHeader));
+    char* block = static_cast<char*>(std::malloc(size + alignment + sizeof(HostAllocationHeader)));
+    if (block == nullptr) {
+        return nullptr;
+    }
+
+    uintptr_t address = (reinterpret_cast<uintptr_t>(block) + sizeof(HostAllocationHeader) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    HostAllocationHeader* header = reinterpret_cast<HostAllocationHeader*>(address) - 1;
+    header->block = block;
+    header->size = size;
+    return reinterpret_cast<void*>(address);
+}
+
+static void VKAPI_PTR freeHostMemory(void*, void* memory) {
+    if (memory != nullptr) {
+        std::free((static_cast<HostAllocationHeader*>(memory) - 1)->block);
+    }
+}
+
+static void* VKAPI_PTR reallocateHostMemory(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (original == nullptr) {
+        return allocateHostMemory(userData, size, alignment, scope);
+    }
+    if (size == 0) {
+        freeHostMemory(userData, original);
+        return nullptr;
+    }
+
+    //the original is left alone when the new block can not be allocated, as the driver expects
+    void* memory = allocateHostMemory(userData, size, alignment, scope);
+    if (memory != nullptr) {
+        memcpy(memory, original, std::min(size, (static_cast<HostAllocationHeader*>(original) - 1)->size));
+        freeHostMemory(userData, original);
+    }
+    return memory;
+}
+
+//memory the driver allocated itself, e.g. for executable code, and only tells about
+static void VKAPI_PTR notifyInternalAllocation(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope) {
+    countAllocation(size);
+}
+
+static void VKAPI_PTR notifyInternalFree(void*, size_t, VkInternalAllocationType, VkSystemAllocationScope) {
+}
+
+static const VkAllocationCallbacks countingAllocationCallbacks = {
+    nullptr,
+    allocateHostMemory,
+    reallocateHostMemory,
+    freeHostMemory,
+    notifyInternalAllocation,
+    notifyInternalFree
+};
+
+const VkAllocationCallbacks* HelloTriangleApplication::hostAllocator() const {
+    return options.checkAllocations ? &countingAllocationCallbacks : nullptr;
+}
+
+void HelloTriangleApplication::beginAllocationFrame() {
+    allocationsExpected = false;
+    frameAllocationsStart = threadHeapAllocations;
+    frameAllocatedBytesStart = threadAllocatedBytes;
+}
+
+void HelloTriangleApplication::endAllocationFrame() {
+    uint64_t allocations = threadHeapAllocations - frameAllocationsStart;
+    uint64_t bytes = threadAllocatedBytes - frameAllocatedBytesStart;
+
+    frameHeapAllocations = allocations;
+    heapAllocationsMetric->increment(static_cast<double>(allocations));
+    frameHeapAllocationsMetric->set(static_cast<double>(allocations));
+
+    if (!options.checkAllocations || frameNumber < ALLOCATION_WARMUP_FRAMES || allocationsExpected || allocations == 0) {
+        return;
+    }
+
+    steadyStateAllocations += allocations;
+    if (steadyStateAllocationFrames++ < MAX_REPORTED_ALLOCATION_FRAMES) {
+        std::cout << "frame " << frameNumber << " made " << allocations << " heap allocations (" << bytes << " bytes) in a steady-state frame" << std::endl;
+    }
+}
+
+void HelloTriangleApplication::checkSteadyStateAllocations() {
+    if (!options.checkAllocations) {
+        return;
+    }
+
+    uint64_t checkedFrames = (frameNumber > ALLOCATION_WARMUP_FRAMES) ? frameNumber - ALLOCATION_WARMUP_FRAMES : 0;
+    std::cout << "steady-state frames checked: " << checkedFrames << " | with heap allocations: " << steadyStateAllocationFrames
+        << " | allocations: " << steadyStateAllocations << std::endl;
+
+    if (checkedFrames == 0) {
+        throw std::runtime_error("allocation check ran no frames after the warmup of " + std::to_string(ALLOCATION_WARMUP_FRAMES));
+    }
+    if (steadyStateAllocationFrames > 0) {
+        throw std::runtime_error("allocation check failed: " + std::to_string(steadyStateAllocationFrames) + " steady-state frames allocated on the heap");
+    }
+}
@@ -0,0 +1,622 @@
+#include "HelloTriangleApplication.h"
+
+#include <filesystem>
+#include <cmath>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/*
+* Batch views
+*   For thumbnails and camera renders by the thousand, --batch-views N renders N small views of the scene per batch, offscreen, instead of
+*   running the main loop. Going through drawFrame for each of them would cost a submit, a fence and a present per view; here a batch
+*   is one command buffer and one submit whatever N is:
+*       - the target is a single layered image, each layer a grid of BATCH_GRID x BATCH_GRID views
+*       - every view is a viewport of a viewport array, the vertex shader picks its camera, viewport and layer from the instance index
+*         (VK_EXT_shader_viewport_index_layer), so each object is one instanced draw for all views of the batch
+*       - a single copy with a region per view packs the views one after the other into the readback buffer of the batch
+*   Readback goes through a ring of BATCH_READBACK_SLOTS slots: the CPU reads the views of a batch once its fence has signaled, while
+*   the batches after it are already queued. The GPU is never left waiting on the CPU, which keeps the throughput at what the GPU fills.
+*   The views are lit by a fixed sun only, there are no shadows, point lights or post processing.
+*/
+
+//views per side of a layer, a layer is as many views as the viewport array of every device with multiViewport holds
+const uint32_t BATCH_GRID = 4;
+const uint32_t BATCH_VIEWS_PER_LAYER = BATCH_GRID * BATCH_GRID;
+//batches queued at once, the CPU reads the oldest while the GPU renders the others
+const uint32_t BATCH_READBACK_SLOTS = 3;
+const VkFormat BATCH_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+void HelloTriangleApplication::checkBatchViewSupport(VkPhysicalDeviceFeatures& features, std::vector<const char*>& extensions) {
+    if (options.batchViews == 0) {
+        return;
+    }
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    if (!supportedFeatures.multiViewport) {
+        throw std::runtime_error("batch views need multiViewport, which the device does not support");
+    }
+    if (!isDeviceExtensionAvailable(VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME)) {
+        throw std::runtime_error("batch views need VK_EXT_shader_viewport_index_layer, which the device does not support");
+    }
+
+    features.multiViewport = VK_TRUE;
+    extensions.push_back(VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME);
+}
+
+void HelloTriangleApplication::createBatchViews() {
+    if (options.batchViews == 0) {
+        return;
+    }
+
+    uint32_t viewSize = options.batchViewSize;
+    uint32_t layerSize = BATCH_GRID * viewSize;
+    batchLayers = (options.batchViews + BATCH_VIEWS_PER_LAYER - 1) / BATCH_VIEWS_PER_LAYER;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+    if (layerSize > limits.maxImageDimension2D || layerSize > limits.maxFramebufferWidth || layerSize > limits.maxFramebufferHeight) {
+        throw std::runtime_error("batch view size is too large, a layer of " + std::to_string(layerSize) + " pixels does not fit the device");
+    }
+    if (batchLayers > limits.maxImageArrayLayers || batchLayers > limits.maxFramebufferLayers) {
+        throw std::runtime_error("too many batch views, " + std::to_string(batchLayers) + " layers do not fit the device");
+    }
+
+    /* Target */
+    //cleared and written by the pass, then copied out -- the depth is never stored
+    batchColor.format = BATCH_FORMAT;
+    createImage(layerSize, layerSize, 1, batchColor.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, batchColor.image, batchColor.memory, {}, batchLayers);
+    batchColor.view = createImageView(batchColor.image, batchColor.format, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY, batchLayers);
+
+    batchDepth.format = findDepthFormat();
+    createImage(layerSize, layerSize, 1, batchDepth.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, batchDepth.image, batchDepth.memory, {}, batchLayers);
+    batchDepth.view = createImageView(batchDepth.image, batchDepth.format, VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY, batchLayers);
+
+    /* Render Pass */
+    std::array<VkAttachmentDescription, 2> attachments{};
+    attachments[0].format = batchColor.format;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    attachments[1].format = batchDepth.format;
+    attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference depthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    std::array<VkSubpassDependency, 2> dependencies{};
+
+    //the batch before this one may still be copying out of the target, or testing against the depth
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    //the copy into the readback buffer waits for the views to be written
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &batchRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch render pass");
+    }
+    trackObject(VK_OBJECT_TYPE_RENDER_PASS, batchRenderPass, "batchRenderPass");
+
+    //layered: the layer each primitive goes to is picked by the vertex shader
+    std::array<VkImageView, 2> framebufferAttachments = { batchColor.view, batchDepth.view };
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = batchRenderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(framebufferAttachments.size());
+    framebufferInfo.pAttachments = framebufferAttachments.data();
+    framebufferInfo.width = layerSize;
+    framebufferInfo.height = layerSize;
+    framebufferInfo.layers = batchLayers;
+
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &batchFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch framebuffer");
+    }
+    trackObject(VK_OBJECT_TYPE_FRAMEBUFFER, batchFramebuffer, "batchFramebuffer");
+
+    /* Descriptor Set Layout */
+    //0. cameras of the batch
+    VkDescriptorSetLayoutBinding cameraBinding{};
+    cameraBinding.binding = 0;
+    cameraBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    cameraBinding.descriptorCount = 1;
+    cameraBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &cameraBinding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &batchSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch descriptor set layout");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, batchSetLayout, "batchSetLayout");
+
+    /* Pipeline */
+    //the objects are drawn with the same push constants as in the scene passes
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &batchSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &batchPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, batchPipelineLayout, "batchPipelineLayout");
+
+    shaderVariants["batchView"] = { "batchView.vert", "batchView.spv", VK_SHADER_STAGE_VERTEX_BIT, { { 0, BATCH_GRID } } };
+    shaderVariants["batchShade"] = { "batchView.frag", "batchShade.spv", VK_SHADER_STAGE_FRAGMENT_BIT, {} };
+    createReloadablePipeline(batchPipeline, { "batchView", "batchShade" }, [this]() { return buildBatchPipeline(); });
+
+    /* Viewports and Copies */
+    //view i is tile i % BATCH_VIEWS_PER_LAYER of layer i / BATCH_VIEWS_PER_LAYER, in rows
+    batchViewports.resize(BATCH_VIEWS_PER_LAYER);
+    batchScissors.resize(BATCH_VIEWS_PER_LAYER);
+    for (uint32_t tile = 0; tile < BATCH_VIEWS_PER_LAYER; tile++) {
+        int32_t x = static_cast<int32_t>((tile % BATCH_GRID) * viewSize);
+        int32_t y = static_cast<int32_t>((tile / BATCH_GRID) * viewSize);
+        batchViewports[tile] = { (float)x, (float)y, (float)viewSize, (float)viewSize, 0.0f, 1.0f };
+        batchScissors[tile] = { { x, y }, { viewSize, viewSize } };
+    }
+
+    VkDeviceSize viewBytes = static_cast<VkDeviceSize>(viewSize) * viewSize * 4;
+    batchCopyRegions.resize(options.batchViews);
+    for (uint32_t view = 0; view < options.batchViews; view++) {
+        uint32_t tile = view % BATCH_VIEWS_PER_LAYER;
+        VkBufferImageCopy& region = batchCopyRegions[view];
+        region = {};
+        region.bufferOffset = view * viewBytes;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, view / BATCH_VIEWS_PER_LAYER, 1 };
+        region.imageOffset = { batchScissors[tile].offset.x, batchScissors[tile].offset.y, 0 };
+        region.imageExtent = { viewSize, viewSize, 1 };
+    }
+
+    /* Readback Ring */
+    //the CPU reads every byte of the readback
+    VkMemoryPropertyFlags readbackProperties = findReadbackMemoryProperties();
+
+    VkDeviceSize cameraBytes = sizeof(glm::mat4) * options.batchViews;
+    VkDeviceSize readbackBytes = viewBytes * options.batchViews;
+
+    VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BATCH_READBACK_SLOTS };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = BATCH_READBACK_SLOTS;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &batchDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch descriptor pool");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, batchDescriptorPool, "batchDescriptorPool");
+
+    batchSlots.resize(BATCH_READBACK_SLOTS);
+    for (auto& slot : batchSlots) {
+        createBuffer(cameraBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            slot.cameraBuffer, slot.cameraMemory);
+        vkMapMemory(device, slot.cameraMemory, 0, cameraBytes, 0, &slot.cameraMapped);
+
+        createBuffer(readbackBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readbackProperties, slot.readbackBuffer, slot.readbackMemory);
+        vkMapMemory(device, slot.readbackMemory, 0, readbackBytes, 0, &slot.readbackMapped);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = graphicsCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate batch command buffer");
+        }
+        trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, slot.commandBuffer, "batchSlots");
+
+        //unsignaled, a slot is only waited on once it has been submitted
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create batch fence");
+        }
+        trackObject(VK_OBJECT_TYPE_FENCE, slot.fence, "batchSlots");
+
+        VkDescriptorSetAllocateInfo setInfo{};
+        setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setInfo.descriptorPool = batchDescriptorPool;
+        setInfo.descriptorSetCount = 1;
+        setInfo.pSetLayouts = &batchSetLayout;
+
+        if (vkAllocateDescriptorSets(device, &setInfo, &slot.descriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate batch descriptor set");
+        }
+
+        VkDescriptorBufferInfo bufferInfo{ slot.cameraBuffer, 0, cameraBytes };
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = slot.descriptorSet;
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrite.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+void HelloTriangleApplication::destroyBatchViews() {
+    if (options.batchViews == 0) {
+        return;
+    }
+
+    for (auto& slot : batchSlots) {
+        untrackObject(VK_OBJECT_TYPE_FENCE, slot.fence);
+        vkDestroyFence(device, slot.fence, nullptr);
+        untrackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, slot.commandBuffer);
+        vkFreeCommandBuffers(device, graphicsCommandPool, 1, &slot.commandBuffer);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, slot.cameraBuffer);
+        vkDestroyBuffer(device, slot.cameraBuffer, nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, slot.cameraMemory);
+        vkFreeMemory(device, slot.cameraMemory, nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, slot.readbackBuffer);
+        vkDestroyBuffer(device, slot.readbackBuffer, nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, slot.readbackMemory);
+        vkFreeMemory(device, slot.readbackMemory, nullptr);
+    }
+    batchSlots.clear();
+
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, batchDescriptorPool);
+    vkDestroyDescriptorPool(device, batchDescriptorPool, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, batchPipeline);
+    vkDestroyPipeline(device, batchPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, batchPipelineLayout);
+    vkDestroyPipelineLayout(device, batchPipelineLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, batchSetLayout);
+    vkDestroyDescriptorSetLayout(device, batchSetLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_FRAMEBUFFER, batchFramebuffer);
+    vkDestroyFramebuffer(device, batchFramebuffer, nullptr);
+    destroyPipelineLibraries(batchRenderPass);
+    untrackObject(VK_OBJECT_TYPE_RENDER_PASS, batchRenderPass);
+    vkDestroyRenderPass(device, batchRenderPass, nullptr);
+    destroyAttachment(batchColor);
+    destroyAttachment(batchDepth);
+}
+
+VkPipeline HelloTriangleApplication::buildBatchPipeline() {
+    std::array<ShaderStage, 2> stages;
+    createShaderStage("batchView", stages[0]);
+    createShaderStage("batchShade", stages[1]);
+    VkPipelineShaderStageCreateInfo shaderStages[] = { stages[0].createInfo, stages[1].createInfo };
+
+    //both streams: the views are shaded
+    auto bindingDescriptions = Vertex::getBindingDescriptions();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    //a viewport and a scissor per view of a layer, set when recording
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = BATCH_VIEWS_PER_LAYER;
+    viewportState.scissorCount = BATCH_VIEWS_PER_LAYER;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    //no prepass here, the views are tested and written in the same pass
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateInfo.dynamicStateCount = 2;
+    dynamicStateInfo.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
+    pipelineInfo.layout = batchPipelineLayout;
+    pipelineInfo.renderPass = batchRenderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipeline pipeline;
+    if (linkGraphicsPipeline(pipelineInfo, stages.data(), &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create batch pipeline");
+    }
+
+    for (auto& stage : stages) {
+        destroyShaderStage(stage);
+    }
+
+    return pipeline;
+}
+
+void HelloTriangleApplication::runBatchViews() {
+    if (!options.batchDirectory.empty()) {
+        std::filesystem::create_directories(options.batchDirectory);
+    }
+
+    uint64_t viewsRead = 0;
+    uint64_t secondViews = 0;
+    auto start = Clock::now();
+    auto secondStart = start;
+
+    //reads the oldest batch back once it is done, which frees its slot for the next one
+    auto finishSlot = [&](BatchSlot& slot) {
+        {
+            TraceZone zone(*this, "wait for batch fence");
+            vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+        vkResetFences(device, 1, &slot.fence);
+        readBatch(slot);
+        slot.pending = false;
+        viewsRead += options.batchViews;
+        secondViews += options.batchViews;
+    };
+
+    for (uint64_t batch = 0; batch < options.batchCount && !glfwWindowShouldClose(window); batch++) {
+        glfwPollEvents();
+        BatchSlot& slot = batchSlots[batch % batchSlots.size()];
+        if (slot.pending) {
+            finishSlot(slot);
+        }
+
+        slot.batch = batch;
+        updateBatchCameras(slot);
+        {
+            TraceZone zone(*this, "record batch");
+            recordBatch(slot);
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+        {
+            TraceZone zone(*this, "batch submit");
+            if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, slot.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit batch command buffer");
+            }
+            graphicsSubmitsMetric->increment();
+        }
+        slot.pending = true;
+
+        auto duration = std::chrono::duration<double>(Clock::now() - secondStart).count();
+        if (duration >= 1.0) {
+            std::cout << "Batches: " << batch + 1 << " | Views/s: " << static_cast<uint64_t>(secondViews / duration) << std::endl;
+            secondViews = 0;
+            secondStart = Clock::now();
+        }
+    }
+
+    //the batches still in the ring, oldest first
+    for (size_t i = 0; i < batchSlots.size(); i++) {
+        uint64_t oldest = UINT64_MAX;
+        BatchSlot* next = nullptr;
+        for (auto& slot : batchSlots) {
+            if (slot.pending && slot.batch < oldest) {
+                oldest = slot.batch;
+                next = &slot;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+        finishSlot(*next);
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "batch views: " << viewsRead << " views of " << options.batchViewSize << "x" << options.batchViewSize
+        << " in " << seconds << " s | " << static_cast<uint64_t>(viewsRead / seconds) << " views/s | "
+        << batchBytesRead / seconds / (1024.0 * 1024.0) << " MB/s read back" << std::endl;
+}
+
+void HelloTriangleApplication::updateBatchCameras(BatchSlot& slot) {
+    //every view is square, and looks at the point the main camera looks at from as far away as it is
+    const glm::vec3 target(0.0f, -0.1f, 0.0f);
+    const float distance = 2.0f;
+    const double goldenAngle = 2.399963229728653;    //radians
+
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, CAMERA_NEAR, CAMERA_FAR);
+    proj[1][1] *= -1;
+
+    //a golden angle apart around the scene and between 10 and 60 degrees above it, so no two views of a run are the same
+    glm::mat4* viewProjections = static_cast<glm::mat4*>(slot.cameraMapped);
+    for (uint32_t view = 0; view < options.batchViews; view++) {
+        uint64_t index = slot.batch * options.batchViews + view;
+        float azimuth = static_cast<float>(std::fmod(index * goldenAngle, 6.283185307179586));
+        float elevation = glm::radians(10.0f + 50.0f * static_cast<float>(std::fmod(index * 0.6180339887, 1.0)));
+
+        glm::vec3 direction(std::cos(elevation) * std::sin(azimuth), std::sin(elevation), std::cos(elevation) * std::cos(azimuth));
+        viewProjections[view] = proj * glm::lookAt(target + direction * distance, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+void HelloTriangleApplication::recordBatch(BatchSlot& slot) {
+    VkCommandBuffer commandBuffer = slot.commandBuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording batch command buffer");
+    }
+
+    /* Views */
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = batchRenderPass;
+    renderPassInfo.framebuffer = batchFramebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = { BATCH_GRID * options.batchViewSize, BATCH_GRID * options.batchViewSize };
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batchPipeline);
+    vkCmdSetViewport(commandBuffer, 0, BATCH_VIEWS_PER_LAYER, batchViewports.data());
+    vkCmdSetScissor(commandBuffer, 0, BATCH_VIEWS_PER_LAYER, batchScissors.data());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batchPipelineLayout, 0, 1, &slot.descriptorSet, 0, nullptr);
+
+    VkBuffer vertexBuffers[] = { vertexBuffer, vertexBuffer };
+    VkDeviceSize offsets[] = { 0, vertexAttributeOffset };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+
+    //an instance per view
+    for (const auto& object : sceneObjects) {
+        DrawPushConstants pushConstants{};
+        pushConstants.model = object.model;
+        vkCmdPushConstants(commandBuffer, batchPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDraw(commandBuffer, object.vertexCount, options.batchViews, object.firstVertex, 0);
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    /* Readback */
+    vkCmdCopyImageToBuffer(commandBuffer, batchColor.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.readbackBuffer,
+        static_cast<uint32_t>(batchCopyRegions.size()), batchCopyRegions.data());
+
+    //the fence alone does not make the copy visible to the host
+    VkMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record batch command buffer");
+    }
+}
+
+void HelloTriangleApplication::readBatch(const BatchSlot& slot) {
+    TraceZone zone(*this, "read batch");
+    uint32_t viewSize = options.batchViewSize;
+    size_t viewBytes = static_cast<size_t>(viewSize) * viewSize * 4;
+    batchBytesRead += viewBytes * options.batchViews;
+
+    if (options.batchDirectory.empty()) {
+        return;
+    }
+
+    //binary PPM: RGB without the alpha, row by row
+    std::vector<char> row(viewSize * 3);
+    const unsigned char* pixels = static_cast<const unsigned char*>(slot.readbackMapped);
+    for (uint32_t view = 0; view < options.batchViews; view++) {
+        uint64_t index = slot.batch * options.batchViews + view;
+        std::filesystem::path path = std::filesystem::path(options.batchDirectory) / ("view-" + std::to_string(index) + ".ppm");
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("failed to open batch view " + path.string());
+        }
+
+        file << "P6\n" << viewSize << " " << viewSize << "\n255\n";
+        const unsigned char* viewPixels = pixels + view * viewBytes;
+        for (uint32_t y = 0; y < viewSize; y++) {
+            for (uint32_t x = 0; x < viewSize; x++) {
+                const unsigned char* pixel = viewPixels + (static_cast<size_t>(y) * viewSize + x) * 4;
+                row[x * 3 + 0] = static_cast<char>(pixel[0]);
+                row[x * 3 + 1] = static_cast<char>(pixel[1]);
+                row[x * 3 + 2] = static_cast<char>(pixel[2]);
+            }
+            file.write(row.data(), row.size());
+        }
+    }
+}
@@ -0,0 +1,294 @@
+#include "HelloTriangleApplication.h"
+
+#include <iomanip>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+* Capture and replay
+*   --capture writes the workload of a run to a binary file: the scene (vertices, objects, lights) as it was uploaded, followed by one
+*   record per frame with the scene time, the render scale and the model matrix of every dynamic object -- everything the frame's
+*   draws and uploads are derived from. --replay renders the same frames again, in a hidden window, either as fast as the device
+*   goes or with the frame starts spaced as they were recorded, and prints the frame times. Two builds replaying one capture
+*   draw exactly the same frames, which makes the comparison fair.
+*   The file is a header, the scene arrays and then the frames, in the native layout of the structs and padded to 8 bytes, so that
+*   the replayer maps it and reads everything in place without parsing or copying. A capture cut short keeps its whole frames.
+*/
+
+//"HTCP" read as a little endian uint32
+const uint32_t CAPTURE_MAGIC = 0x50435448;
+const uint32_t CAPTURE_VERSION = 1;
+const size_t CAPTURE_ALIGNMENT = 8;
+
+/// <summary>
+/// Scene object as it is stored in a capture, the model matrix of the dynamic ones is part of every frame instead
+/// </summary>
+struct CapturedObject {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t isStatic;
+    uint32_t padding;
+    glm::vec4 boundingSphere;
+};
+
+static size_t alignCapture(size_t size) {
+    return (size + CAPTURE_ALIGNMENT - 1) & ~(CAPTURE_ALIGNMENT - 1);
+}
+
+void HelloTriangleApplication::openReplay() {
+    if (options.replayFile.empty()) {
+        return;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(options.replayFile.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open capture " + options.replayFile);
+    }
+    LARGE_INTEGER fileSize{};
+    GetFileSizeEx(file, &fileSize);
+    replaySize = static_cast<size_t>(fileSize.QuadPart);
+
+    //the view keeps the mapping alive, neither handle is needed once it exists
+    HANDLE mapping = (replaySize > 0) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    replayData = (mapping != nullptr) ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int file = open(options.replayFile.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("failed to open capture " + options.replayFile);
+    }
+    struct stat fileStat{};
+    fstat(file, &fileStat);
+    replaySize = static_cast<size_t>(fileStat.st_size);
+
+    void* mapped = (replaySize > 0) ? mmap(nullptr, replaySize, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    replayData = (mapped != MAP_FAILED) ? static_cast<const char*>(mapped) : nullptr;
+    close(file);
+#endif
+
+    if (replayData == nullptr || replaySize < sizeof(CaptureHeader)) {
+        closeReplay();
+        throw std::runtime_error("failed to map capture " + options.replayFile);
+    }
+
+    const CaptureHeader* header = reinterpret_cast<const CaptureHeader*>(replayData);
+    if (header->magic != CAPTURE_MAGIC || header->version != CAPTURE_VERSION) {
+        closeReplay();
+        throw std::runtime_error("not a capture of this version: " + options.replayFile);
+    }
+    if (header->lightCount > MAX_LIGHTS || header->dynamicObjectCount > header->objectCount) {
+        closeReplay();
+        throw std::runtime_error("capture does not fit the renderer: " + options.replayFile);
+    }
+
+    replayFramesOffset = sizeof(CaptureHeader)
+        + alignCapture(sizeof(Vertex) * header->vertexCount)
+        + alignCapture(sizeof(CapturedObject) * header->objectCount)
+        + alignCapture(sizeof(PointLight) * header->lightCount);
+    replayFrameStride = sizeof(CapturedFrame) + sizeof(glm::mat4) * header->dynamicObjectCount;
+    if (replayFramesOffset > replaySize) {
+        closeReplay();
+        throw std::runtime_error("capture is cut short before its first frame: " + options.replayFile);
+    }
+    replayFrameCount = (replaySize - replayFramesOffset) / replayFrameStride;
+
+    replayHeader = header;
+}
+
+void HelloTriangleApplication::closeReplay() {
+    if (replayData == nullptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(replayData);
+#else
+    munmap(const_cast<char*>(replayData), replaySize);
+#endif
+    replayData = nullptr;
+    replayHeader = nullptr;
+    replayFrame = nullptr;
+}
+
+void HelloTriangleApplication::loadReplayScene() {
+    if (replayHeader == nullptr) {
+        return;
+    }
+
+    const char* section = replayData + sizeof(CaptureHeader);
+    const Vertex* capturedVertices = reinterpret_cast<const Vertex*>(section);
+    vertices.assign(capturedVertices, capturedVertices + replayHeader->vertexCount);
+    section += alignCapture(sizeof(Vertex) * replayHeader->vertexCount);
+
+    const CapturedObject* capturedObjects = reinterpret_cast<const CapturedObject*>(section);
+    sceneObjects.clear();
+    for (uint32_t i = 0; i < replayHeader->objectCount; i++) {
+        SceneObject object{};
+        object.firstVertex = capturedObjects[i].firstVertex;
+        object.vertexCount = capturedObjects[i].vertexCount;
+        object.isStatic = (capturedObjects[i].isStatic != 0);
+        object.boundingSphere = capturedObjects[i].boundingSphere;
+
+        if (static_cast<size_t>(object.firstVertex) + object.vertexCount > vertices.size()) {
+            throw std::runtime_error("capture draws past the end of its vertices: " + options.replayFile);
+        }
+        sceneObjects.push_back(object);
+    }
+    section += alignCapture(sizeof(CapturedObject) * replayHeader->objectCount);
+
+    const PointLight* capturedLights = reinterpret_cast<const PointLight*>(section);
+    lights.assign(capturedLights, capturedLights + replayHeader->lightCount);
+}
+
+void HelloTriangleApplication::applyReplayFrame() {
+    //the dynamic objects are stored in the order they appear in the scene
+    const glm::mat4* models = reinterpret_cast<const glm::mat4*>(replayFrame + 1);
+    uint32_t dynamicObject = 0;
+    for (auto& object : sceneObjects) {
+        if (!object.isStatic && dynamicObject < replayHeader->dynamicObjectCount) {
+            object.model = models[dynamicObject++];
+        }
+    }
+}
+
+void HelloTriangleApplication::runReplay() {
+    if (replayFrameCount == 0) {
+        throw std::runtime_error("capture holds no frames: " + options.replayFile);
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(replayFrameCount);
+    double gpuTimeSum = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    const CapturedFrame* first = reinterpret_cast<const CapturedFrame*>(replayData + replayFramesOffset);
+
+    for (size_t frame = 0; frame < replayFrameCount && !glfwWindowShouldClose(window); frame++) {
+        glfwPollEvents();
+        replayFrame = reinterpret_cast<const CapturedFrame*>(replayData + replayFramesOffset + frame * replayFrameStride);
+
+        if (options.replayTiming == ReplayTiming::Recorded) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(replayFrame->startTime - first->startTime));
+        }
+
+        drawFrame();
+
+        //the first frame has no frame time, see drawFrame
+        if (frame > 0) {
+            frameTimes.push_back(cpuFrameTime);
+            gpuTimeSum += gpuFrameTime;
+        }
+    }
+
+    vkDeviceWaitIdle(device);
+    double totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    replayFrame = nullptr;
+
+    if (frameTimes.empty()) {
+        throw std::runtime_error("window closed before the replay finished");
+    }
+
+    std::vector<float> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+    };
+    double meanTime = 0.0;
+    for (float time : frameTimes) {
+        meanTime += time;
+    }
+    meanTime /= static_cast<double>(frameTimes.size());
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "replay of " << options.replayFile << ", " << frameTimes.size() + 1 << " frames at "
+        << swapChainExtent.width << "x" << swapChainExtent.height
+        << ((options.replayTiming == ReplayTiming::Recorded) ? ", recorded timing" : ", as fast as possible") << "\n"
+        << "  total (s)         " << totalTime << "\n"
+        << "  CPU frame (ms)    mean " << meanTime << " | median " << percentile(0.5) << " | p99 " << percentile(0.99)
+        << " | max " << sorted.back() << "\n"
+        << "  GPU frame (ms)    mean " << gpuTimeSum / static_cast<double>(frameTimes.size()) << std::endl;
+}
+
+void HelloTriangleApplication::createCapture() {
+    if (options.captureFile.empty()) {
+        return;
+    }
+
+    captureStream.open(options.captureFile, std::ios::binary | std::ios::trunc);
+    if (!captureStream) {
+        throw std::runtime_error("failed to open capture file " + options.captureFile);
+    }
+
+    auto writeAligned = [this](const void* data, size_t size) {
+        const char padding[CAPTURE_ALIGNMENT] = {};
+        captureStream.write(static_cast<const char*>(data), size);
+        captureStream.write(padding, alignCapture(size) - size);
+    };
+
+    CaptureHeader header{};
+    header.magic = CAPTURE_MAGIC;
+    header.version = CAPTURE_VERSION;
+    header.vertexCount = static_cast<uint32_t>(vertices.size());
+    header.objectCount = static_cast<uint32_t>(sceneObjects.size());
+    header.lightCount = static_cast<uint32_t>(lights.size());
+    header.dynamicObjectCount = static_cast<uint32_t>(std::count_if(sceneObjects.begin(), sceneObjects.end(),
+        [](const SceneObject& object) { return !object.isStatic; }));
+    header.width = swapChainExtent.width;
+    header.height = swapChainExtent.height;
+    captureStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    writeAligned(vertices.data(), sizeof(Vertex) * vertices.size());
+
+    std::vector<CapturedObject> objects;
+    for (const auto& object : sceneObjects) {
+        objects.push_back({ object.firstVertex, object.vertexCount, object.isStatic ? 1u : 0u, 0, object.boundingSphere });
+    }
+    writeAligned(objects.data(), sizeof(CapturedObject) * objects.size());
+    writeAligned(lights.data(), sizeof(PointLight) * lights.size());
+
+    captureDynamicObjects = header.dynamicObjectCount;
+}
+
+void HelloTriangleApplication::captureFrame(float time) {
+    if (!captureStream.is_open()) {
+        return;
+    }
+
+    //lastFrameStart was taken at the start of this frame
+    if (capturedFrames++ == 0) {
+        captureStart = lastFrameStart;
+    }
+
+    CapturedFrame frame{};
+    frame.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(lastFrameStart - captureStart).count();
+    frame.time = time;
+    frame.renderScale = renderScale;
+    captureStream.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+
+    uint32_t dynamicObject = 0;
+    for (const auto& object : sceneObjects) {
+        if (!object.isStatic && dynamicObject++ < captureDynamicObjects) {
+            captureStream.write(reinterpret_cast<const char*>(&object.model), sizeof(glm::mat4));
+        }
+    }
+}
+
+void HelloTriangleApplication::destroyCapture() {
+    if (captureStream.is_open()) {
+        captureStream.close();
+    }
+    closeReplay();
+}
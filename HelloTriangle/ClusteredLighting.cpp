@@ -0,0 +1,100 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Clustered forward lighting
+*   The view frustum is divided into a 3D grid of clusters (froxels): CLUSTER_GRID_X * CLUSTER_GRID_Y tiles in screen space,
+*   with CLUSTER_GRID_Z slices in depth. Slices are spaced exponentially so that clusters near the camera are not stretched.
+*   Each frame a compute pass tests every light against the bounds of every cluster and writes:
+*       1. light index list: compact list of light indices, each cluster owns one contiguous range
+*       2. light grid: (offset, count) of the range owned by each cluster
+*   The fragment shader finds its cluster from gl_FragCoord and its view depth and only loops over the lights in that range,
+*   so shading cost follows how many lights are near a fragment rather than the total number of lights.
+*/
+
+void HelloTriangleApplication::createLights() {
+    //fixed seed so that every run produces the same scene
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> positionXY(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> positionZ(0.05f, 0.6f);
+    std::uniform_real_distribution<float> radius(0.2f, 0.5f);
+    std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+    lights.resize(LIGHT_COUNT);
+    for (auto& light : lights) {
+        light.positionRadius = glm::vec4(positionXY(generator), positionXY(generator), positionZ(generator), radius(generator));
+        light.color = glm::vec4(channel(generator), channel(generator), channel(generator), 1.0f);
+    }
+}
+
+void HelloTriangleApplication::createClusterBuffers() {
+    size_t imageCount = swapChainImages.size();
+
+    lightBuffers.resize(imageCount);
+    lightBuffersMemory.resize(imageCount);
+    lightBuffersMapped.resize(imageCount);
+    lightGridBuffers.resize(imageCount);
+    lightGridBuffersMemory.resize(imageCount);
+    lightIndexBuffers.resize(imageCount);
+    lightIndexBuffersMemory.resize(imageCount);
+    lightCounterBuffers.resize(imageCount);
+    lightCounterBuffersMemory.resize(imageCount);
+
+    VkDeviceSize lightBufferSize = sizeof(PointLight) * MAX_LIGHTS;
+    VkDeviceSize lightGridSize = sizeof(uint32_t) * 2 * CLUSTER_COUNT;
+    VkDeviceSize lightIndexSize = sizeof(uint32_t) * AVERAGE_LIGHTS_PER_CLUSTER * CLUSTER_COUNT;
+
+    for (size_t i = 0; i < imageCount; i++) {
+        //lights are rewritten by the CPU every frame, keep the memory mapped for the life of the buffer rather than mapping every frame
+        createBuffer(lightBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, lightBuffers[i], lightBuffersMemory[i]);
+        vkMapMemory(device, lightBuffersMemory[i], 0, lightBufferSize, 0, &lightBuffersMapped[i]);
+
+        //results of the binning pass only ever live on the GPU
+        createBuffer(lightGridSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightGridBuffers[i], lightGridBuffersMemory[i]);
+        createBuffer(lightIndexSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightIndexBuffers[i], lightIndexBuffersMemory[i]);
+
+        //counter is cleared with vkCmdFillBuffer at the start of every frame, so it also needs to be a transfer destination
+        createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, lightCounterBuffers[i], lightCounterBuffersMemory[i]);
+    }
+}
+
+void HelloTriangleApplication::createClusterPipeline() {
+    //compute pass uses the same descriptor set as the graphics pipeline
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &clusterPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, clusterPipelineLayout, "clusterPipelineLayout");
+
+    //the workgroup covers one depth slice of the grid, one invocation per cluster
+    //its size comes from the specialization constants of the variant
+    VkPipelineLayout layout = clusterPipelineLayout;
+    createReloadablePipeline(clusterPipeline, { "clusterLights" }, [this, layout]() { return buildComputePipeline("clusterLights", layout); });
+}
+
+void HelloTriangleApplication::recordLightBinning(VkCommandBuffer commandBuffer, size_t imageIndex) {
+    //reset the allocation counter of the light index list
+    vkCmdFillBuffer(commandBuffer, lightCounterBuffers[imageIndex], 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterPipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+
+    //one workgroup per depth slice
+    vkCmdDispatch(commandBuffer, 1, 1, CLUSTER_GRID_Z);
+
+    //fragment shader must wait for the light grid and index list to be written
+    VkMemoryBarrier binningBarrier{};
+    binningBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    binningBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    binningBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &binningBarrier, 0, nullptr, 0, nullptr);
+}
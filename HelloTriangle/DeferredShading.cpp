@@ -0,0 +1,301 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Deferred shading
+*   Subpass 0 (G-buffer): rasterize the scene and write the surface properties of the closest fragment (albedo, normal), tested against the prepass depth
+*   Subpass 1 (lighting): fullscreen triangle which reads the G-buffer of its own pixel through input attachments and runs the
+*       clustered light loop once per pixel, instead of once per rasterized fragment
+*   Both subpasses are in one render pass and the dependency between them is BY_REGION, so a tiled GPU can run the lighting
+*   subpass for a tile right after the G-buffer subpass for that tile while the G-buffer is still in on-chip memory.
+*   The G-buffer attachments are transient (lazily allocated, storeOp DONT_CARE) so they are never written back to memory.
+*   Depth is not part of the G-buffer: it comes from the depth prepass and is only loaded read only, see ShadowMapping.cpp.
+*/
+
+void HelloTriangleApplication::createTransientAttachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags, ImageAttachment& attachment) {
+    attachment.format = format;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    //transient: contents only need to be valid during the render pass, which allows the lazily allocated memory below
+    imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &attachment.image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transient attachment");
+    }
+    trackObject(VK_OBJECT_TYPE_IMAGE, attachment.image, "transient attachment");
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, attachment.image, &memRequirements);
+
+    //lazily allocated memory is only committed if the implementation actually needs it (tiled GPUs usually never do)
+    //desktop GPUs do not offer it, so fall back to normal device memory
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+            properties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            break;
+        }
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &attachment.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate transient attachment memory");
+    }
+    trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, attachment.memory, "transient attachment memory");
+
+    vkBindImageMemory(device, attachment.image, attachment.memory, 0);
+
+    attachment.view = createImageView(attachment.image, format, aspectFlags);
+}
+
+void HelloTriangleApplication::createGBuffer() {
+    //every attachment is written in subpass 0 and read as an input attachment in subpass 1
+    createTransientAttachment(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, gBufferAlbedo);
+    createTransientAttachment(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, gBufferNormal);
+}
+
+void HelloTriangleApplication::createDeferredRenderPass() {
+    /* Attachments */
+    //0. HDR target -- only attachment that is stored, read by post processing afterwards
+    //1. albedo
+    //2. view space normal
+    //3. depth -- written by the depth prepass before this render pass
+    std::array<VkAttachmentDescription, 4> attachments{};
+
+    attachments[0].format = HDR_FORMAT;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    //G-buffer contents are thrown away at the end of the render pass, so they never have to be written back to memory
+    const ImageAttachment* gBuffer[] = { &gBufferAlbedo, &gBufferNormal, &depthAttachment };
+    for (size_t i = 1; i < attachments.size(); i++) {
+        attachments[i].format = gBuffer[i - 1]->format;
+        attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    //depth arrives complete from the prepass and stays read only for both subpasses
+    attachments[3].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[3].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    attachments[3].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    /* Subpass 0: G-buffer */
+    std::array<VkAttachmentReference, 2> gBufferColorRefs{};
+    gBufferColorRefs[0] = { 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    gBufferColorRefs[1] = { 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference depthRef = { 3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+    /* Subpass 1: Lighting */
+    VkAttachmentReference lightingColorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    //order of the input attachments gives the input_attachment_index used in the shader
+    std::array<VkAttachmentReference, 3> inputRefs{};
+    inputRefs[0] = { 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    inputRefs[1] = { 2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    inputRefs[2] = { 3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+    std::array<VkSubpassDescription, 2> subpasses{};
+    subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[0].colorAttachmentCount = static_cast<uint32_t>(gBufferColorRefs.size());
+    subpasses[0].pColorAttachments = gBufferColorRefs.data();
+    subpasses[0].pDepthStencilAttachment = &depthRef;
+
+    subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[1].colorAttachmentCount = 1;
+    subpasses[1].pColorAttachments = &lightingColorRef;
+    subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputRefs.size());
+    subpasses[1].pInputAttachments = inputRefs.data();
+
+    /* Subpass Dependencies */
+    std::array<VkSubpassDependency, 3> dependencies{};
+
+    //G-buffer is shared between frames: writes must wait for the previous frame to stop reading and writing it
+    //(the depth prepass render pass already orders the depth written this frame before its use here)
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    //lighting reads only the G-buffer texel of its own pixel, so each region can start as soon as that region is written
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = 1;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    //HDR target is first used in the lighting subpass (same dependency as the forward render pass)
+    dependencies[2].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[2].dstSubpass = 1;
+    dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[2].srcAccessMask = 0;
+    dependencies[2].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[2].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create deferred render pass");
+    }
+    trackObject(VK_OBJECT_TYPE_RENDER_PASS, renderPass, "renderPass");
+}
+
+void HelloTriangleApplication::createLightingPipeline() {
+    //set 0: camera and light grid, set 1: G-buffer input attachments
+    VkDescriptorSetLayout setLayouts[] = { descriptorSetLayout, gBufferSetLayout };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &lightingPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create lighting pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, lightingPipelineLayout, "lightingPipelineLayout");
+
+    createReloadablePipeline(lightingPipeline, { "fullscreen", "deferredLighting" }, [this]() { return buildLightingPipeline(); });
+}
+
+VkPipeline HelloTriangleApplication::buildLightingPipeline() {
+    std::array<ShaderStage, 2> stages;
+    createShaderStage("fullscreen", stages[0]);
+    createShaderStage("deferredLighting", stages[1]);
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { stages[0].createInfo, stages[1].createInfo };
+
+    //fullscreen triangle is generated from gl_VertexIndex, no vertex buffer
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    //viewport and scissor are set while recording, same as the G-buffer pipeline
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateInfo.dynamicStateCount = 2;
+    dynamicStateInfo.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = nullptr;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
+    pipelineInfo.layout = lightingPipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 1;
+
+    VkPipeline pipeline;
+    if (linkGraphicsPipeline(pipelineInfo, stages.data(), &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create lighting pipeline");
+    }
+
+    for (auto& stage : stages) {
+        destroyShaderStage(stage);
+    }
+
+    return pipeline;
+}
+
+void HelloTriangleApplication::createGBufferDescriptorSet() {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &gBufferSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &gBufferDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate G-buffer descriptor set");
+    }
+
+    //input attachments do not use a sampler, only the view and the layout it will be in during the lighting subpass
+    std::array<VkDescriptorImageInfo, 3> imageInfos{};
+    imageInfos[0] = { VK_NULL_HANDLE, gBufferAlbedo.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    imageInfos[1] = { VK_NULL_HANDLE, gBufferNormal.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    imageInfos[2] = { VK_NULL_HANDLE, depthAttachment.view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = gBufferDescriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
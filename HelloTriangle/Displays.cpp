@@ -0,0 +1,282 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Displays
+*   With --displays, extra windows show the frames of the main one, e.g. on the other monitors of a control room. They share the
+*   device and everything drawn with it: a display only has a surface, a swapchain and acquire semaphores of its own.
+*   Each frame an image of every display is acquired after the main one, the post processing submit waits on all of them and copies
+*   its output into each, and a single vkQueuePresentKHR presents every swapchain. Another display adds a copy on the GPU and an
+*   acquire on the CPU, no draws, no submits and no presents. A display which has no image free right away is skipped for the
+*   frame instead of holding back the others, and one which is out of date is recreated without touching the main swapchain.
+*/
+
+void HelloTriangleApplication::createDisplayWindows() {
+    if (options.displays == 0) {
+        return;
+    }
+
+    //the main window is on the primary monitor, each display goes on one of the others while there are enough of them
+    int monitorCount = 0;
+    GLFWmonitor** monitors = glfwGetMonitors(&monitorCount);
+
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    //the window hints of the main window still hold: no client API, not resizable, hidden for a replay
+    displays.resize(options.displays);
+    for (uint32_t i = 0; i < options.displays; i++) {
+        DisplayWindow& display = displays[i];
+        std::string title = "Vulkan - display " + std::to_string(i + 1);
+        display.window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+        if (display.window == nullptr) {
+            throw std::runtime_error("failed to create display window " + std::to_string(i + 1));
+        }
+
+        glfwSetWindowUserPointer(display.window, this);
+        glfwSetWindowCloseCallback(display.window, displayCloseCallback);
+        glfwSetKeyCallback(display.window, keyCallback);
+
+        if (static_cast<int>(i) + 1 < monitorCount) {
+            int x, y;
+            glfwGetMonitorPos(monitors[i + 1], &x, &y);
+            glfwSetWindowPos(display.window, x, y);
+        }
+    }
+}
+
+void HelloTriangleApplication::createDisplays() {
+    //every semaphore and swapchain a frame can wait on or present, so that filling these in each frame does not allocate
+    postWaitSemaphores.reserve(2 + displays.size());
+    postWaitStages.reserve(2 + displays.size());
+    presentSwapChains.reserve(1 + displays.size());
+    presentImageIndices.reserve(1 + displays.size());
+    presentResults.reserve(1 + displays.size());
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < displays.size(); i++) {
+        DisplayWindow& display = displays[i];
+
+        if (glfwCreateWindowSurface(instance, display.window, nullptr, &display.surface) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create window surface of display " + std::to_string(i + 1));
+        }
+
+        //the present queue was picked for the main surface, the monitors of the displays may be driven by another GPU
+        VkBool32 presentSupport = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndices.presentFamily.value(), display.surface, &presentSupport);
+        if (!presentSupport) {
+            throw std::runtime_error("present queue can not present to display " + std::to_string(i + 1));
+        }
+
+        display.imageAvailableSemaphores.resize(framesInFlight);
+        for (size_t frame = 0; frame < framesInFlight; frame++) {
+            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &display.imageAvailableSemaphores[frame]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create semaphores for a display");
+            }
+            trackObject(VK_OBJECT_TYPE_SEMAPHORE, display.imageAvailableSemaphores[frame], "displayImageAvailableSemaphores");
+        }
+
+        createDisplaySwapChain(display);
+    }
+}
+
+void HelloTriangleApplication::destroyDisplays() {
+    for (auto& display : displays) {
+        destroyDisplaySwapChain(display);
+        for (auto semaphore : display.imageAvailableSemaphores) {
+            untrackObject(VK_OBJECT_TYPE_SEMAPHORE, semaphore);
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        vkDestroySurfaceKHR(instance, display.surface, nullptr);
+        glfwDestroyWindow(display.window);
+    }
+    displays.clear();
+}
+
+void HelloTriangleApplication::createDisplaySwapChain(DisplayWindow& display) {
+    //a minimized window has no size to create a swapchain for, it gets one once it is shown again
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(display.window, &width, &height);
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    SwapChainSupportDetails support;
+    querySwapChainSupport(physicalDevice, display.surface, support);
+
+    //the output of the frame is copied in texel for texel, so the display has to take the format of the main swapchain
+    auto surfaceFormat = std::find_if(support.formats.begin(), support.formats.end(),
+        [this](const VkSurfaceFormatKHR& format) { return format.format == swapChainImageFormat; });
+    if (surfaceFormat == support.formats.end()) {
+        throw std::runtime_error("display window has no surface format of the main swapchain");
+    }
+    if (!(support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        throw std::runtime_error("display swap chain images can not be used as a transfer destination");
+    }
+
+    VkExtent2D extent = support.capabilities.currentExtent;
+    if (extent.width == UINT32_MAX) {
+        extent.width = std::clamp(static_cast<uint32_t>(width), support.capabilities.minImageExtent.width, support.capabilities.maxImageExtent.width);
+        extent.height = std::clamp(static_cast<uint32_t>(height), support.capabilities.minImageExtent.height, support.capabilities.maxImageExtent.height);
+    }
+
+    uint32_t imageCount = support.capabilities.minImageCount + 1;
+    if (support.capabilities.maxImageCount > 0 && imageCount > support.capabilities.maxImageCount) {
+        imageCount = support.capabilities.maxImageCount;
+    }
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = display.surface;
+    createInfo.minImageCount = imageCount;
+    createInfo.imageFormat = surfaceFormat->format;
+    createInfo.imageColorSpace = surfaceFormat->colorSpace;
+    createInfo.imageExtent = extent;
+    createInfo.imageArrayLayers = 1;
+    //nothing is drawn into a display, it is only copied into
+    createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    //written on the compute queue and presented on the present queue, the same as the images of the main swapchain
+    const QueueFamilyIndices& indicies = queueFamilyIndices;
+    uint32_t queueFamilyIndicies[2];
+    uint32_t queueFamilyCount = 0;
+    for (uint32_t family : { indicies.computeFamily.value(), indicies.presentFamily.value() }) {
+        if (std::find(queueFamilyIndicies, queueFamilyIndicies + queueFamilyCount, family) == queueFamilyIndicies + queueFamilyCount) {
+            queueFamilyIndicies[queueFamilyCount++] = family;
+        }
+    }
+    if (queueFamilyCount > 1) {
+        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        createInfo.queueFamilyIndexCount = queueFamilyCount;
+        createInfo.pQueueFamilyIndices = queueFamilyIndicies;
+    }
+    else {
+        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    createInfo.preTransform = support.capabilities.currentTransform;
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    createInfo.presentMode = chooseSwapPresentMode(support.presentModes);
+    createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &display.swapChain) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create display swap chain");
+    }
+    trackObject(VK_OBJECT_TYPE_SWAPCHAIN_KHR, display.swapChain, "displaySwapChain");
+
+    vkGetSwapchainImagesKHR(device, display.swapChain, &imageCount, nullptr);
+    display.images.resize(imageCount);
+    vkGetSwapchainImagesKHR(device, display.swapChain, &imageCount, display.images.data());
+    display.extent = extent;
+}
+
+void HelloTriangleApplication::destroyDisplaySwapChain(DisplayWindow& display) {
+    if (display.swapChain == VK_NULL_HANDLE) {
+        return;
+    }
+
+    untrackObject(VK_OBJECT_TYPE_SWAPCHAIN_KHR, display.swapChain);
+    vkDestroySwapchainKHR(device, display.swapChain, nullptr);
+    display.swapChain = VK_NULL_HANDLE;
+    display.images.clear();
+}
+
+void HelloTriangleApplication::acquireDisplayImages() {
+    if (displays.empty()) {
+        return;
+    }
+
+    TraceZone zone(*this, "acquire displays");
+    for (auto& display : displays) {
+        display.acquired = false;
+        if (display.swapChain == VK_NULL_HANDLE || display.outOfDate) {
+            continue;
+        }
+
+        //no timeout: the main swapchain paces the frames, a display on a slower monitor shows every frame it has an image free for
+        VkResult result = vkAcquireNextImageKHR(device, display.swapChain, 0, display.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &display.imageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            display.outOfDate = true;
+        }
+        else if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+            display.acquired = true;
+        }
+        else if (result != VK_NOT_READY && result != VK_TIMEOUT) {
+            throw std::runtime_error("failed to aquire display swap chain image");
+        }
+    }
+}
+
+void HelloTriangleApplication::recordDisplayCopies(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    for (const auto& display : displays) {
+        if (!display.acquired) {
+            continue;
+        }
+
+        //the acquire semaphore of the display is waited on at the transfer stage too
+        VkImageMemoryBarrier displayBarrier{};
+        displayBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        displayBarrier.srcAccessMask = 0;
+        displayBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        displayBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        displayBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        displayBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        displayBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        displayBarrier.image = display.images[display.imageIndex];
+        displayBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &displayBarrier);
+
+        //blits are not available on the compute queue: a display larger than the main window shows the frame in its corner,
+        //and the rest is cleared rather than left with whatever the image held
+        if (display.extent.width > swapChainExtent.width || display.extent.height > swapChainExtent.height) {
+            VkClearColorValue black{};
+            vkCmdClearColorImage(commandBuffer, displayBarrier.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &displayBarrier.subresourceRange);
+
+            VkMemoryBarrier clearBarrier{};
+            clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+        }
+
+        VkImageCopy copyRegion{};
+        copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        copyRegion.extent = { std::min(display.extent.width, swapChainExtent.width), std::min(display.extent.height, swapChainExtent.height), 1 };
+        vkCmdCopyImage(commandBuffer, ldrTargets[imageIndex].image, VK_IMAGE_LAYOUT_GENERAL, displayBarrier.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+        displayBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        displayBarrier.dstAccessMask = 0;
+        displayBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        displayBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &displayBarrier);
+    }
+}
+
+void HelloTriangleApplication::recreateOutOfDateDisplays() {
+    for (auto& display : displays) {
+        if (!display.outOfDate && display.swapChain != VK_NULL_HANDLE) {
+            continue;
+        }
+
+        //still minimized, tried again next frame
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(display.window, &width, &height);
+        if (width == 0 || height == 0) {
+            continue;
+        }
+
+        TraceZone zone(*this, "recreateDisplaySwapChain");
+        swapchainRecreationsMetric->increment();
+        objectChurnExpected = true;
+        allocationsExpected = true;
+
+        //frames in flight may still be copying into the images of the old swapchain
+        vkDeviceWaitIdle(device);
+        destroyDisplaySwapChain(display);
+        createDisplaySwapChain(display);
+        display.outOfDate = false;
+    }
+}
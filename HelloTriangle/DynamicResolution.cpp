@@ -0,0 +1,138 @@
+#include "HelloTriangleApplication.h"
+
+#include <cmath>
+
+/*
+* Dynamic resolution
+*   The scene is rendered into the top left corner of the HDR target, scaled by renderScale, and the post processing chain scales it back up
+*   to the swapchain resolution. Every image records four timestamps: start and end of the graphics submit and of the post processing submit.
+*   When an image is acquired again its previous frame is known to be complete, so its timestamps are read without stalling
+*   and the render scale of the next frame is picked from them:
+*       - over budget: shrink right away to the scale which is expected to fit (GPU time is assumed to follow the pixel count)
+*       - well under budget: grow a few percent per frame, so that a single cheap frame does not make the resolution oscillate
+*/
+
+//headroom kept below the budget before the resolution is allowed to grow
+const float GROW_THRESHOLD = 0.85f;
+const float GROW_RATE = 0.05f;
+const float GPU_TIME_SMOOTHING = 0.1f;
+
+void HelloTriangleApplication::createTimestampQueries() {
+    QueueFamilyIndices indices = queueFamilyIndices;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    //timestamps only hold timestampValidBits bits, the rest has to be masked off before taking differences
+    auto timestampMask = [](uint32_t validBits) -> uint64_t {
+        return (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+    };
+    graphicsTimestampMask = timestampMask(queueFamilies[indices.graphicsFamily.value()].timestampValidBits);
+    computeTimestampMask = timestampMask(queueFamilies[indices.computeFamily.value()].timestampValidBits);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    size_t imageCount = swapChainImages.size();
+    timestampsWritten.assign(imageCount, false);
+    timestampRenderScales.assign(imageCount, 1.0f);
+    timestampFrames.assign(imageCount, 0);
+
+    //swapchain may have changed size, keep the current scale
+    renderExtent = {
+        std::clamp(static_cast<uint32_t>(std::lround(swapChainExtent.width * renderScale)), 1u, swapChainExtent.width),
+        std::clamp(static_cast<uint32_t>(std::lround(swapChainExtent.height * renderScale)), 1u, swapChainExtent.height)
+    };
+    viewExtent = { std::max(renderExtent.width / options.views, 1u), renderExtent.height };
+
+    if (graphicsTimestampMask == 0) {
+        if (options.dynamicResolution) {
+            std::cout << "graphics queue does not support timestamps, rendering at a fixed resolution \n";
+        }
+        //the pool holds the post processing timestamps as well, so without it there are none of those either
+        timestampQueryPool = VK_NULL_HANDLE;
+        computeTimestampMask = 0;
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = static_cast<uint32_t>(imageCount) * TIMESTAMPS_PER_IMAGE;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool");
+    }
+    trackObject(VK_OBJECT_TYPE_QUERY_POOL, timestampQueryPool, "timestampQueryPool");
+}
+
+void HelloTriangleApplication::updateRenderScale(uint32_t imageIndex) {
+    if (timestampQueryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (timestampsWritten[imageIndex]) {
+        //compute timestamps are never written when the compute queue does not support them, so they must not be read either.
+        //only the scene and post processing pairs are read here, the HUD pair after them is only written when the HUD is drawn (updateHud)
+        std::array<uint64_t, 4> timestamps{};
+        uint32_t queryCount = (computeTimestampMask != 0) ? static_cast<uint32_t>(timestamps.size()) : 2;
+
+        //the frame which wrote these has finished (its fence was waited on before getting here), so this does not block
+        VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE, queryCount,
+            queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS) {
+            uint64_t sceneTicks = (timestamps[1] - timestamps[0]) & graphicsTimestampMask;
+            uint64_t postTicks = (computeTimestampMask != 0) ? ((timestamps[3] - timestamps[2]) & computeTimestampMask) : 0;
+            gpuSceneTime = static_cast<float>(sceneTicks) * timestampPeriod / 1000000.0f;
+            gpuPostTime = static_cast<float>(postTicks) * timestampPeriod / 1000000.0f;
+
+            float frameTime = gpuSceneTime + gpuPostTime;
+            gpuFrameTime = frameTime;
+            gpuFrameTimeMetric->observe(frameTime / 1000.0);
+            recordFlightGpuTimes(timestampFrames[imageIndex], gpuSceneTime, gpuPostTime);
+            if (tracing) {
+                traceGpuTimestamps(timestamps);
+            }
+            gpuTime = (gpuTime == 0.0f) ? frameTime : gpuTime + (frameTime - gpuTime) * GPU_TIME_SMOOTHING;
+
+            if (options.dynamicResolution && frameTime > 0.0f) {
+                //the measurement belongs to the scale that frame was rendered at, which can be a few frames old
+                float measuredScale = timestampRenderScales[imageIndex];
+                float budget = options.gpuBudget;
+
+                if (frameTime > budget) {
+                    //pixel count goes with the square of the scale
+                    renderScale = std::min(renderScale, measuredScale * std::sqrt(budget / frameTime));
+                }
+                else if (gpuTime < budget * GROW_THRESHOLD) {
+                    float target = measuredScale * std::sqrt(budget * GROW_THRESHOLD / gpuTime);
+                    renderScale = std::max(renderScale, std::min(target, renderScale * (1.0f + GROW_RATE)));
+                }
+
+                renderScale = std::clamp(renderScale, options.minRenderScale, 1.0f);
+            }
+        }
+    }
+
+    //a replay renders every frame at the scale it was captured at, whatever the GPU time is now
+    if (replayFrame != nullptr) {
+        renderScale = replayFrame->renderScale;
+    }
+
+    renderExtent = {
+        std::clamp(static_cast<uint32_t>(std::lround(swapChainExtent.width * renderScale)), 1u, swapChainExtent.width),
+        std::clamp(static_cast<uint32_t>(std::lround(swapChainExtent.height * renderScale)), 1u, swapChainExtent.height)
+    };
+    viewExtent = { std::max(renderExtent.width / options.views, 1u), renderExtent.height };
+
+    renderScaleMetric->set(renderScale);
+
+    //the command buffers recorded after this write the timestamps of this image at the new scale
+    timestampRenderScales[imageIndex] = renderScale;
+    timestampFrames[imageIndex] = frameNumber;
+    timestampsWritten[imageIndex] = true;
+}
@@ -0,0 +1,245 @@
+#include "HelloTriangleApplication.h"
+
+#include <filesystem>
+#include <iomanip>
+
+/*
+* Flight recorder
+*   Frame time spikes which come and go are over long before a profiler can be attached, so the last frames are always recorded:
+*   a ring with a record per frame of how long each phase of drawFrame took, the GPU times read back for it, and how many submits,
+*   uploaded bytes and heap allocations it made. Recording is a clock read per phase into a record which is reused, so it stays on.
+*   When the time from the start of a frame to the start of the next one goes over --hitch-threshold, the frames before it and
+*   the frames which follow it (which also bring its GPU times) are handed to a writer thread, and written to --hitch-dir as a Chrome
+*   trace, the same format --trace writes. A hitch during the window of another one is written along with it.
+*   Frames which recreated the swapchain (which includes waiting out a minimized window) or swapped in rebuilt pipelines are slow
+*   for reasons which are known, like the first frames, and are not taken for hitches.
+*/
+
+//frames kept in the ring, more than a window holds so that the GPU times of the last frames can still be filled in
+const size_t FLIGHT_RECORDER_FRAMES = 256;
+//frames written before and after the one which went over the threshold
+const uint64_t HITCH_FRAMES_BEFORE = 120;
+const uint64_t HITCH_FRAMES_AFTER = 30;
+//the first frames wait on pipelines being linked and on caches being filled, they are slow for reasons which are known
+const uint64_t HITCH_WARMUP_FRAMES = 10;
+
+//indexed by FramePhase, the same names as the trace zones of drawFrame
+static const char* FRAME_PHASE_NAMES[] = {
+    "wait for frame fence", "acquire", "wait for image fence", "update", "record", "graphics submit", "compute submit", "present"
+};
+
+void HelloTriangleApplication::createFlightRecorder() {
+    if (options.hitchThreshold <= 0.0f) {
+        return;
+    }
+
+    flightRecords.assign(FLIGHT_RECORDER_FRAMES, FlightRecord{});
+    hitchRecords.reserve(FLIGHT_RECORDER_FRAMES);
+    writerRecords.reserve(FLIGHT_RECORDER_FRAMES);
+
+    stopFlightRecorder = false;
+    flightRecorderWriter = std::thread([this]() { runFlightRecorderWriter(); });
+}
+
+void HelloTriangleApplication::destroyFlightRecorder() {
+    if (!flightRecorderWriter.joinable()) {
+        return;
+    }
+
+    //a hitch right before exiting is written with the frames there are
+    if (hitchFrame != 0) {
+        handOverHitchWindow();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(flightRecorderMutex);
+        stopFlightRecorder = true;
+    }
+    flightRecorderCondition.notify_all();
+    flightRecorderWriter.join();
+}
+
+void HelloTriangleApplication::beginFlightFrame() {
+    if (flightRecords.empty()) {
+        return;
+    }
+
+    /* Hitch */
+    //the frame time of the previous frame is known now that this one starts
+    if (frameNumber > 0) {
+        uint64_t previous = frameNumber - 1;
+        flightRecords[previous % flightRecords.size()].interval = cpuFrameTime;
+
+        if (previous >= HITCH_WARMUP_FRAMES && previous >= lastHitchWindowEnd && !flightFrameExpectedSlow && cpuFrameTime > options.hitchThreshold) {
+            if (hitchFrame == 0) {
+                hitchWindowStart = std::max(previous - std::min(previous, HITCH_FRAMES_BEFORE), lastHitchWindowEnd);
+                hitchWindowEnd = previous + HITCH_FRAMES_AFTER + 1;
+            }
+            //the slowest frame of the window names it
+            if (hitchFrame == 0 || cpuFrameTime > hitchInterval) {
+                hitchFrame = previous;
+                hitchInterval = cpuFrameTime;
+            }
+        }
+    }
+
+    if (hitchFrame != 0 && frameNumber >= hitchWindowEnd) {
+        handOverHitchWindow();
+    }
+
+    /* Record */
+    FlightRecord& record = flightRecords[frameNumber % flightRecords.size()];
+    record = FlightRecord{};
+    record.frame = frameNumber;
+    record.start = traceTime();
+
+    flightSubmitsStart = graphicsSubmitsMetric->value.load(std::memory_order_relaxed) + computeSubmitsMetric->value.load(std::memory_order_relaxed)
+        + transferSubmitsMetric->value.load(std::memory_order_relaxed);
+    flightUploadBytesStart = uploadBytesMetric->value.load(std::memory_order_relaxed);
+    flightRecreationsStart = swapchainRecreationsMetric->value.load(std::memory_order_relaxed);
+}
+
+void HelloTriangleApplication::markFramePhase(FramePhase phase) {
+    if (flightRecords.empty()) {
+        return;
+    }
+
+    flightRecords[frameNumber % flightRecords.size()].phaseEnds[static_cast<size_t>(phase)] = traceTime();
+}
+
+void HelloTriangleApplication::endFlightFrame() {
+    if (flightRecords.empty()) {
+        return;
+    }
+
+    FlightRecord& record = flightRecords[frameNumber % flightRecords.size()];
+    double submits = graphicsSubmitsMetric->value.load(std::memory_order_relaxed) + computeSubmitsMetric->value.load(std::memory_order_relaxed)
+        + transferSubmitsMetric->value.load(std::memory_order_relaxed);
+    record.submits = static_cast<uint32_t>(submits - flightSubmitsStart);
+    record.uploadBytes = static_cast<uint64_t>(uploadBytesMetric->value.load(std::memory_order_relaxed) - flightUploadBytesStart);
+    record.heapAllocations = frameHeapAllocations;
+    record.renderScale = renderScale;
+    record.swapchainRecreated = swapchainRecreationsMetric->value.load(std::memory_order_relaxed) > flightRecreationsStart;
+
+    //also set by a frame which recreated the swapchain and then returned without drawing, whose time goes to the frame before it
+    flightFrameExpectedSlow = record.swapchainRecreated || allocationsExpected;
+}
+
+void HelloTriangleApplication::recordFlightGpuTimes(uint64_t frame, float sceneTime, float postTime) {
+    if (flightRecords.empty() || frame + flightRecords.size() <= frameNumber) {
+        return;
+    }
+
+    FlightRecord& record = flightRecords[frame % flightRecords.size()];
+    if (record.frame == frame) {
+        record.gpuSceneTime = sceneTime;
+        record.gpuPostTime = postTime;
+    }
+}
+
+void HelloTriangleApplication::handOverHitchWindow() {
+    bool handedOver = false;
+    {
+        std::lock_guard<std::mutex> lock(flightRecorderMutex);
+        if (!hitchRecordsReady) {
+            //the frame being drawn is not complete, the window ends before it
+            hitchRecords.clear();
+            for (uint64_t frame = hitchWindowStart; frame < frameNumber; frame++) {
+                hitchRecords.push_back(flightRecords[frame % flightRecords.size()]);
+            }
+            hitchRecordsFrame = hitchFrame;
+            hitchRecordsInterval = hitchInterval;
+            hitchRecordsReady = true;
+            handedOver = true;
+        }
+    }
+
+    if (handedOver) {
+        flightRecorderCondition.notify_one();
+    }
+    else {
+        std::cout << "hitch of " << hitchInterval << " ms in frame " << hitchFrame << " not written, the flight recorder is still writing the last one" << std::endl;
+    }
+
+    lastHitchWindowEnd = frameNumber;
+    hitchFrame = 0;
+}
+
+void HelloTriangleApplication::runFlightRecorderWriter() {
+    setTraceThreadName("flight recorder writer");
+
+    std::unique_lock<std::mutex> lock(flightRecorderMutex);
+    while (true) {
+        flightRecorderCondition.wait(lock, [this]() { return hitchRecordsReady || stopFlightRecorder; });
+
+        //a window handed over right before stopping is still written
+        if (!hitchRecordsReady) {
+            return;
+        }
+
+        writerRecords.swap(hitchRecords);
+        uint64_t frame = hitchRecordsFrame;
+        float interval = hitchRecordsInterval;
+        hitchRecordsReady = false;
+
+        lock.unlock();
+        writeHitchTrace(writerRecords, frame, interval);
+        lock.lock();
+    }
+}
+
+void HelloTriangleApplication::writeHitchTrace(const std::vector<FlightRecord>& records, uint64_t frame, float interval) {
+    if (records.empty()) {
+        return;
+    }
+
+    std::filesystem::path path = std::filesystem::path(options.hitchDirectory) / ("hitch-frame-" + std::to_string(frame) + ".json");
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "failed to open hitch trace " << path.string() << std::endl;
+        return;
+    }
+
+    //chrome trace times are microseconds, from the start of the first frame of the window
+    int64_t origin = records.front().start;
+    auto traceTimestamp = [origin](int64_t time) { return (time - origin) / 1000.0; };
+
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+        << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"render loop\"}}";
+
+    for (const auto& record : records) {
+        /* Phases */
+        //each phase starts where the one before it ended, phases a frame did not get to are left out
+        int64_t phaseStart = record.start;
+        for (size_t phase = 0; phase < static_cast<size_t>(FramePhase::Count); phase++) {
+            int64_t phaseEnd = record.phaseEnds[phase];
+            if (phaseEnd == 0) {
+                continue;
+            }
+            file << ",\n{\"name\":\"" << FRAME_PHASE_NAMES[phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << traceTimestamp(phaseStart)
+                << ",\"dur\":" << (phaseEnd - phaseStart) / 1000.0 << "}";
+            phaseStart = phaseEnd;
+        }
+
+        /* Frame */
+        //spans its phases, the rest of what is known about it goes into its arguments
+        file << ",\n{\"name\":\"frame " << record.frame << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << traceTimestamp(record.start)
+            << ",\"dur\":" << (phaseStart - record.start) / 1000.0
+            << ",\"args\":{\"interval_ms\":" << record.interval << ",\"gpu_scene_ms\":" << record.gpuSceneTime << ",\"gpu_post_ms\":" << record.gpuPostTime
+            << ",\"submits\":" << record.submits << ",\"upload_bytes\":" << record.uploadBytes << ",\"heap_allocations\":" << record.heapAllocations
+            << ",\"render_scale\":" << record.renderScale << ",\"swapchain_recreated\":" << (record.swapchainRecreated ? "true" : "false") << "}}";
+
+        /* Counters */
+        file << ",\n{\"name\":\"frame time (ms)\",\"ph\":\"C\",\"pid\":1,\"ts\":" << traceTimestamp(record.start)
+            << ",\"args\":{\"cpu\":" << record.interval << ",\"gpu\":" << record.gpuSceneTime + record.gpuPostTime << "}}"
+            << ",\n{\"name\":\"uploads (bytes)\",\"ph\":\"C\",\"pid\":1,\"ts\":" << traceTimestamp(record.start)
+            << ",\"args\":{\"bytes\":" << record.uploadBytes << "}}";
+
+        if (record.frame == frame) {
+            file << ",\n{\"name\":\"hitch\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":" << traceTimestamp(record.start) << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    std::cout << "hitch of " << interval << " ms in frame " << frame << ", flight recorder written to " << path.string() << std::endl;
+}
@@ -3,20 +3,279 @@
 * Based on code from vulkan-tutorial.com -- "Drawing a triangle" 
 */
 #include <iostream>
+#include <cstdio>
 
 #include "HelloTriangleApplication.h"
 
-int main() {
-    HelloTriangleApplication app;
+/// <summary>
+/// Read the startup settings from the command line arguments
+/// </summary>
+static ApplicationOptions parseOptions(int argc, char* argv[]) {
+    ApplicationOptions options;
 
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        //value of an option which takes one, e.g. --gpu-budget 16
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--deferred") {
+            options.deferred = true;
+        }
+        else if (arg == "--dynamic-resolution") {
+            options.dynamicResolution = true;
+        }
+        else if (arg == "--gpu-budget") {
+            options.gpuBudget = std::stof(nextValue());
+            if (options.gpuBudget <= 0.0f) {
+                throw std::runtime_error("gpu budget must be greater than 0");
+            }
+        }
+        else if (arg == "--min-render-scale") {
+            options.minRenderScale = std::stof(nextValue());
+            if (options.minRenderScale <= 0.0f || options.minRenderScale > 1.0f) {
+                throw std::runtime_error("min render scale must be in (0, 1]");
+            }
+        }
+        else if (arg == "--upscale") {
+            std::string filter = nextValue();
+            if (filter == "bilinear") {
+                options.upscaleFilter = UpscaleFilter::Bilinear;
+            }
+            else if (filter == "lanczos") {
+                options.upscaleFilter = UpscaleFilter::Lanczos;
+            }
+            else if (filter == "edge") {
+                options.upscaleFilter = UpscaleFilter::EdgeAware;
+            }
+            else {
+                throw std::runtime_error("unknown upscale filter " + filter);
+            }
+        }
+        else if (arg == "--no-shadows") {
+            options.shadows = false;
+        }
+        else if (arg == "--debug-view") {
+            std::string view = nextValue();
+            if (view == "normals") {
+                options.debugView = DebugView::Normals;
+            }
+            else if (view == "cascades") {
+                options.debugView = DebugView::Cascades;
+            }
+            else if (view == "lights") {
+                options.debugView = DebugView::LightCount;
+            }
+            else {
+                throw std::runtime_error("unknown debug view " + view);
+            }
+        }
+        else if (arg == "--shader-dir") {
+            options.shaderDirectory = nextValue();
+        }
+        else if (arg == "--no-hot-reload") {
+            options.hotReload = false;
+        }
+        else if (arg == "--no-shader-opt") {
+            options.optimizeShaders = false;
+        }
+        else if (arg == "--shader-benchmark") {
+            options.shaderBenchmark = true;
+        }
+        else if (arg == "--no-pipeline-library") {
+            options.pipelineLibraries = false;
+        }
+        else if (arg == "--shader-objects") {
+            options.shaderObjects = true;
+        }
+        else if (arg == "--shader-object-benchmark") {
+            options.shaderObjectBenchmark = true;
+        }
+        else if (arg == "--trace") {
+            options.traceFile = nextValue();
+        }
+        else if (arg == "--pipeline-stats") {
+            options.pipelineStatistics = true;
+        }
+        else if (arg == "--metrics-file") {
+            options.metricsFile = nextValue();
+        }
+        else if (arg == "--hud") {
+            options.hud = true;
+        }
+        else if (arg == "--track-objects") {
+            options.trackObjects = true;
+        }
+        else if (arg == "--stress-scene") {
+            options.stressScene = true;
+        }
+        else if (arg == "--stress-meshes") {
+            options.stressScene = true;
+            options.stress.meshes = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--stress-instances") {
+            options.stressScene = true;
+            options.stress.instances = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--stress-materials") {
+            options.stressScene = true;
+            options.stress.materials = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.stress.materials == 0) {
+                throw std::runtime_error("stress materials must be at least 1");
+            }
+        }
+        else if (arg == "--stress-dynamic") {
+            options.stressScene = true;
+            options.stress.dynamicFraction = std::stof(nextValue());
+            if (options.stress.dynamicFraction < 0.0f || options.stress.dynamicFraction > 1.0f) {
+                throw std::runtime_error("stress dynamic fraction must be in [0, 1]");
+            }
+        }
+        else if (arg == "--stress-triangle-size") {
+            //two values: the smallest and the largest triangle size
+            options.stressScene = true;
+            options.stress.minTriangleSize = std::stof(nextValue());
+            options.stress.maxTriangleSize = std::stof(nextValue());
+            if (options.stress.minTriangleSize <= 0.0f || options.stress.maxTriangleSize < options.stress.minTriangleSize) {
+                throw std::runtime_error("stress triangle sizes must be greater than 0, the smallest first");
+            }
+        }
+        else if (arg == "--stress-seed") {
+            options.stressScene = true;
+            options.stress.seed = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--capture") {
+            options.captureFile = nextValue();
+        }
+        else if (arg == "--replay") {
+            options.replayFile = nextValue();
+        }
+        else if (arg == "--replay-timing") {
+            std::string timing = nextValue();
+            if (timing == "fast") {
+                options.replayTiming = ReplayTiming::Fast;
+            }
+            else if (timing == "recorded") {
+                options.replayTiming = ReplayTiming::Recorded;
+            }
+            else {
+                throw std::runtime_error("unknown replay timing " + timing);
+            }
+        }
+        else if (arg == "--check-allocations") {
+            options.checkAllocations = true;
+        }
+        else if (arg == "--frames") {
+            options.frameLimit = std::stoull(nextValue());
+        }
+        else if (arg == "--hitch-threshold") {
+            options.hitchThreshold = std::stof(nextValue());
+            if (options.hitchThreshold < 0.0f) {
+                throw std::runtime_error("hitch threshold must not be negative");
+            }
+        }
+        else if (arg == "--hitch-dir") {
+            options.hitchDirectory = nextValue();
+        }
+        else if (arg == "--displays") {
+            options.displays = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--views") {
+            options.views = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.views == 0 || options.views > MAX_VIEWS) {
+                throw std::runtime_error("views must be in [1, " + std::to_string(MAX_VIEWS) + "]");
+            }
+        }
+        else if (arg == "--view-separation") {
+            options.viewSeparation = std::stof(nextValue());
+        }
+        else if (arg == "--batch-views") {
+            options.batchViews = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--batch-view-size") {
+            options.batchViewSize = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.batchViewSize == 0) {
+                throw std::runtime_error("batch view size must be at least 1");
+            }
+        }
+        else if (arg == "--batches") {
+            options.batchCount = std::stoull(nextValue());
+        }
+        else if (arg == "--batch-dir") {
+            options.batchDirectory = nextValue();
+        }
+        else if (arg == "--frames-in-flight") {
+            options.framesInFlight = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.framesInFlight == 0) {
+                throw std::runtime_error("frames in flight must be at least 1");
+            }
+        }
+        else if (arg == "--offline") {
+            options.offlineFrames = std::stoull(nextValue());
+        }
+        else if (arg == "--offline-size") {
+            //two values: width and height
+            options.offlineWidth = static_cast<uint32_t>(std::stoul(nextValue()));
+            options.offlineHeight = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.offlineWidth == 0 || options.offlineHeight == 0) {
+                throw std::runtime_error("offline size must be at least 1x1");
+            }
+        }
+        else if (arg == "--offline-dir") {
+            options.offlineDirectory = nextValue();
+        }
+        else if (arg == "--offline-rate") {
+            options.offlineFrameRate = std::stof(nextValue());
+            if (options.offlineFrameRate <= 0.0f) {
+                throw std::runtime_error("offline frame rate must be greater than 0");
+            }
+        }
+        else if (arg == "--io-threads") {
+            options.ioThreads = static_cast<uint32_t>(std::stoul(nextValue()));
+        }
+        else if (arg == "--poster") {
+            //two values: width and height
+            options.posterWidth = static_cast<uint32_t>(std::stoul(nextValue()));
+            options.posterHeight = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.posterWidth == 0 || options.posterHeight == 0) {
+                throw std::runtime_error("poster size must be at least 1x1");
+            }
+        }
+        else if (arg == "--poster-tile") {
+            options.posterTileSize = static_cast<uint32_t>(std::stoul(nextValue()));
+            if (options.posterTileSize == 0 || options.posterTileSize % 16 != 0) {
+                throw std::runtime_error("poster tile size must be a multiple of 16");
+            }
+        }
+        else if (arg == "--poster-file") {
+            options.posterFile = nextValue();
+        }
+        else {
+            throw std::runtime_error("unknown argument " + arg);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[]) {
     try {
+        HelloTriangleApplication app(parseOptions(argc, argv));
         app.run();
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
+        //without anything on stdin (unattended runs, CI) there is nobody to press a key, so the failure is returned right away
+        int key;
         do {
             std::cout << "Press a key to exit..." << std::endl; 
-        } while (std::cin.get() != '\n'); 
+            key = std::cin.get();
+        } while (key != '\n' && key != EOF); 
         return EXIT_FAILURE;
     }
 
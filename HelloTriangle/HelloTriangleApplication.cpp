@@ -7,14 +7,17 @@ void HelloTriangleApplication::mainLoop() {
 
     auto start = Clock::now(); 
 
-    while (!glfwWindowShouldClose(window)) {
+    while (!glfwWindowShouldClose(window) && (options.frameLimit == 0 || frameNumber < options.frameLimit)) {
         glfwPollEvents();
         drawFrame(); 
         frameCount++; 
 
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count(); 
         if (duration >= 1000) {
-            std::cout << "Frames: " << frameCount << std::endl; 
+            std::cout << "Frames: " << frameCount << " | GPU: " << gpuTime << " ms | Render: " << renderExtent.width << "x" << renderExtent.height << std::endl; 
+            if (pipelineStatisticsQueryPool != VK_NULL_HANDLE) {
+                printPipelineStatistics();
+            }
             frameCount = 0; 
             start = Clock::now(); 
         }
@@ -38,11 +41,34 @@ void HelloTriangleApplication::drawFrame() {
     *       designed to synchronize opertaions within or across command queues 
     * need to sync queu operations of draw and presentation commmands -> using semaphores
     */ 
+    TraceZone frameZone(*this, "drawFrame");
+    beginObjectFrame();
+    beginAllocationFrame();
+
+    //the first frame has no frame before it, only the startup
+    auto frameStart = std::chrono::steady_clock::now();
+    if (frameNumber > 0) {
+        cpuFrameTime = std::chrono::duration<float, std::milli>(frameStart - lastFrameStart).count();
+        frameTimeMetric->observe(cpuFrameTime / 1000.0);
+    }
+    lastFrameStart = frameStart;
+    beginFlightFrame();
+
+    //every way out of the frame ends what was begun for it above, whether or not it was drawn
+    auto endFrame = [this]() {
+        endAllocationFrame();
+        endFlightFrame();
+        endObjectFrame();
+    };
 
     //wait for fence to be ready 
     // 3. 'VK_TRUE' -> waiting for all fences
     // 4. timeout 
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        TraceZone zone(*this, "wait for frame fence");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    markFramePhase(FramePhase::FrameFence);
 
     VkResult result; //swapchain status
 
@@ -55,10 +81,14 @@ void HelloTriangleApplication::drawFrame() {
         //vulkan can return two different flags 
         // 1. VK_ERROR_OUT_OF_DATE_KHR: swap chain has become incompatible with the surface and cant be used for rendering. (Window resize)
         // 2. VK_SUBOPTIMAL_KHR: swap chain can still be used to present to the surface, but the surface properties no longer match
-    result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    {
+        TraceZone zone(*this, "acquire");
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         //the swapchain is no longer optimal according to vulkan. Must recreate a more efficient swap chain
         recreateSwapChain(); 
+        endFrame();
         return; 
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
@@ -66,42 +96,107 @@ void HelloTriangleApplication::drawFrame() {
         throw std::runtime_error("failed to aquire swap chain image");
     }
 
+    //only once the frame is sure to be drawn, an acquired display image has to be presented
+    acquireDisplayImages();
+    markFramePhase(FramePhase::Acquire);
+
     //check if a previous frame is using the current image
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        TraceZone zone(*this, "wait for image fence");
         vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX); 
     }
     //mark image as now being in use by this frame
     imagesInFlight[imageIndex] = inFlightFences[currentFrame]; 
+    markFramePhase(FramePhase::ImageFence);
+
+    //pipelines rebuilt by the shader workers are used from this frame on
+    updateReloadedPipelines(false);
+
+    //image is no longer in use by the GPU so its timestamps can be read and its camera and light data can be rewritten
+    updateRenderScale(imageIndex);
+    readPipelineStatistics(imageIndex);
+    updateHud(imageIndex);
+    updateUniformBuffer(imageIndex);
+    markFramePhase(FramePhase::Update);
+
+    //command buffers of the image are no longer pending either, record them for the current render scale
+    {
+        TraceZone zone(*this, "record");
+        auto recordStart = Clock::now();
+        recordCommandBuffer(imageIndex);
+        recordTime = std::chrono::duration<float, std::milli>(Clock::now() - recordStart).count();
+        recordPostProcessCommands(imageIndex);
+    }
+    markFramePhase(FramePhase::Record);
 
     /* Command Buffer */
     VkSubmitInfo submitInfo{}; 
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO; 
 
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame]};
-
-    //where in the pipeline should the wait happen, want to wait until image becomes available
-    //wait at stage of color attachment -> theoretically allows for shader execution before wait 
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }; //each entry corresponds through index to waitSemaphores[]
-    submitInfo.waitSemaphoreCount = 1; 
-    submitInfo.pWaitSemaphores = waitSemaphores; 
-    submitInfo.pWaitDstStageMask = waitStages; 
+    //the scene is drawn into the HDR target of this image and never touches the swapchain image,
+    //so there is nothing to wait for -- the graphics queue can start while the image is still being presented
+    submitInfo.waitSemaphoreCount = 0; 
 
-    //which command buffers to submit for execution -- should submit command buffer that binds the swap chain image that was just acquired as color attachment
+    //which command buffers to submit for execution -- should submit command buffer that renders into the HDR target of the acquired image
     submitInfo.commandBufferCount = 1; 
     submitInfo.pCommandBuffers = &graphicsCommandBuffers[imageIndex]; 
 
     //what semaphores to signal when command buffers have finished
-    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame]};
-
+    VkSemaphore sceneSemaphores[] = { sceneFinishedSemaphores[currentFrame] };
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitInfo.pSignalSemaphores = sceneSemaphores;
+
+    {
+        TraceZone zone(*this, "graphics submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer"); 
+        }
+        graphicsSubmitsMetric->increment();
+    }
+    markFramePhase(FramePhase::GraphicsSubmit);
+
+    /* Post Processing */
+    //runs on the compute queue, which leaves the graphics queue free to start on the geometry of the next frame
+    VkSubmitInfo postSubmitInfo{};
+    postSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    //post processing can start as soon as the scene is done, the swapchain images are only needed for the final copies
+    //each entry of postWaitStages corresponds through index to postWaitSemaphores
+    postWaitSemaphores.clear();
+    postWaitStages.clear();
+    postWaitSemaphores.push_back(sceneFinishedSemaphores[currentFrame]);
+    postWaitStages.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    postWaitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+    postWaitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (const auto& display : displays) {
+        if (display.acquired) {
+            postWaitSemaphores.push_back(display.imageAvailableSemaphores[currentFrame]);
+            postWaitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+    }
+    postSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(postWaitSemaphores.size());
+    postSubmitInfo.pWaitSemaphores = postWaitSemaphores.data();
+    postSubmitInfo.pWaitDstStageMask = postWaitStages.data();
+
+    postSubmitInfo.commandBufferCount = 1;
+    postSubmitInfo.pCommandBuffers = &computeCommandBuffers[imageIndex];
+
+    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame]};
+    postSubmitInfo.signalSemaphoreCount = 1;
+    postSubmitInfo.pSignalSemaphores = signalSemaphores;
 
     //set fence to unsignaled state
+    //the fence goes with the last submit of the frame, once it signals every per-image resource is free again
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer"); 
+    {
+        TraceZone zone(*this, "compute submit");
+        if (vkQueueSubmit(computeQueue, 1, &postSubmitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit post processing command buffer"); 
+        }
+        computeSubmitsMetric->increment();
     }
+    markFramePhase(FramePhase::ComputeSubmit);
 
     /* Presentation */
     VkPresentInfoKHR presentInfo{};
@@ -111,17 +206,44 @@ void HelloTriangleApplication::drawFrame() {
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalSemaphores;
 
-    //what swapchains to present images to 
-    VkSwapchainKHR swapChains[] = { swapChain };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
+    //what swapchains to present images to -- the displays go along in the same call, rather than a present each
+    presentSwapChains.clear();
+    presentImageIndices.clear();
+    presentSwapChains.push_back(swapChain);
+    presentImageIndices.push_back(imageIndex);
+    for (const auto& display : displays) {
+        if (display.acquired) {
+            presentSwapChains.push_back(display.swapChain);
+            presentImageIndices.push_back(display.imageIndex);
+        }
+    }
+    presentInfo.swapchainCount = static_cast<uint32_t>(presentSwapChains.size());
+    presentInfo.pSwapchains = presentSwapChains.data();
+    presentInfo.pImageIndices = presentImageIndices.data();
 
-    //can use this to get results from swap chain to check if presentation was successful
-    presentInfo.pResults = nullptr; // Optional
+    //result of each swapchain, so that a display which is out of date does not recreate the main swapchain
+    presentResults.assign(presentSwapChains.size(), VK_SUCCESS);
+    presentInfo.pResults = presentResults.data();
 
     //make call to present image
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        TraceZone zone(*this, "present");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
+
+    size_t presented = 1;
+    for (auto& display : displays) {
+        if (!display.acquired) {
+            continue;
+        }
+        VkResult displayResult = presentResults[presented++];
+        if (displayResult == VK_ERROR_OUT_OF_DATE_KHR || displayResult == VK_SUBOPTIMAL_KHR) {
+            display.outOfDate = true;
+        }
+    }
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        result = presentResults[0];
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frameBufferResized) {
         frameBufferResized = false; 
@@ -130,30 +252,68 @@ void HelloTriangleApplication::drawFrame() {
     else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image");
     }
+    recreateOutOfDateDisplays();
+    markFramePhase(FramePhase::Present);
 
     //advance to next frame
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT; 
+    currentFrame = (currentFrame + 1) % framesInFlight; 
+    endFrame();
+    frameNumber++;
+    framesMetric->increment();
 }
 
 void HelloTriangleApplication::cleanup() {
+    if (tracing) {
+        exportTrace();
+    }
+    destroyCapture();
+    destroyFlightRecorder();
+    destroyMetrics();
+    destroyShaderCompiler();
+    destroyDisplays();
+    destroyBatchViews();
     cleanupSwapChain(); 
-
+    destroyPipelineLibraries(VK_NULL_HANDLE);
+
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, clusterPipeline);
+    vkDestroyPipeline(device, clusterPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, clusterPipelineLayout);
+    vkDestroyPipelineLayout(device, clusterPipelineLayout, nullptr);
+    destroyShadowResources();
+    destroyShaderObjects();
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, descriptorSetLayout);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, gBufferSetLayout);
+    vkDestroyDescriptorSetLayout(device, gBufferSetLayout, nullptr);
+
+    untrackObject(VK_OBJECT_TYPE_BUFFER, vertexBuffer);
     vkDestroyBuffer(device, vertexBuffer, nullptr); 
+    untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, vertexBufferMemory);
     vkFreeMemory(device, vertexBufferMemory, nullptr); 
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < framesInFlight; i++) {
+        untrackObject(VK_OBJECT_TYPE_SEMAPHORE, renderFinishedSemaphores[i]);
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_SEMAPHORE, imageAvailableSemaphores[i]);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_SEMAPHORE, sceneFinishedSemaphores[i]);
+        vkDestroySemaphore(device, sceneFinishedSemaphores[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_FENCE, inFlightFences[i]);
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
 
+    untrackObject(VK_OBJECT_TYPE_COMMAND_POOL, transferCommandPool);
     vkDestroyCommandPool(device, transferCommandPool, nullptr); 
+    untrackObject(VK_OBJECT_TYPE_COMMAND_POOL, graphicsCommandPool);
     vkDestroyCommandPool(device, graphicsCommandPool, nullptr); 
+    untrackObject(VK_OBJECT_TYPE_COMMAND_POOL, computeCommandPool);
+    vkDestroyCommandPool(device, computeCommandPool, nullptr);
     
-    vkDestroyDevice(device, nullptr);
+    reportObjectLeaks();
+    vkDestroyDevice(device, hostAllocator());
 
     vkDestroySurfaceKHR(instance, surface, nullptr);
-    vkDestroyInstance(instance, nullptr);
+    vkDestroyInstance(instance, hostAllocator());
     glfwDestroyWindow(window);
 
     glfwTerminate();
@@ -162,28 +322,136 @@ void HelloTriangleApplication::cleanup() {
 void HelloTriangleApplication::cleanupSwapChain() {
     //delete framebuffers 
     for (auto framebuffer : swapChainFramebuffers) {
+        untrackObject(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffer);
         vkDestroyFramebuffer(device, framebuffer, nullptr);
     }
+    untrackObject(VK_OBJECT_TYPE_FRAMEBUFFER, depthPrepassFramebuffer);
+    vkDestroyFramebuffer(device, depthPrepassFramebuffer, nullptr);
 
+    for (auto commandBuffer : graphicsCommandBuffers) {
+        untrackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer);
+    }
+    for (auto commandBuffer : computeCommandBuffers) {
+        untrackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer);
+    }
     vkFreeCommandBuffers(device, graphicsCommandPool, static_cast<uint32_t>(graphicsCommandBuffers.size()), graphicsCommandBuffers.data()); 
+    vkFreeCommandBuffers(device, computeCommandPool, static_cast<uint32_t>(computeCommandBuffers.size()), computeCommandBuffers.data());
 
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, graphicsPipeline);
     vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout);
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    if (options.deferred) {
+        untrackObject(VK_OBJECT_TYPE_PIPELINE, lightingPipeline);
+        vkDestroyPipeline(device, lightingPipeline, nullptr);
+        untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, lightingPipelineLayout);
+        vkDestroyPipelineLayout(device, lightingPipelineLayout, nullptr);
+
+        destroyAttachment(gBufferAlbedo);
+        destroyAttachment(gBufferNormal);
+    }
+    untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, depthArrayView);
+    vkDestroyImageView(device, depthArrayView, nullptr);
+    destroyAttachment(depthAttachment);
+    destroyPipelineLibraries(renderPass);
+    untrackObject(VK_OBJECT_TYPE_RENDER_PASS, renderPass);
     vkDestroyRenderPass(device, renderPass, nullptr);
 
+    //composite pipeline depends on the swap chain format, so the whole post processing chain goes with the swap chain
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, bloomDownsamplePipeline);
+    vkDestroyPipeline(device, bloomDownsamplePipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, bloomUpsamplePipeline);
+    vkDestroyPipeline(device, bloomUpsamplePipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, compositePipeline);
+    vkDestroyPipeline(device, compositePipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, postPipelineLayout);
+    vkDestroyPipelineLayout(device, postPipelineLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, postSetLayout);
+    vkDestroyDescriptorSetLayout(device, postSetLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_SAMPLER, postSampler);
+    vkDestroySampler(device, postSampler, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, postDescriptorPool);
+    vkDestroyDescriptorPool(device, postDescriptorPool, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, upscalePipeline);
+    vkDestroyPipeline(device, upscalePipeline, nullptr);
+    destroyHud();
+    destroyPostProcessTargets();
+    untrackObject(VK_OBJECT_TYPE_QUERY_POOL, timestampQueryPool);
+    vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+    untrackObject(VK_OBJECT_TYPE_QUERY_POOL, pipelineStatisticsQueryPool);
+    vkDestroyQueryPool(device, pipelineStatisticsQueryPool, nullptr);
+
     //destroy image views 
     for (auto imageView : swapChainImageViews) {
+        untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, imageView);
         vkDestroyImageView(device, imageView, nullptr);
     }
 
+    untrackObject(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapChain);
     vkDestroySwapchainKHR(device, swapChain, nullptr);
+    destroyOfflineOutputs();
+
+    //number of per-image buffers depends on the swapchain image count
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        untrackObject(VK_OBJECT_TYPE_BUFFER, uniformBuffers[i]);
+        vkDestroyBuffer(device, uniformBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, uniformBuffersMemory[i]);
+        vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, lightBuffers[i]);
+        vkDestroyBuffer(device, lightBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, lightBuffersMemory[i]);
+        vkFreeMemory(device, lightBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, lightGridBuffers[i]);
+        vkDestroyBuffer(device, lightGridBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, lightGridBuffersMemory[i]);
+        vkFreeMemory(device, lightGridBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, lightIndexBuffers[i]);
+        vkDestroyBuffer(device, lightIndexBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, lightIndexBuffersMemory[i]);
+        vkFreeMemory(device, lightIndexBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, lightCounterBuffers[i]);
+        vkDestroyBuffer(device, lightCounterBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, lightCounterBuffersMemory[i]);
+        vkFreeMemory(device, lightCounterBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, cascadeBuffers[i]);
+        vkDestroyBuffer(device, cascadeBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, cascadeBuffersMemory[i]);
+        vkFreeMemory(device, cascadeBuffersMemory[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_BUFFER, depthBoundsBuffers[i]);
+        vkDestroyBuffer(device, depthBoundsBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, depthBoundsBuffersMemory[i]);
+        vkFreeMemory(device, depthBoundsBuffersMemory[i], nullptr);
+    }
+
+    //destroying the pool frees all descriptor sets allocated from it
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, descriptorPool);
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 }
 
 void HelloTriangleApplication::run() {
+    openReplay();
     initWindow();
     initVulkan();
-    mainLoop();
+    if (replayHeader != nullptr) {
+        runReplay();
+    }
+    else if (options.shaderBenchmark) {
+        runShaderBenchmark();
+    }
+    else if (options.shaderObjectBenchmark) {
+        runShaderObjectBenchmark();
+    }
+    else if (options.batchViews > 0) {
+        runBatchViews();
+    }
+    else if (options.offline()) {
+        runOffline();
+    }
+    else {
+        mainLoop();
+    }
     cleanup();
+    checkSteadyStateAllocations();
 }
 
 void HelloTriangleApplication::initVulkan() {
@@ -191,17 +459,71 @@ void HelloTriangleApplication::initVulkan() {
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createObjectTracker();
+    createTracing();
+    createMetrics();
+    createFlightRecorder();
+    createShaderVariants();
+    createShaderCompiler();
+    //the workers read the registry of reloadable pipelines, which is filled from here on -- the optimized links queued
+    //while it grows wait until every pipeline has been created
+    pauseShaderJobs();
     createSwapChain();
     createImageViews(); 
+    createPostProcessTargets();
+    createDepthAttachment();
+    if (options.deferred) {
+        createGBuffer();
+    }
     createRenderPass(); 
+    createDescriptorSetLayout();
+    createShadowResources();
+    createShadowPipelines();
     createGraphicsPipeline(); 
+    if (options.deferred) {
+        createLightingPipeline();
+    }
+    createShaderObjects();
+    createClusterPipeline();
+    createPostProcessPipelines();
     createFramebuffers(); 
     createCommandPools(); 
+    if (options.stressScene) {
+        createStressScene();
+    }
+    else {
+        createScene();
+    }
+    createLights();
+    loadReplayScene();
+    createCapture();
     createVertexBuffer();
+    createUniformBuffers();
+    createClusterBuffers();
+    createShadowBuffers();
+    createDescriptorPool();
+    createDescriptorSets();
+    if (options.deferred) {
+        createGBufferDescriptorSet();
+    }
+    createPostProcessDescriptorSets();
+    createHud();
     createCommandBuffers(); 
+    createComputeCommandBuffers();
+    createTimestampQueries();
+    createPipelineStatisticsQueries();
     createSemaphores(); 
     createFences(); 
     createFenceImageTracking();
+    createDisplays();
+    createBatchViews();
+    resumeShaderJobs();
+
+    //every pipeline exists now, so changed shaders have something to rebuild
+    //the shader benchmark swaps every pipeline itself, a reload in the middle would skew it
+    if (compileShaderSources && options.hotReload && !options.shaderBenchmark) {
+        shaderWatcher = std::thread([this]() { watchShaderSources(); });
+    }
     std::cout << "Finished Vulkan Init \n";
 }
 
@@ -219,19 +541,41 @@ void HelloTriangleApplication::initWindow() {
     //disable resizing functionality in glfw as this will not be handled in the first tutorial
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
+    //a replay renders at the size of the capture, and nothing needs to be seen
+    int width = WIDTH;
+    int height = HEIGHT;
+    if (replayHeader != nullptr) {
+        width = static_cast<int>(replayHeader->width);
+        height = static_cast<int>(replayHeader->height);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    //nor do batch views, offline frames and posters, which never present
+    if (options.batchViews > 0 || options.offline()) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+
     //create a window, 3rd argument allows selection of monitor, 4th argument only applies to openGL
-    window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+    window = glfwCreateWindow(width, height, "Vulkan", nullptr, nullptr);
 
     //need to give GLFW a pointer to current instance of this class
     glfwSetWindowUserPointer(window, this); 
 
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback); 
+    glfwSetKeyCallback(window, keyCallback);
+
+    createDisplayWindows();
 }
 
 void HelloTriangleApplication::createSwapChain() {
+    //offline frames are copied into images the CPU reads, nothing is presented
+    if (options.offline()) {
+        createOfflineOutputs();
+        return;
+    }
+
     //TODO: current implementation requires halting to all rendering when recreating swapchain. Can place old swap chain in oldSwapChain field 
     //  in order to prevent this and allow rendering to continue
-    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+    querySwapChainSupport(physicalDevice, surface, swapChainSupport);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
@@ -256,28 +600,34 @@ void HelloTriangleApplication::createSwapChain() {
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1; //1 unless using 3D display 
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; //how are these images going to be used? Color attachment since we are rendering to them (can change for postprocessing effects)
+    //how are these images going to be used? The post processing chain copies its output into them.
+    //color attachment is always supported and keeps the swap chain image views valid
+    if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        throw std::runtime_error("swap chain images can not be used as a transfer destination");
+    }
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
-    QueueFamilyIndices indicies = findQueueFamilies(physicalDevice);
-    uint32_t queueFamilyIndicies[] = { indicies.graphicsFamily.value(), indicies.transferFamily.value(), indicies.presentFamily.value() };
+    //distinct families which use the images, without a std::set: a resize recreates the swapchain and should not have to allocate for it
+    const QueueFamilyIndices& indicies = queueFamilyIndices;
+    uint32_t queueFamilyIndicies[3];
+    uint32_t queueFamilyCount = 0;
+    for (uint32_t family : { indicies.graphicsFamily.value(), indicies.computeFamily.value(), indicies.presentFamily.value() }) {
+        if (std::find(queueFamilyIndicies, queueFamilyIndicies + queueFamilyCount, family) == queueFamilyIndicies + queueFamilyCount) {
+            queueFamilyIndicies[queueFamilyCount++] = family;
+        }
+    }
 
-    if (indicies.graphicsFamily != indicies.presentFamily && indicies.presentFamily != indicies.transferFamily) {
+    if (queueFamilyCount > 1) {
         /*need to handle how images will be transferred between different queues
-        * so we need to draw images on the graphics queue and then submitting them to the presentation queue
+        * so we need to write images on the compute queue and then submitting them to the presentation queue
         * Two ways of handling this:
         * 1. VK_SHARING_MODE_EXCLUSIVE: an image is owned by one queue family at a time and can be transferred between groups
         * 2. VK_SHARING_MODE_CONCURRENT: images can be used across queue families without explicit ownership
         */
         createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        createInfo.queueFamilyIndexCount = 3;
+        createInfo.queueFamilyIndexCount = queueFamilyCount;
         createInfo.pQueueFamilyIndices = queueFamilyIndicies;
     }
-    else if (indicies.graphicsFamily != indicies.presentFamily && indicies.presentFamily == indicies.transferFamily) {
-        uint32_t explicitQueueFamilyInd[] = { indicies.graphicsFamily.value(), indicies.presentFamily.value() }; 
-        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT; 
-        createInfo.queueFamilyIndexCount = 2; 
-        createInfo.pQueueFamilyIndices = queueFamilyIndicies; 
-    }
     else {
         //same family is used for graphics and presenting
         createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -300,6 +650,7 @@ void HelloTriangleApplication::createSwapChain() {
     if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain");
     }
+    trackObject(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapChain, "swapChain");
 
     //get images in the newly created swapchain 
     vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
@@ -312,6 +663,10 @@ void HelloTriangleApplication::createSwapChain() {
 }
 
 void HelloTriangleApplication::recreateSwapChain() {
+    TraceZone zone(*this, "recreateSwapChain");
+    swapchainRecreationsMetric->increment();
+    objectChurnExpected = true;
+    allocationsExpected = true;
     int width = 0, height = 0; 
     //check for window minimization and wait for window size to no longer be 0
     glfwGetFramebufferSize(window, &width, &height); 
@@ -322,6 +677,11 @@ void HelloTriangleApplication::recreateSwapChain() {
     //wait for device to finish any current actions
     vkDeviceWaitIdle(device); 
 
+    //no pipeline may be rebuilt against the render pass and layouts while they are replaced
+    //rebuilds which are already done are swapped in first, so that the pipelines which are not recreated keep them
+    pauseShaderJobs();
+    updateReloadedPipelines(true);
+
     cleanupSwapChain(); 
 
     //create swap chain itself 
@@ -330,15 +690,46 @@ void HelloTriangleApplication::recreateSwapChain() {
     //image views depend directly on swap chain images so these need to be recreated
     createImageViews(); 
 
+    //scene is rendered at the size of the swap chain images
+    createPostProcessTargets();
+    createDepthAttachment();
+
+    //G-buffer has to match the size of the swap chain images
+    if (options.deferred) {
+        createGBuffer();
+    }
+
     //render pass depends on the format of swap chain images
     createRenderPass(); 
 
-    //viewport and scissor rectangle size are declared during pipeline creation, so the pipeline must be recreated
-    //can use dynamic states for viewport and scissor to avoid this 
+    //pipelines are created against the render pass, so they must be recreated as well
+    //viewport and scissor are dynamic state, so the new extent does not matter to them
     createGraphicsPipeline(); 
+    if (options.deferred) {
+        createLightingPipeline();
+    }
+    createPostProcessPipelines();
 
     createFramebuffers(); 
+
+    //per image buffers and their descriptor sets follow the number of swapchain images
+    createUniformBuffers();
+    createClusterBuffers();
+    createShadowBuffers();
+    createDescriptorPool();
+    createDescriptorSets();
+    if (options.deferred) {
+        createGBufferDescriptorSet();
+    }
+    createPostProcessDescriptorSets();
+    createHud();
+
     createCommandBuffers(); 
+    createComputeCommandBuffers();
+    createTimestampQueries();
+    createPipelineStatisticsQueries();
+
+    resumeShaderJobs();
 }
 
 bool HelloTriangleApplication::checkValidationLayerSupport() {
@@ -408,13 +799,17 @@ void HelloTriangleApplication::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    //1.1 for the feature queries of optional device extensions (vkGetPhysicalDeviceFeatures2)
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    std::vector<const char*> instanceExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    checkDebugUtilsSupport(extensions, instanceExtensions);
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
+    createInfo.ppEnabledExtensionNames = instanceExtensions.data();
     createInfo.enabledLayerCount = 0;
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -430,7 +825,7 @@ void HelloTriangleApplication::createInstance() {
         2.pointer to custom allocator callbacks, (nullptr) here
         3.pointer to the variable that stores the handle to the new object
     */
-    VkResult result = vkCreateInstance(&createInfo, nullptr, &instance);
+    VkResult result = vkCreateInstance(&createInfo, hostAllocator(), &instance);
     if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to create instance!");
     }
@@ -457,6 +852,9 @@ void HelloTriangleApplication::pickPhysicalDevice() {
     if (physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("failed to find suitable GPU!");
     }
+
+    //families do not change for the lifetime of the device, the swapchain and pools look them up here instead of querying again
+    queueFamilyIndices = findQueueFamilies(physicalDevice);
 }
 
 //Check if the given physical device is suitable for vulkan use
@@ -475,7 +873,8 @@ bool HelloTriangleApplication::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indicies = findQueueFamilies(device);
     bool extensionsSupported = checkDeviceExtensionSupport(device);
     if (extensionsSupported) {
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+        SwapChainSupportDetails swapChainSupport;
+        querySwapChainSupport(device, surface, swapChainSupport);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
     return indicies.isComplete() && extensionsSupported && swapChainAdequate;
@@ -497,6 +896,20 @@ bool HelloTriangleApplication::checkDeviceExtensionSupport(VkPhysicalDevice devi
     return requiredExtensions.empty();
 }
 
+bool HelloTriangleApplication::isDeviceExtensionAvailable(const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (std::strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 HelloTriangleApplication::QueueFamilyIndices HelloTriangleApplication::findQueueFamilies(VkPhysicalDevice device) {
     uint32_t queueFamilyCount = 0;
     QueueFamilyIndices indicies;
@@ -515,29 +928,38 @@ HelloTriangleApplication::QueueFamilyIndices HelloTriangleApplication::findQueue
         if (presentSupport) {
             indicies.presentFamily = i;
         }
-        //pick family that has graphics support
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        //pick family that has graphics support -- also needs compute for the light binning pass
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
             indicies.graphicsFamily = i;
         }
         else if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) {
             //for transfer family, pick family that does not support graphics but does support transfer queue
             indicies.transferFamily = i; 
         }
+        //compute family without graphics support: work submitted to it can overlap with the graphics queue
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            indicies.computeFamily = i;
+        }
 
         //--COULD DO :: pick a device that supports both of these in the same queue for increased performance--
         i++;
     }
 
+    //without a dedicated family, post processing is submitted to the graphics family
+    if (!indicies.computeFamily.has_value()) {
+        indicies.computeFamily = indicies.graphicsFamily;
+    }
+
     return indicies;
 }
 
 void HelloTriangleApplication::createLogicalDevice() {
     float queuePrioriy = 1.0f;
-    QueueFamilyIndices indicies = findQueueFamilies(physicalDevice);
+    QueueFamilyIndices indicies = queueFamilyIndices;
 
     //need multiple structs since we now have a seperate family for presenting and graphics 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indicies.graphicsFamily.value(), indicies.presentFamily.value(), indicies.transferFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indicies.graphicsFamily.value(), indicies.presentFamily.value(), indicies.transferFamily.value(), indicies.computeFamily.value() };
 
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         //create a struct to contain the information required 
@@ -553,6 +975,36 @@ void HelloTriangleApplication::createLogicalDevice() {
 
     //specifying device features that we want to use -- can pull any of the device features that was queried before...for now use nothing
     VkPhysicalDeviceFeatures deviceFeatures{};
+    checkPipelineStatisticsSupport(deviceFeatures);
+
+    //optional extensions are only enabled where the device has them
+    std::vector<const char*> extensions = deviceExtensions;
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures;
+    checkPipelineLibrarySupport(pipelineLibraryFeatures, extensions);
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+    checkShaderObjectSupport(shaderObjectFeatures, dynamicRenderingFeatures, extensions);
+    checkCalibratedTimestampSupport(extensions);
+    checkMemoryBudgetSupport(extensions);
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures;
+    checkMultiviewSupport(multiviewFeatures);
+    checkBatchViewSupport(deviceFeatures, extensions);
+
+    //the features of the extensions in use are chained to the create info
+    void* enabledFeatures = nullptr;
+    if (usePipelineLibraries) {
+        pipelineLibraryFeatures.pNext = enabledFeatures;
+        enabledFeatures = &pipelineLibraryFeatures;
+    }
+    if (shaderObjectsSupported) {
+        dynamicRenderingFeatures.pNext = enabledFeatures;
+        shaderObjectFeatures.pNext = &dynamicRenderingFeatures;
+        enabledFeatures = &shaderObjectFeatures;
+    }
+    if (options.views > 1) {
+        multiviewFeatures.pNext = enabledFeatures;
+        enabledFeatures = &multiviewFeatures;
+    }
 
     //Create actual logical device
     VkDeviceCreateInfo createInfo{};
@@ -560,10 +1012,11 @@ void HelloTriangleApplication::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.pNext = enabledFeatures;
 
     //specify specific instance info but it is device specific this time
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -574,13 +1027,14 @@ void HelloTriangleApplication::createLogicalDevice() {
     }
 
     //call to create the logical device 
-    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+    if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator(), &device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device");
     }
 
     vkGetDeviceQueue(device, indicies.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indicies.presentFamily.value(), 0, &presentQueue);
     vkGetDeviceQueue(device, indicies.transferFamily.value(), 0, &transferQueue);
+    vkGetDeviceQueue(device, indicies.computeFamily.value(), 0, &computeQueue);
 }
 
 uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -607,29 +1061,40 @@ uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, VkMemoryP
     throw std::runtime_error("failed to find suitable memory type"); 
 }
 
-HelloTriangleApplication::SwapChainSupportDetails HelloTriangleApplication::querySwapChainSupport(VkPhysicalDevice device) {
-    SwapChainSupportDetails details;
+VkMemoryPropertyFlags HelloTriangleApplication::findReadbackMemoryProperties() {
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryPropertyFlags cached = properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((memProperties.memoryTypes[i].propertyFlags & cached) == cached) {
+            return cached;
+        }
+    }
+    return properties;
+}
+
+void HelloTriangleApplication::querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface, SwapChainSupportDetails& details) {
     uint32_t formatCount, presentModeCount;
 
     //get surface capabilities
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
 
     vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &presentModeCount, nullptr);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+
+    //resize keeps the capacity of an earlier query, so querying again for a recreated swapchain does not allocate
+    details.formats.resize(formatCount);
+    details.presentModes.resize(presentModeCount);
 
     if (formatCount != 0) {
-        //resize vector in order to hold all available formats
-        details.formats.resize(formatCount);
         vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
     }
 
     if (presentModeCount != 0) {
-        //resize for same reasons as format 
-        details.presentModes.resize(presentModeCount);
         vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
     }
-
-    return details;
 }
 
 VkSurfaceFormatKHR HelloTriangleApplication::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
@@ -657,6 +1122,15 @@ VkPresentModeKHR HelloTriangleApplication::chooseSwapPresentMode(const std::vect
     *   Author of tutorial statement: this mode [4] is a good tradeoff if energy use is not a concern. On mobile devices it might be better to go with [2]
     */
 
+    //a replay as fast as possible must not wait for the display at all
+    if (replayHeader != nullptr && options.replayTiming == ReplayTiming::Fast) {
+        for (const auto& availablePresentMode : availablePresentModes) {
+            if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+                return availablePresentMode;
+            }
+        }
+    }
+
     for (const auto& availablePresentMode : availablePresentModes) {
         if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
             return availablePresentMode;
@@ -696,6 +1170,11 @@ VkExtent2D HelloTriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitie
 }
 
 void HelloTriangleApplication::createImageViews() {
+    //the offline outputs are only copied into
+    if (options.offline()) {
+        return;
+    }
+
     swapChainImageViews.resize(swapChainImages.size()); 
 
     //need to create an imageView for each of the images available
@@ -724,6 +1203,7 @@ void HelloTriangleApplication::createImageViews() {
         if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image views"); 
         }
+        trackObject(VK_OBJECT_TYPE_IMAGE_VIEW, swapChainImageViews[i], "swapChainImageViews");
 
     }
 }
@@ -738,49 +1218,60 @@ VkShaderModule HelloTriangleApplication::createShaderModule(const std::vector<ch
     if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
         throw std::runtime_error("failed to create shader module"); 
     }
+    trackObject(VK_OBJECT_TYPE_SHADER_MODULE, shaderModule, "createShaderModule");
 
     return shaderModule; 
 }
 
 void HelloTriangleApplication::createGraphicsPipeline() {
-    auto fragShaderCode = readFile("fragShader.spv");
-    auto vertShaderCode = readFile("vertShader.spv");
+    /* Pipeline Layout */
+    //uniform values in shaders need to be defined here 
+    //model matrix of each object is a push constant, laid out the same as in the depth only pipelines
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawPushConstants);
 
-    auto bindingDescriptions = Vertex::getBindingDescription(); 
-    auto attributeDescriptions = Vertex::getAttributeDescriptions(); 
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{}; 
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO; 
+    pipelineLayoutInfo.setLayoutCount = 1; 
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout; 
+    pipelineLayoutInfo.pushConstantRangeCount = 1; 
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange; 
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout"); 
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, "pipelineLayout");
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode); 
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode); 
+    //in the deferred path this pipeline fills the G-buffer, lighting happens in the next subpass
+    createReloadablePipeline(graphicsPipeline, { "scene", options.deferred ? "gbuffer" : "forward" }, [this]() { return buildGraphicsPipeline(); });
+}
+
+VkPipeline HelloTriangleApplication::buildGraphicsPipeline() {
+    auto bindingDescriptions = Vertex::getBindingDescriptions(); 
+    auto attributeDescriptions = Vertex::getAttributeDescriptions(); 
 
     //assign each shader module to a specific stage of the graphics pipeline
     //vert shader first
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{}; 
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO; 
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT; 
-    vertShaderStageInfo.module = vertShaderModule; 
-    vertShaderStageInfo.pName = "main"; //the function to invoke in the shader module
-    //optional member -> pSpecializationInfo: 
+    //optional member of each stage -> pSpecializationInfo: 
     //  allows specification for values to shader constants. Use a single single shader module whos function could be customized through this optional value. 
-    //  if not useing, set to nullptr which is done automatically in this case with the constructor of the struct. 
     //  Additionally: it is a good choice to use this value instead of variables so that graphics driver can remove if statements if needed for optimization
-
-    //create pipeline info for fragment shader 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{}; 
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO; 
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT; 
-    fragShaderStageInfo.module = fragShaderModule; 
-    fragShaderStageInfo.pName = "main"; 
+    //  the variant names below carry these values, see createShaderVariants
+    std::array<ShaderStage, 2> stages;
+    createShaderStage("scene", stages[0]);
+    createShaderStage(options.deferred ? "gbuffer" : "forward", stages[1]);
 
     //store these creation infos for later use 
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo }; 
+    VkPipelineShaderStageCreateInfo shaderStages[] = { stages[0].createInfo, stages[1].createInfo }; 
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; 
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO; 
     
     //pVertexBindingDescriptions and pVertexAttributeDescription -> point to arrays of structs to load vertex data
-    //for now: leaving blank as the verticies are hard coded in the shaders
-    vertexInputInfo.vertexBindingDescriptionCount = 1; 
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescriptions; 
+    //shading reads both the position and the attribute stream
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size()); 
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data(); 
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()); 
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data(); 
 
@@ -852,11 +1343,12 @@ void HelloTriangleApplication::createGraphicsPipeline() {
 
     //cullMode : type of face culling to use.
     rasterizer.cullMode = VK_CULL_MODE_BACK_BIT; 
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE; 
+    //Y is flipped in the projection matrix, which reverses the winding order of the verticies
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; 
 
     //depth values can be used in way that is known as 'shadow mapping'. 
     //rasterizer is capable of changing depth values through constant addition or biasing based on frags slope 
-    //this is left as off for now 
+    //only the shadow pipeline uses this, see createShadowPipelines
     rasterizer.depthBiasEnable = VK_FALSE; 
     rasterizer.depthBiasConstantFactor = 0.0f; //optional 
     rasterizer.depthBiasClamp = 0.0f; //optional 
@@ -876,7 +1368,15 @@ void HelloTriangleApplication::createGraphicsPipeline() {
 
     /* Depth and Stencil Testing */
     //if using depth or stencil buffer, a depth and stencil tests are neeeded
-    //not needed here 
+    //depth is already complete after the depth prepass: only the closest fragment of each pixel passes and nothing is written
+    //the prepass uses the same position math (invariant gl_Position), so the closest fragment always passes LESS_OR_EQUAL
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
 
     /* Color blending */
     // after the fragShader has returned a color, it must be combined with the color already in the framebuffer
@@ -887,16 +1387,19 @@ void HelloTriangleApplication::createGraphicsPipeline() {
     //  1. VkPipelineColorBlendAttachmentState: configuration per attached framebuffer 
     //  2. VkPipelineColorBlendStateCreateInfo: global configuration
     //only using one framebuffer in this project -- both of these are disabled in this project
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{}; 
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT; 
-    colorBlendAttachment.blendEnable = VK_FALSE; 
+    //the G-buffer subpass writes to two color attachments (albedo and normal) which need one blend state each
+    std::array<VkPipelineColorBlendAttachmentState, 2> colorBlendAttachments{}; 
+    for (auto& colorBlendAttachment : colorBlendAttachments) {
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT; 
+        colorBlendAttachment.blendEnable = VK_FALSE; 
+    }
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.attachmentCount = options.deferred ? 2 : 1;
+    colorBlending.pAttachments = colorBlendAttachments.data();
     colorBlending.blendConstants[0] = 0.0f;
     colorBlending.blendConstants[1] = 0.0f;
     colorBlending.blendConstants[2] = 0.0f;
@@ -905,9 +1408,10 @@ void HelloTriangleApplication::createGraphicsPipeline() {
     /* Dynamic State */
     //some parts of the pipeline can be changed without recreating the entire pipeline
     //if this is defined, the data for the dynamic structures will have to be provided at draw time
+    //viewport and scissor follow the render scale, which changes every frame
     VkDynamicState dynamicStates[] = {
         VK_DYNAMIC_STATE_VIEWPORT, 
-        VK_DYNAMIC_STATE_LINE_WIDTH
+        VK_DYNAMIC_STATE_SCISSOR
     }; 
     
     VkPipelineDynamicStateCreateInfo dynamicStateInfo{}; 
@@ -915,19 +1419,6 @@ void HelloTriangleApplication::createGraphicsPipeline() {
     dynamicStateInfo.dynamicStateCount = 2;
     dynamicStateInfo.pDynamicStates = dynamicStates;
 
-    /* Pipeline Layout */
-    //uniform values in shaders need to be defined here 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{}; 
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO; 
-    pipelineLayoutInfo.setLayoutCount = 0; 
-    pipelineLayoutInfo.pSetLayouts = nullptr; 
-    pipelineLayoutInfo.pushConstantRangeCount = 0; 
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; 
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout"); 
-    }
-
     /* Pipeline */
     VkGraphicsPipelineCreateInfo pipelineInfo{}; 
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO; 
@@ -939,9 +1430,9 @@ void HelloTriangleApplication::createGraphicsPipeline() {
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
     pipelineInfo.layout = pipelineLayout;
     //render pass info 
     //  ensure renderpass is compatible with pipeline --check khronos docs
@@ -953,25 +1444,34 @@ void HelloTriangleApplication::createGraphicsPipeline() {
 
     //finally creating the pipeline -- this call has the capability of creating multiple pipelines in one call
     //2nd arg is set to null -> normally for graphics pipeline cache (can be used to store and reuse data relevant to pipeline creation across multiple calls to vkCreateGraphicsPipeline)
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    //built from cached pipeline libraries where the device supports them, see linkGraphicsPipeline
+    VkPipeline pipeline;
+    if (linkGraphicsPipeline(pipelineInfo, stages.data(), &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline"); 
     }
 
     //destroy the shader modules that were created 
-    vkDestroyShaderModule(device, vertShaderModule, nullptr); 
-    vkDestroyShaderModule(device, fragShaderModule, nullptr); 
+    for (auto& stage : stages) {
+        destroyShaderStage(stage);
+    }
+
+    return pipeline;
 }
 
 void HelloTriangleApplication::createRenderPass() {
     /*  Single render pass consists of many small subpasses
         each subpasses are subsequent rendering operations that depend on the contents of framebuffers in the previous pass. 
         It is best to group these into one rendering pass, then vulkan can optimize for this in order to save memory bandwidth. 
-        For this program, we are going to stick with one subpass
+        For this program, we are going to stick with one subpass -- unless the deferred path is used
     */
+    if (options.deferred) {
+        createDeferredRenderPass();
+        return;
+    }
 
     VkAttachmentDescription colorAttachment{}; 
-    //format of color attachment needs to match the swapChain image format
-    colorAttachment.format = swapChainImageFormat; 
+    //scene is rendered into the HDR target, post processing turns it into the swapchain image
+    colorAttachment.format = HDR_FORMAT; 
     //no multisampling needed so leave at 1 samples
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT; 
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; 
@@ -999,25 +1499,42 @@ void HelloTriangleApplication::createRenderPass() {
     */
     //dont care what format image is in before render - contents of image are not guaranteed to be preserved 
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; 
-    //want image to be ready for display 
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; 
+    //want image to be ready to be sampled by the post processing chain
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; 
+
+    /* Depth attachment */
+    //filled by the depth prepass, only tested against here -- loaded, never written and not stored again
+    VkAttachmentDescription depthAttachmentDescription{};
+    depthAttachmentDescription.format = depthAttachment.format;
+    depthAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
     /* Color attachment references */
     VkAttachmentReference colorAttachmentRef{}; 
     colorAttachmentRef.attachment = 0; 
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; //will give best performance
 
+    VkAttachmentReference depthAttachmentRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
     /* Subpass */
     VkSubpassDescription subpass{}; 
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; 
     subpass.colorAttachmentCount = 1; 
     subpass.pColorAttachments = &colorAttachmentRef; 
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
     /* Render Pass */
+    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachmentDescription };
+
     VkRenderPassCreateInfo renderPassInfo{}; 
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO; 
-    renderPassInfo.attachmentCount = 1; 
-    renderPassInfo.pAttachments = &colorAttachment; 
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size()); 
+    renderPassInfo.pAttachments = attachments.data(); 
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass; 
 
@@ -1032,26 +1549,35 @@ void HelloTriangleApplication::createRenderPass() {
 
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
+    addRenderPassViews(renderPassInfo);
 
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass"); 
     }
+    trackObject(VK_OBJECT_TYPE_RENDER_PASS, renderPass, "renderPass");
 }
 
 void HelloTriangleApplication::createFramebuffers() {
-    swapChainFramebuffers.resize(swapChainImageViews.size()); 
+    swapChainFramebuffers.resize(swapChainImages.size()); 
 
     //iterate through each image and create a buffer for it 
-    for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        VkImageView attachments[] = { swapChainImageViews[i] }; 
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        std::vector<VkImageView> attachments = { hdrArrayViews[i] }; 
+        if (options.deferred) {
+            //G-buffer is shared by all framebuffers, it does not outlive a single render pass
+            attachments.push_back(gBufferAlbedo.view);
+            attachments.push_back(gBufferNormal.view);
+        }
+        //depth of the prepass is shared as well, it is rewritten at the start of every frame
+        attachments.push_back(depthArrayView);
 
         VkFramebufferCreateInfo framebufferInfo{}; 
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO; 
         //make sure that framebuffer is compatible with renderPass (same # and type of attachments)
         framebufferInfo.renderPass = renderPass; 
         //specify which vkImageView objects to bind to the attachment descriptions in the render pass pAttachment array
-        framebufferInfo.attachmentCount = 1; 
-        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size()); 
+        framebufferInfo.pAttachments = attachments.data();
         framebufferInfo.width = swapChainExtent.width; 
         framebufferInfo.height = swapChainExtent.height; 
         framebufferInfo.layers = 1; //# of layers in image arrays
@@ -1059,11 +1585,26 @@ void HelloTriangleApplication::createFramebuffers() {
         if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create framebuffer"); 
         }
+        trackObject(VK_OBJECT_TYPE_FRAMEBUFFER, swapChainFramebuffers[i], "swapChainFramebuffers");
     }
+
+    VkFramebufferCreateInfo depthFramebufferInfo{};
+    depthFramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    depthFramebufferInfo.renderPass = depthPrepassRenderPass;
+    depthFramebufferInfo.attachmentCount = 1;
+    depthFramebufferInfo.pAttachments = &depthArrayView;
+    depthFramebufferInfo.width = swapChainExtent.width;
+    depthFramebufferInfo.height = swapChainExtent.height;
+    depthFramebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(device, &depthFramebufferInfo, nullptr, &depthPrepassFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth prepass framebuffer");
+    }
+    trackObject(VK_OBJECT_TYPE_FRAMEBUFFER, depthPrepassFramebuffer, "depthPrepassFramebuffer");
 }
 
 void HelloTriangleApplication::createCommandPools() {
-    QueueFamilyIndices queueFamilyIndicies = findQueueFamilies(physicalDevice); 
+    QueueFamilyIndices queueFamilyIndicies = queueFamilyIndices; 
 
     /* Command Buffers */
     //command buffers must be submitted on one of the device queues (graphics or presentation queues in this case)
@@ -1075,12 +1616,15 @@ void HelloTriangleApplication::createCommandPools() {
     */
     //commandPoolInfo.flags = 0; //optional -- will not be changing or resetting any command buffers 
 
-    //graphics command buffer
-    createPool(queueFamilyIndicies.graphicsFamily.value(), 0, graphicsCommandPool); 
+    //graphics command buffer -- rerecorded every frame since the render area follows the render scale
+    createPool(queueFamilyIndicies.graphicsFamily.value(), VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, graphicsCommandPool); 
 
     //command buffer for transfer queue 
     createPool(queueFamilyIndicies.transferFamily.value(), 0, transferCommandPool); 
 
+    //command buffer for post processing, rerecorded every frame as well
+    createPool(queueFamilyIndicies.computeFamily.value(), VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, computeCommandPool);
+
     //temporary command pool --unused at this time
     //createPool(queueFamilyIndicies.graphicsFamily.value(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, tempCommandPool); 
 
@@ -1088,8 +1632,6 @@ void HelloTriangleApplication::createCommandPools() {
 
 void HelloTriangleApplication::createPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, VkCommandPool& pool)
 {
-    QueueFamilyIndices queueFamilyIndicies = findQueueFamilies(physicalDevice); 
-
     VkCommandPoolCreateInfo commandPoolInfo{}; 
     commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO; 
     commandPoolInfo.queueFamilyIndex = queueFamilyIndex; 
@@ -1098,6 +1640,7 @@ void HelloTriangleApplication::createPool(uint32_t queueFamilyIndex, VkCommandPo
     if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &pool) != VK_SUCCESS) {
         throw std::runtime_error("unable to create pool"); 
     }
+    trackObject(VK_OBJECT_TYPE_COMMAND_POOL, pool, "command pool");
 }
 
 
@@ -1117,87 +1660,8 @@ void HelloTriangleApplication::createCommandBuffers() {
     if (vkAllocateCommandBuffers(device, &allocInfo, graphicsCommandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers");
     }
-
-    /* Begin command buffer recording */
-    for (size_t i = 0; i < graphicsCommandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo{}; 
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO; 
-
-        //flags parameter specifies command buffer use 
-            //VK_COMMAND_BUFFER_USEAGE_ONE_TIME_SUBMIT_BIT: command buffer recorded right after executing it once
-            //VK_COMMAND_BUFFER_USEAGE_RENDER_PASS_CONTINUE_BIT: secondary command buffer that will be within a single render pass 
-            //VK_COMMAND_BUFFER_USEAGE_SIMULTANEOUS_USE_BIT: command buffer can be resubmitted while another instance has already been submitted for execution
-        beginInfo.flags = 0; 
-
-        //only relevant for secondary command buffers -- which state to inherit from the calling primary command buffers 
-        beginInfo.pInheritanceInfo = nullptr; 
-
-        /* NOTE: 
-            if the command buffer has already been recorded once, simply call vkBeginCommandBuffer->implicitly reset.
-            commands cannot be added after creation
-        */
-
-        if (vkBeginCommandBuffer(graphicsCommandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("failed to begin recording command buffer"); 
-        }
-
-        /* Begin render pass */
-        //drawing starts by beginning a render pass 
-        VkRenderPassBeginInfo renderPassInfo{}; 
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO; 
-
-        //define the render pass we want
-        renderPassInfo.renderPass = renderPass;
-
-        //what attachments do we need to bind
-        //previously created swapChainbuffers to hold this information 
-        renderPassInfo.framebuffer = swapChainFramebuffers[i]; 
-
-        //define size of render area -- should match size of attachments for best performance
-        renderPassInfo.renderArea.offset = { 0, 0 }; 
-        renderPassInfo.renderArea.extent = swapChainExtent; 
-
-        //clear color for background color will be used with VK_ATTACHMENT_LOAD_OP_CLEAR
-        VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-        renderPassInfo.clearValueCount = 1; 
-        renderPassInfo.pClearValues = &clearColor; 
-
-        /* vkCmdBeginRenderPass */
-        //Args: 
-            //1. command buffer to set recording to 
-            //2. details of the render pass
-            //3. how drawing commands within the render pass will be provided
-                //OPTIONS: 
-                    //VK_SUBPASS_CONTENTS_INLINE: render pass commands will be embedded in the primary command buffer. No secondary command buffers executed 
-                    //VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: render pass commands will be executed from the secondary command buffers
-        vkCmdBeginRenderPass(graphicsCommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); 
-
-        /* Drawing Commands */
-        //Args: 
-            //2. compute or graphics pipeline
-            //3. pipeline object
-        vkCmdBindPipeline(graphicsCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline); 
-
-        VkBuffer vertexBuffers[] = { vertexBuffer }; 
-        VkDeviceSize offsets[] = { 0 }; 
-        vkCmdBindVertexBuffers(graphicsCommandBuffers[i], 0, 1, vertexBuffers, offsets); 
-
-
-        //now create call to draw triangle
-        //Args:    
-            //2. vertexCount: how many verticies to draw
-            //3. instanceCount: used for instanced render, use 1 otherwise
-            //4. firstVertex: offset in VBO, defines lowest value of gl_VertexIndex
-            //5. firstInstance: offset for instanced rendering, defines lowest value of gl_InstanceIndex
-        vkCmdDraw(graphicsCommandBuffers[i], static_cast<uint32_t>(vertices.size()), 1, 0, 0);
-
-        //can now finis render pass
-        vkCmdEndRenderPass(graphicsCommandBuffers[i]); 
-
-        //record command buffer
-        if (vkEndCommandBuffer(graphicsCommandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer"); 
-        }
+    for (auto commandBuffer : graphicsCommandBuffers) {
+        trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer, "graphicsCommandBuffers");
     }
 
     /* Transfer Command Buffer */
@@ -1210,25 +1674,164 @@ void HelloTriangleApplication::createCommandBuffers() {
 
     //if (vkAllocateCommandBuffers(device, &transferAllocInfo, &transferCommandBuffers)); 
 
+    //commands are recorded in drawFrame, see recordCommandBuffer
+}
+
+void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex) {
+    VkCommandBuffer commandBuffer = graphicsCommandBuffers[imageIndex];
+
+    VkCommandBufferBeginInfo beginInfo{}; 
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO; 
+
+    //flags parameter specifies command buffer use 
+        //VK_COMMAND_BUFFER_USEAGE_ONE_TIME_SUBMIT_BIT: command buffer recorded right after executing it once
+        //VK_COMMAND_BUFFER_USEAGE_RENDER_PASS_CONTINUE_BIT: secondary command buffer that will be within a single render pass 
+        //VK_COMMAND_BUFFER_USEAGE_SIMULTANEOUS_USE_BIT: command buffer can be resubmitted while another instance has already been submitted for execution
+    //rerecorded every frame, so it is only ever submitted once per recording
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; 
+
+    //only relevant for secondary command buffers -- which state to inherit from the calling primary command buffers 
+    beginInfo.pInheritanceInfo = nullptr; 
+
+    /* NOTE: 
+        if the command buffer has already been recorded once, simply call vkBeginCommandBuffer->implicitly reset.
+        commands cannot be added after creation
+    */
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer"); 
+    }
+
+    //GPU time of the scene, read back the next time this image is used
+    if (graphicsTimestampMask != 0) {
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE);
+    }
+    if (pipelineStatisticsQueryPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, pipelineStatisticsQueryPool, imageIndex * PIPELINE_STATISTICS_PER_IMAGE, PIPELINE_STATISTICS_PER_IMAGE);
+    }
+
+    /* Begin render pass */
+    //drawing starts by beginning a render pass 
+    VkRenderPassBeginInfo renderPassInfo{}; 
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO; 
+
+    //define the render pass we want
+    renderPassInfo.renderPass = renderPass;
+
+    //what attachments do we need to bind
+    //previously created swapChainbuffers to hold this information 
+    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex]; 
+
+    //define size of render area -- should match size of attachments for best performance
+    //the attachments are sized for the largest render scale, only the top left corner covered by the current scale is rendered
+    //with several views each layer only takes the width of its column of the frame
+    renderPassInfo.renderArea.offset = { 0, 0 }; 
+    renderPassInfo.renderArea.extent = viewExtent; 
+
+    //clear color for background color will be used with VK_ATTACHMENT_LOAD_OP_CLEAR
+    //deferred path also clears the G-buffer, indexed the same as the attachments of the render pass -- depth is loaded, not cleared
+    std::array<VkClearValue, 3> clearValues{};
+    clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+    clearValues[1].color = { {0.0f, 0.0f, 0.0f, 0.0f} };
+    clearValues[2].color = { {0.0f, 0.0f, 0.0f, 0.0f} };
+    renderPassInfo.clearValueCount = options.deferred ? 3 : 1; 
+    renderPassInfo.pClearValues = clearValues.data(); 
+
+    /* vkCmdBeginRenderPass */
+    //Args: 
+        //1. command buffer to set recording to 
+        //2. details of the render pass
+        //3. how drawing commands within the render pass will be provided
+            //OPTIONS: 
+                //VK_SUBPASS_CONTENTS_INLINE: render pass commands will be embedded in the primary command buffer. No secondary command buffers executed 
+                //VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: render pass commands will be executed from the secondary command buffers
+    //depth prepass, cascade fit and shadow passes all come first: the main render pass tests against their depth and samples their shadows
+    recordShadowPasses(commandBuffer, imageIndex);
+
+    //lights have to be binned before the render pass begins, compute dispatches are not allowed inside of a render pass
+    recordLightBinning(commandBuffer, imageIndex);
+
+    beginPassStatistics(commandBuffer, imageIndex, ScenePass::Main);
+    //the render pass, or with shader objects the same attachments begun through dynamic rendering
+    beginScenePass(commandBuffer, ScenePass::Main, renderPassInfo, imageIndex);
+
+    /* Drawing Commands */
+    //viewport and scissor are dynamic state so that they can follow the render scale without recreating the pipelines
+    VkViewport viewport{};
+    viewport.width = (float)viewExtent.width;
+    viewport.height = (float)viewExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = viewExtent;
+
+    //graphicsPipeline, or the scene shader objects with the same state
+    bindScenePass(commandBuffer, ScenePass::Main, viewport, scissor);
+
+    //bind the camera, lights, light grid and shadows for this image
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+
+    //now create calls to draw the scene, one per object
+    //vkCmdDraw Args:    
+        //2. vertexCount: how many verticies to draw
+        //3. instanceCount: used for instanced render, use 1 otherwise
+        //4. firstVertex: offset in VBO, defines lowest value of gl_VertexIndex
+        //5. firstInstance: offset for instanced rendering, defines lowest value of gl_InstanceIndex
+    recordSceneDraws(commandBuffer, pipelineLayout, false, CAMERA_VIEW);
+
+    if (options.deferred) {
+        //lighting subpass: one fullscreen triangle which reads the G-buffer of the pixel it covers
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipeline);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkDescriptorSet lightingSets[] = { descriptorSets[imageIndex], gBufferDescriptorSet };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipelineLayout, 0, 2, lightingSets, 0, nullptr);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
+
+    //can now finis render pass
+    endScenePass(commandBuffer, ScenePass::Main, imageIndex);
+    endPassStatistics(commandBuffer, imageIndex, ScenePass::Main);
+
+    if (graphicsTimestampMask != 0) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 1);
+    }
+
+    //record command buffer
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer"); 
+    }
 }
 
 void HelloTriangleApplication::createSemaphores() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT); 
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT); 
+    imageAvailableSemaphores.resize(framesInFlight); 
+    renderFinishedSemaphores.resize(framesInFlight); 
+    sceneFinishedSemaphores.resize(framesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo{}; 
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO; 
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < framesInFlight; i++) {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS || vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i])) {
             throw std::runtime_error("failed to create semaphores for a frame");
         }
+        trackObject(VK_OBJECT_TYPE_SEMAPHORE, imageAvailableSemaphores[i], "imageAvailableSemaphores");
+        trackObject(VK_OBJECT_TYPE_SEMAPHORE, renderFinishedSemaphores[i], "renderFinishedSemaphores");
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &sceneFinishedSemaphores[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create semaphores for a frame");
+        }
+        trackObject(VK_OBJECT_TYPE_SEMAPHORE, sceneFinishedSemaphores[i], "sceneFinishedSemaphores");
     }
 }
 
 void HelloTriangleApplication::createFences() {
     //note: fence creation can be rolled into semaphore creation. Seperated for understanding
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT); 
+    inFlightFences.resize(framesInFlight); 
 
     VkFenceCreateInfo fenceInfo{}; 
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO; 
@@ -1236,10 +1839,11 @@ void HelloTriangleApplication::createFences() {
     //create the fence in a signaled state 
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; 
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < framesInFlight; i++) {
         if (vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create fence object for a frame"); 
         }
+        trackObject(VK_OBJECT_TYPE_FENCE, inFlightFences[i], "inFlightFences");
     }
 }
 
@@ -1254,7 +1858,11 @@ void HelloTriangleApplication::createFenceImageTracking() {
 }
 
 void HelloTriangleApplication::createVertexBuffer() {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    //two streams in one buffer: every position first, then every other attribute
+    //depth only passes bind just the first stream, so they never fetch the bytes they do not use
+    VkDeviceSize positionSize = sizeof(glm::vec3) * vertices.size();
+    VkDeviceSize bufferSize = positionSize + sizeof(VertexAttributes) * vertices.size();
+    vertexAttributeOffset = positionSize;
 
     VkBuffer stagingBuffer; 
     VkDeviceMemory stagingBufferMemory; 
@@ -1267,7 +1875,12 @@ void HelloTriangleApplication::createVertexBuffer() {
     //can also specify VK_WHOLE_SIZE to map all memory 
     //currrently no memory flags available in API (time of writing) so must be set to 0
     vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data); 
-    memcpy(data, vertices.data(), (size_t)bufferSize); //simply copy data into mapped memory
+    glm::vec3* positions = static_cast<glm::vec3*>(data);
+    VertexAttributes* attributes = reinterpret_cast<VertexAttributes*>(static_cast<char*>(data) + vertexAttributeOffset);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].pos;
+        attributes[i] = vertices[i].attributes;
+    }
     vkUnmapMemory(device, stagingBufferMemory); //unmap memory
 
     /* Staging Buffer */
@@ -1279,7 +1892,9 @@ void HelloTriangleApplication::createVertexBuffer() {
     copyBuffer(stagingBuffer, vertexBuffer, bufferSize); //actually call to copy memory
 
     //cleanup 
+    untrackObject(VK_OBJECT_TYPE_BUFFER, stagingBuffer);
     vkDestroyBuffer(device, stagingBuffer, nullptr); 
+    untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, stagingBufferMemory);
     vkFreeMemory(device, stagingBufferMemory, nullptr); 
 
     /* Memory Copy Note */
@@ -1305,6 +1920,7 @@ void HelloTriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlag
     if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer");
     }
+    trackObject(VK_OBJECT_TYPE_BUFFER, buffer, "createBuffer");
 
     //need to allocate memory for the buffer object
     /* VkMemoryRequirements:
@@ -1324,6 +1940,7 @@ void HelloTriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlag
     if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate buffer memory");
     }
+    trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, bufferMemory, "createBuffer memory");
 
     //4th argument: offset within the region of memory. Since memory is allocated specifically for this vertex buffer, the offset is 0
     //if not 0, required to be divisible by memRequirenments.alignment
@@ -1332,6 +1949,9 @@ void HelloTriangleApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlag
 
 void HelloTriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
+    //the transfer queue can not reset queries, so the copy only shows on the CPU timeline -- submit and wait included
+    TraceZone zone(*this, "copyBuffer");
+
     //allocate using temporary command pool
     VkCommandBufferAllocateInfo allocInfo{}; 
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO; 
@@ -1341,6 +1961,7 @@ void HelloTriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer
 
     VkCommandBuffer transferBuffer; 
     vkAllocateCommandBuffers(device, &allocInfo, &transferBuffer);
+    trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, transferBuffer, "copyBuffer");
 
     VkCommandBufferBeginInfo beginInfo{}; 
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO; 
@@ -1364,6 +1985,8 @@ void HelloTriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer
     submitInfo.pCommandBuffers = &transferBuffer;
 
     vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE); 
+    transferSubmitsMetric->increment();
+    uploadBytesMetric->increment(static_cast<double>(size));
 
     /*Note about waiting for complete*/
     /*Can be done two ways 
@@ -1372,10 +1995,340 @@ void HelloTriangleApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer
     */
     vkQueueWaitIdle(transferQueue);
 
-    //cleanup 
+    //cleanup
+    untrackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, transferBuffer);
     vkFreeCommandBuffers(device, transferCommandPool, 1, &transferBuffer);
 }
 
+void HelloTriangleApplication::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, 
+    VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, const std::vector<uint32_t>& queueFamilies, uint32_t arrayLayers) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = arrayLayers;
+    imageInfo.format = format;
+    imageInfo.tiling = tiling;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    //same choice as for the swap chain images: concurrent sharing avoids explicit ownership transfers between queue families
+    if (queueFamilies.size() > 1) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        imageInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
+    else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image");
+    }
+    trackObject(VK_OBJECT_TYPE_IMAGE, image, "createImage");
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate image memory");
+    }
+    trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, imageMemory, "createImage memory");
+
+    vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+VkImageView HelloTriangleApplication::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevel,
+    VkImageViewType viewType, uint32_t layerCount) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = viewType;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspectFlags;
+    viewInfo.subresourceRange.baseMipLevel = mipLevel;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = layerCount;
+
+    VkImageView imageView;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image view");
+    }
+    trackObject(VK_OBJECT_TYPE_IMAGE_VIEW, imageView, "createImageView");
+
+    return imageView;
+}
+
+void HelloTriangleApplication::destroyAttachment(ImageAttachment& attachment) {
+    untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, attachment.view);
+    vkDestroyImageView(device, attachment.view, nullptr);
+    untrackObject(VK_OBJECT_TYPE_IMAGE, attachment.image);
+    vkDestroyImage(device, attachment.image, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, attachment.memory);
+    vkFreeMemory(device, attachment.memory, nullptr);
+
+    attachment = ImageAttachment();
+}
+
+VkFormat HelloTriangleApplication::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
+    for (VkFormat format : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+        if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
+            return format;
+        }
+        else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("failed to find supported format");
+}
+
+VkFormat HelloTriangleApplication::findDepthFormat() {
+    return findSupportedFormat(
+        { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+        VK_IMAGE_TILING_OPTIMAL,
+        //also sampled by the cascade fit
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+    );
+}
+
+void HelloTriangleApplication::createDescriptorSetLayout() {
+    /* Bindings */
+    //0. camera uniform buffer
+    //1. lights
+    //2. light grid: (offset, count) for each cluster
+    //3. light index list
+    //4. light index list counter -- only used while binning
+    //5. shadow map cascades
+    //6. shadow cascade matrices and splits
+    //7. depth of the depth prepass -- only used by the cascade fit
+    //8. min and max of that depth -- only used by the cascade fit
+    std::array<VkDescriptorSetLayoutBinding, 9> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr; //only relevant for image sampling
+    }
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[6].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT; //the shadow passes render with the cascade matrices
+    bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[8].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, descriptorSetLayout, "descriptorSetLayout");
+
+    /* G-buffer input attachments */
+    //0. albedo
+    //1. normal
+    //2. depth
+    std::array<VkDescriptorSetLayoutBinding, 3> gBufferBindings{};
+    for (uint32_t i = 0; i < gBufferBindings.size(); i++) {
+        gBufferBindings[i].binding = i;
+        gBufferBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        gBufferBindings[i].descriptorCount = 1;
+        gBufferBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT; //input attachments can only be read from fragment shaders
+    }
+
+    VkDescriptorSetLayoutCreateInfo gBufferLayoutInfo{};
+    gBufferLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    gBufferLayoutInfo.bindingCount = static_cast<uint32_t>(gBufferBindings.size());
+    gBufferLayoutInfo.pBindings = gBufferBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &gBufferLayoutInfo, nullptr, &gBufferSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create G-buffer descriptor set layout");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, gBufferSetLayout, "gBufferSetLayout");
+}
+
+void HelloTriangleApplication::createUniformBuffers() {
+    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+
+    uniformBuffers.resize(swapChainImages.size());
+    uniformBuffersMemory.resize(swapChainImages.size());
+
+    //data is updated every frame, so no staging buffer is used here
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+    }
+}
+
+void HelloTriangleApplication::createDescriptorPool() {
+    uint32_t imageCount = static_cast<uint32_t>(swapChainImages.size());
+
+    std::array<VkDescriptorPoolSize, 4> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = imageCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = imageCount * 6;
+    //single G-buffer set for the deferred path
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    poolSizes[2].descriptorCount = 3;
+    //shadow map and prepass depth
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[3].descriptorCount = imageCount * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = imageCount + 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, descriptorPool, "descriptorPool");
+}
+
+void HelloTriangleApplication::createDescriptorSets() {
+    std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(swapChainImages.size());
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets");
+    }
+
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        //indexed by binding, the entries of the two image bindings are left empty
+        std::array<VkDescriptorBufferInfo, 9> bufferInfos{};
+        bufferInfos[0].buffer = uniformBuffers[i];
+        bufferInfos[1].buffer = lightBuffers[i];
+        bufferInfos[2].buffer = lightGridBuffers[i];
+        bufferInfos[3].buffer = lightIndexBuffers[i];
+        bufferInfos[4].buffer = lightCounterBuffers[i];
+        bufferInfos[6].buffer = cascadeBuffers[i];
+        bufferInfos[8].buffer = depthBoundsBuffers[i];
+
+        std::array<VkDescriptorImageInfo, 2> imageInfos{};
+        imageInfos[0].sampler = shadowSampler;
+        imageInfos[0].imageView = shadowMap.view;
+        imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        //any non comparing sampler will do, the fit only uses texelFetch
+        imageInfos[1].sampler = postSampler;
+        imageInfos[1].imageView = depthAttachment.view;
+        imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        std::array<VkWriteDescriptorSet, 9> descriptorWrites{};
+        for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+            bufferInfos[j].offset = 0;
+            bufferInfos[j].range = VK_WHOLE_SIZE;
+
+            descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[j].dstSet = descriptorSets[i];
+            descriptorWrites[j].dstBinding = j;
+            descriptorWrites[j].dstArrayElement = 0;
+            descriptorWrites[j].descriptorType = (j == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[j].descriptorCount = 1;
+            descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+        }
+        for (uint32_t j = 0; j < imageInfos.size(); j++) {
+            VkWriteDescriptorSet& imageWrite = descriptorWrites[j == 0 ? 5 : 7];
+            imageWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            imageWrite.pBufferInfo = nullptr;
+            imageWrite.pImageInfo = &imageInfos[j];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage) {
+    static auto startTime = Clock::now();
+    float time = std::chrono::duration<float, std::chrono::seconds::period>(Clock::now() - startTime).count();
+    if (replayFrame != nullptr) {
+        time = replayFrame->time;
+    }
+    //every tile of a poster shows the same moment
+    else if (options.posterWidth > 0) {
+        time = 0.0f;
+    }
+    //offline frames take however long they take, the scene moves on by the same step in each
+    else if (options.offlineFrames > 0) {
+        time = static_cast<float>(frameNumber / options.offlineFrameRate);
+    }
+
+    /* Camera */
+    //looking slightly down, so that the floor and the shadows on it are in view
+    UniformBufferObject ubo{};
+    glm::vec3 eye(0.0f, 0.4f, 2.0f);
+    glm::vec3 target(0.0f, -0.1f, 0.0f);
+    ubo.view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    //each view fills a column of the frame, so it is only as wide as its share of it
+    float aspect = swapChainExtent.width / static_cast<float>(options.views) / (float)swapChainExtent.height;
+    ubo.proj = glm::perspective(glm::radians(45.0f), aspect, CAMERA_NEAR, CAMERA_FAR);
+    //glm was designed for openGL where the Y coordinate of the clip coordinates is inverted
+    ubo.proj[1][1] *= -1;
+    if (options.posterWidth > 0) {
+        ubo.proj = posterTileProjection(frameNumber);
+    }
+    ubo.invProj = glm::inverse(ubo.proj);
+    ubo.invView = glm::inverse(ubo.view);
+    //aspect ratio is the same at every render scale, but the clusters and the lighting pass work in rendered pixels
+    ubo.screenSize = glm::vec4((float)viewExtent.width, (float)viewExtent.height, CAMERA_NEAR, CAMERA_FAR);
+    ubo.clusterGrid = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, static_cast<uint32_t>(lights.size()));
+    updateViewProjections(ubo, eye, target);
+
+    /* Scene and Shadows */
+    //objects have to be in place before the cascades can tell which of them need to be rendered again
+    if (replayFrame != nullptr) {
+        applyReplayFrame();
+    }
+    else {
+        updateScene(time);
+    }
+    captureFrame(time);
+    updateShadowCascades(currentImage, ubo);
+
+    void* data;
+    vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
+    memcpy(data, &ubo, sizeof(ubo));
+    vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+
+    /* Lights */
+    //each light circles around its starting position at its own speed
+    PointLight* mappedLights = static_cast<PointLight*>(lightBuffersMapped[currentImage]);
+    for (size_t i = 0; i < lights.size(); i++) {
+        float speed = 0.5f + 0.25f * static_cast<float>(i % 5);
+        float phase = static_cast<float>(i) * 0.618f;
+        glm::vec3 offset = 0.25f * glm::vec3(glm::cos(time * speed + phase), glm::sin(time * speed + phase), 0.0f);
+
+        mappedLights[i].positionRadius = lights[i].positionRadius + glm::vec4(offset, 0.0f);
+        mappedLights[i].color = lights[i].color;
+    }
+}
+
 
 #pragma region Unused Functions
 /* LEFT FOR FUTURE NOTE
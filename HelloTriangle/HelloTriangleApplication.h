@@ -1,7 +1,12 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+
+//glm defaults to OpenGL conventions, vulkan uses radians and a depth range of 0.0 to 1.0
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -14,46 +19,584 @@
 #include <array>
 #include <optional>
 #include <set>
+#include <map>
+#include <unordered_map>
+#include <random>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
 
 #include <chrono>
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
+//views the scene passes can render at once with multiview, sizes the camera array of the uniform buffer
+const uint32_t MAX_VIEWS = 4;
+
+//frames the CPU records ahead of the GPU unless --frames-in-flight says otherwise. Offline nothing waits on a display, so more are kept
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t OFFLINE_FRAMES_IN_FLIGHT = 4;
+
+//pixels rendered around every tile of a poster and left out of the file, so that effects which spread across the screen, like the bloom,
+//carry over the seams between tiles
+const uint32_t POSTER_TILE_MARGIN = 64;
+
+//frames the benchmarks render before they start timing, lets the clocks and caches settle, then the frames they average
+const int BENCHMARK_WARMUP_FRAMES = 30;
+const int BENCHMARK_FRAMES = 240;
+
+/// <summary>
+/// Filter used to scale the scene from the render resolution up to the swapchain resolution. 
+/// Values match the UPSCALE_FILTER specialization constant of upscale.comp.
+/// </summary>
+enum class UpscaleFilter : uint32_t {
+    Bilinear = 0,
+    Lanczos = 1,
+    EdgeAware = 2
+};
+
+/// <summary>
+/// What the scene shaders output instead of the lit color, for inspecting the renderer. 
+/// Values match the DEBUG_VIEW specialization constant of clusteredLighting.glsl.
+/// </summary>
+enum class DebugView : uint32_t {
+    None = 0,
+    Normals = 1,
+    Cascades = 2,
+    LightCount = 3
+};
+
+/// <summary>
+/// How the frames of a capture are paced when it is replayed
+/// </summary>
+enum class ReplayTiming {
+    Fast,       //every frame starts as soon as the last one is submitted, without waiting for vsync
+    Recorded    //frames start at the same times after the first one as they did while capturing
+};
+
+/// <summary>
+/// Parameters of the generated stress scene, see StressScene.cpp
+/// </summary>
+struct StressSceneOptions {
+    uint32_t meshes = 64;
+    uint32_t instances = 16;            //objects drawn of every mesh
+    uint32_t materials = 8;             //colors in the palette the meshes pick from
+    float dynamicFraction = 0.1f;       //share of the objects which move every frame
+    float minTriangleSize = 0.02f;      //world size of the triangles of a mesh, drawn per mesh log-uniformly between these
+    float maxTriangleSize = 0.2f;
+    uint32_t seed = 1;
+};
+
+/// <summary>
+/// Settings which are picked at startup from the command line
+/// </summary>
+struct ApplicationOptions {
+    //shade with a G-buffer subpass followed by a lighting subpass instead of shading while rasterizing (forward)
+    bool deferred = false;
+
+    //adapt the render resolution every frame to keep the GPU time of a frame within gpuBudget (milliseconds)
+    bool dynamicResolution = false;
+    float gpuBudget = 14.0f;
+    float minRenderScale = 0.5f;
+    UpscaleFilter upscaleFilter = UpscaleFilter::Lanczos;
+
+    //feature toggles of the scene shaders, these pick the shader variants the pipelines are created with
+    bool shadows = true;
+    DebugView debugView = DebugView::None;
+
+    //GLSL sources are compiled at startup from this directory, and compiled again whenever one of them changes (hot reload)
+    std::string shaderDirectory = "shaders";
+    bool hotReload = true;
+    //run the SPIR-V of the compiled sources through the spirv-opt performance passes
+    bool optimizeShaders = true;
+    //instead of running normally, compare pipeline creation and GPU time of unoptimized and optimized SPIR-V, then exit
+    bool shaderBenchmark = false;
+
+    //build graphics pipelines from cached VK_EXT_graphics_pipeline_library parts where the device supports it
+    bool pipelineLibraries = true;
+
+    //draw the scene passes with VK_EXT_shader_object and fully dynamic state instead of pipelines, where the device supports it
+    bool shaderObjects = false;
+    //instead of running normally, compare CPU recording time and GPU time of the scene with pipelines and with shader objects, then exit
+    bool shaderObjectBenchmark = false;
+
+    //when set, CPU zones and GPU ranges are recorded and written to this file as Chrome trace JSON -- on F12 and at exit
+    std::string traceFile;
+
+    //count the vertices, primitives and shader invocations of every scene pass, printed along with the frame rate
+    bool pipelineStatistics = false;
+
+    //when set, the renderer metrics are written to this file in the Prometheus text format every second (node_exporter textfile collector)
+    std::string metricsFile;
+
+    //draw frame times, GPU pass times and memory use over the image, F1 hides and shows it
+    bool hud = false;
+
+    //keep a registry of every Vulkan object: names them for the validation layers, reports objects created in steady-state frames and leaks at exit
+    bool trackObjects = false;
+
+    //when set, the scene and the per-frame inputs of the run are written to this file, see Capture.cpp
+    std::string captureFile;
+    //when set, the frames of this capture are rendered in a hidden window instead of running normally, then the frame times are printed
+    std::string replayFile;
+    ReplayTiming replayTiming = ReplayTiming::Fast;
+
+    //draw a generated scene instead of the built-in one, for measuring how the renderer scales -- any --stress-* option turns it on
+    bool stressScene = false;
+    StressSceneOptions stress;
+
+    //count the heap allocations of every frame, Vulkan host allocations included, and fail at exit if a frame after the warmup made any
+    bool checkAllocations = false;
+    //stop the main loop after this many frames, 0 runs until the window is closed
+    uint64_t frameLimit = 0;
+
+    //a frame which takes longer than this (milliseconds) writes the frames around it from the flight recorder to hitchDirectory, 0 turns it off
+    float hitchThreshold = 50.0f;
+    std::string hitchDirectory = ".";
+
+    //extra windows which show the same frames as the main one, e.g. one per monitor of a control room
+    uint32_t displays = 0;
+
+    //cameras the scene is rendered from in a single multiview pass, shown side by side. 2 with the default separation is a stereo pair
+    uint32_t views = 1;
+    float viewSeparation = 0.065f;  //world distance from one camera to the next, along the right axis of the main camera
+
+    //instead of running normally, render batchCount batches of batchViews small square views offscreen and read them back, see BatchViews.cpp
+    uint32_t batchViews = 0;
+    uint32_t batchViewSize = 128;   //pixels, width and height of a view
+    uint64_t batchCount = 100;
+    //when set, every view read back is written to this directory as a PPM image
+    std::string batchDirectory;
+
+    //frames recorded ahead of the GPU, 0 takes the default of the mode
+    uint32_t framesInFlight = 0;
+
+    //instead of running normally, render offlineFrames frames of offlineWidth x offlineHeight without presenting and write each to
+    //offlineDirectory as a QOI image, see Offline.cpp
+    uint64_t offlineFrames = 0;
+    uint32_t offlineWidth = 1920;
+    uint32_t offlineHeight = 1080;
+    std::string offlineDirectory = ".";
+    float offlineFrameRate = 60.0f;     //scene time between two frames is 1 / rate, however long they take to render
+    uint32_t ioThreads = 0;             //threads which compress and write the frames, 0 takes one per core the renderer does not use
+
+    //instead of running normally, render a posterWidth x posterHeight image in tiles of posterTileSize, so it can be far larger than the
+    //device renders at once, and stream the tiles into posterFile as a tiled BigTIFF, see Poster.cpp
+    uint32_t posterWidth = 0;
+    uint32_t posterHeight = 0;
+    uint32_t posterTileSize = 2048;     //a multiple of 16, as TIFF tiles have to be
+    std::string posterFile = "poster.tif";
+
+    /// <summary>
+    /// Frames are rendered for files and never presented: the offline frames, and the tiles of a poster
+    /// </summary>
+    bool offline() const { return offlineFrames > 0 || posterWidth > 0; }
+};
 
 class HelloTriangleApplication
 {
 
 public:
+    HelloTriangleApplication(const ApplicationOptions& options = ApplicationOptions()) : options(options),
+        framesInFlight(options.framesInFlight != 0 ? options.framesInFlight : (options.offline() ? OFFLINE_FRAMES_IN_FLIGHT : DEFAULT_FRAMES_IN_FLIGHT)) {}
 
     void run(); 
 
 private:
+    const ApplicationOptions options;
+
+    /// <summary>
+    /// Image along with its backing memory and view. Used for attachments which are not owned by the swapchain.
+    /// </summary>
+    struct ImageAttachment {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+    };
+
+    /// <summary>
+    /// Value of one specialization constant, declared in the shader as layout(constant_id = id). Bools are 32 bits in SPIR-V as well.
+    /// </summary>
+    struct SpecializationConstant {
+        uint32_t id;
+        uint32_t value;
+    };
+
+    /// <summary>
+    /// A shader along with the values of its feature toggles. The constants are folded when the pipeline is compiled, 
+    /// so every variant runs branch free code without a source file for each combination of features.
+    /// The SPIR-V file is the one compile.bat produces, only loaded when the GLSL source can not be compiled at runtime.
+    /// </summary>
+    struct ShaderVariant {
+        std::string sourceFile;
+        std::string spirvFile;
+        VkShaderStageFlagBits stage;
+        std::vector<SpecializationConstant> constants;
+    };
+
+    /// <summary>
+    /// Shader module of a variant along with the specialization data its create info points into. 
+    /// Filled in place by createShaderStage, so it must stay where it is until the pipeline using it has been created.
+    /// </summary>
+    struct ShaderStage {
+        std::vector<char> code;         //kept for the pipeline library keys and for shader objects, which take the SPIR-V directly
+        VkShaderModule module = VK_NULL_HANDLE;
+        std::vector<VkSpecializationMapEntry> mapEntries;
+        std::vector<uint32_t> data;
+        VkSpecializationInfo specializationInfo{};
+        VkPipelineShaderStageCreateInfo createInfo{};
+    };
+
+    /// <summary>
+    /// Pipeline which is built again in the background when the source of one of its shader variants changes. 
+    /// The generation goes up every time the pipeline is created again along with the swapchain, rebuilds of an older generation are dropped.
+    /// </summary>
+    struct ReloadablePipeline {
+        VkPipeline* pipeline;
+        std::vector<std::string> variantNames;
+        std::function<VkPipeline()> build;
+        uint32_t generation = 0;
+    };
+
+    /// <summary>
+    /// Pipeline built by a shader worker, waiting for the render loop to swap it in
+    /// </summary>
+    struct RebuiltPipeline {
+        VkPipeline* target;
+        VkPipeline pipeline;
+        uint32_t generation;
+        //when set, only swapped in while the target still holds this pipeline: an optimized link must not replace a newer rebuild
+        VkPipeline replaces = VK_NULL_HANDLE;
+    };
+
+    /// <summary>
+    /// One of the four parts of a graphics pipeline (vertex input, pre-rasterization shaders, fragment shader, fragment output), 
+    /// compiled on its own and shared by every pipeline with the same state for that part
+    /// </summary>
+    struct PipelineLibrary {
+        VkPipeline library;
+        VkRenderPass renderPass;        //destroyed along with this render pass, VK_NULL_HANDLE for the vertex input
+    };
+
+    /// <summary>
+    /// One span of a timeline: a CPU zone, or a GPU range moved onto the CPU clock. 
+    /// Times are nanoseconds of std::chrono::steady_clock, the name must be a string literal as only the pointer is kept.
+    /// </summary>
+    struct TraceEvent {
+        const char* name;
+        int64_t start;
+        int64_t end;
+    };
+
+    /// <summary>
+    /// Events of one timeline (a thread, or a queue of the GPU) in a ring which only one thread writes, so recording takes no lock. 
+    /// The head is published after every event, which lets the trace be exported while it is written.
+    /// </summary>
+    struct TraceBuffer {
+        std::string name;
+        uint32_t id;
+        std::vector<TraceEvent> events;
+        std::atomic<uint64_t> head{ 0 };
+    };
+
+    /// <summary>
+    /// Records the time from its construction to the end of its scope as a zone of the calling thread. Does nothing unless tracing.
+    /// </summary>
+    struct TraceZone {
+        TraceZone(HelloTriangleApplication& app, const char* name);
+        ~TraceZone();
+
+        HelloTriangleApplication& app;
+        const char* name;
+        int64_t start;
+    };
+
+    /// <summary>
+    /// Parts of drawFrame timed by the flight recorder, in the order they run
+    /// </summary>
+    enum class FramePhase : uint32_t {
+        FrameFence,
+        Acquire,
+        ImageFence,
+        Update,
+        Record,
+        GraphicsSubmit,
+        ComputeSubmit,
+        Present,
+        Count
+    };
+
+    /// <summary>
+    /// What the flight recorder keeps of one frame. Times are nanoseconds of traceTime, 0 for a phase the frame did not get to.
+    /// </summary>
+    struct FlightRecord {
+        uint64_t frame;
+        int64_t start;
+        int64_t phaseEnds[static_cast<size_t>(FramePhase::Count)];
+        float interval;             //milliseconds from the start of this frame to the start of the next one, 0 until it is known
+        float gpuSceneTime;         //milliseconds, filled in a few frames later once the timestamps have been read back
+        float gpuPostTime;
+        uint32_t submits;
+        uint64_t uploadBytes;
+        uint64_t heapAllocations;
+        float renderScale;
+        bool swapchainRecreated;
+    };
+
+    /// <summary>
+    /// Extra window of options.displays with a swapchain of its own. The output of the frame is copied into it, so it costs a copy on the GPU
+    /// and nothing on the CPU but its acquire.
+    /// </summary>
+    struct DisplayWindow {
+        GLFWwindow* window = nullptr;
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        VkSwapchainKHR swapChain = VK_NULL_HANDLE;   //null while the window is minimized
+        std::vector<VkImage> images;
+        VkExtent2D extent{};
+        std::vector<VkSemaphore> imageAvailableSemaphores;   //per frame in flight, like those of the main swapchain
+        uint32_t imageIndex = 0;
+        bool acquired = false;      //an image was acquired in the current frame, it is copied into and presented
+        bool outOfDate = false;     //the swapchain is recreated at the end of the frame
+    };
+
+    /// <summary>
+    /// Slot of the batch readback ring: the command buffer which renders a batch and copies it into the readback buffer, and the fence
+    /// which tells when the buffer can be read. The cameras are in the slot too, so a batch is set up while the ones before it still render.
+    /// </summary>
+    struct BatchSlot {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkBuffer cameraBuffer = VK_NULL_HANDLE;     //view projection of every view of the batch, read by the vertex shader
+        VkDeviceMemory cameraMemory = VK_NULL_HANDLE;
+        void* cameraMapped = nullptr;
+        VkBuffer readbackBuffer = VK_NULL_HANDLE;   //the views one after the other, tightly packed RGBA rows
+        VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+        void* readbackMapped = nullptr;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        uint64_t batch = 0;
+        bool pending = false;       //submitted and not read back yet
+    };
+
+    enum class OfflineOutputState {
+        Free,           //can be rendered into
+        Rendering,      //submitted, its fence has not been seen to signal yet
+        Ready,          //rendered, waiting for an I/O worker
+        Encoding        //a worker compresses it straight out of the mapped memory
+    };
+
+    /// <summary>
+    /// Image the offline mode copies a frame into instead of a swapchain image: linear and host visible, so the I/O workers read it in place
+    /// </summary>
+    struct OfflineOutput {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        const unsigned char* pixels = nullptr;      //mapped first texel, rows are rowPitch bytes apart
+        VkDeviceSize rowPitch = 0;
+        uint64_t frame = 0;
+        OfflineOutputState state = OfflineOutputState::Free;
+    };
+
+    /// <summary>
+    /// Results of one pipeline statistics query, in the order the queried VkQueryPipelineStatisticFlagBits write them
+    /// </summary>
+    struct PipelineStatistics {
+        uint64_t inputAssemblyVertices;
+        uint64_t vertexShaderInvocations;
+        uint64_t clippingPrimitives;
+        uint64_t fragmentShaderInvocations;
+    };
+
+    /// <summary>
+    /// Entry of the object tracker: what created the object, and in which frame
+    /// </summary>
+    struct TrackedObject {
+        std::string name;
+        uint64_t frame;
+    };
+
+    /// <summary>
+    /// Objects of one VkObjectType which are alive, by handle, along with the counts of all creates and destroys of the type
+    /// </summary>
+    struct TrackedObjectType {
+        std::unordered_map<uint64_t, TrackedObject> live;
+        uint64_t created = 0;
+        uint64_t destroyed = 0;
+    };
+
+    /// <summary>
+    /// Start of a capture file. The vertices, objects and lights follow it, each array padded to 8 bytes, then the frames until the end of the file.
+    /// </summary>
+    struct CaptureHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t objectCount;
+        uint32_t lightCount;
+        uint32_t dynamicObjectCount;
+        uint32_t width;             //swapchain extent of the capture, the size of the replay window
+        uint32_t height;
+    };
+
+    /// <summary>
+    /// One frame of a capture, followed by the model matrix of every dynamic object in scene order
+    /// </summary>
+    struct CapturedFrame {
+        int64_t startTime;          //nanoseconds since the start of the first captured frame
+        float time;                 //seconds the scene and the lights are animated to
+        float renderScale;
+    };
+
+    enum class MetricType {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    /// <summary>
+    /// One series of the metrics registry. Registered at startup, afterwards only the values change: 
+    /// they are atomics, so any thread updates them without a lock while the metrics writer reads them.
+    /// </summary>
+    struct Metric {
+        MetricType type;
+        std::string name;
+        std::string labels;                 //e.g. heap="0", empty for none
+        std::string help;
+
+        std::atomic<double> value{ 0.0 };   //counters and gauges
+        //histograms: count of every bucket on its own (cumulated when written), the last bucket is +Inf
+        std::vector<double> bounds;
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<double> sum{ 0.0 };
+
+        void increment(double amount = 1.0);
+        void set(double newValue);
+        void observe(double sample);
+    };
+
+    /// <summary>
+    /// Pass of the scene geometry, picks the pipeline or the shader objects and state it is drawn with
+    /// </summary>
+    enum class ScenePass {
+        DepthPrepass,
+        Shadow,
+        Main
+    };
+
+    /// <summary>
+    /// Contents of the HUD buffer of a swapchain image, read by hud.comp. Filled by the CPU every frame with the text and the newest sample,
+    /// the ring of SAMPLES samples it goes into is only kept on the GPU (hudHistoryBuffer).
+    /// </summary>
+    struct HudData {
+        static const uint32_t SAMPLES = 256;
+        static const uint32_t TEXT_LINES = 4;
+        static const uint32_t TEXT_COLUMNS = 32;
+
+        glm::vec2 newest;       //x: CPU frame time, y: GPU frame time, milliseconds
+        uint32_t head;          //index in the ring the newest sample is written to, the oldest sample follows it
+        uint32_t text[TEXT_LINES * TEXT_COLUMNS];
+    };
+
+    /// <summary>
+    /// Push constants of the HUD pass
+    /// </summary>
+    struct HudPushConstants {
+        glm::ivec2 origin;
+        glm::ivec2 size;
+    };
+
+    /// <summary>
+    /// Entry points of VK_EXT_shader_object, of the dynamic state and the dynamic rendering it requires, loaded from the device as the loader does not export them
+    /// </summary>
+    struct ShaderObjectFunctions {
+        PFN_vkCreateShadersEXT createShaders;
+        PFN_vkDestroyShaderEXT destroyShader;
+        PFN_vkCmdBindShadersEXT cmdBindShaders;
+        PFN_vkCmdSetVertexInputEXT cmdSetVertexInput;
+        PFN_vkCmdSetViewportWithCountEXT cmdSetViewportWithCount;
+        PFN_vkCmdSetScissorWithCountEXT cmdSetScissorWithCount;
+        PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology;
+        PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable;
+        PFN_vkCmdSetRasterizerDiscardEnableEXT cmdSetRasterizerDiscardEnable;
+        PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode;
+        PFN_vkCmdSetRasterizationSamplesEXT cmdSetRasterizationSamples;
+        PFN_vkCmdSetSampleMaskEXT cmdSetSampleMask;
+        PFN_vkCmdSetAlphaToCoverageEnableEXT cmdSetAlphaToCoverageEnable;
+        PFN_vkCmdSetCullModeEXT cmdSetCullMode;
+        PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace;
+        PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable;
+        PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable;
+        PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp;
+        PFN_vkCmdSetDepthBoundsTestEnableEXT cmdSetDepthBoundsTestEnable;
+        PFN_vkCmdSetStencilTestEnableEXT cmdSetStencilTestEnable;
+        PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnable;
+        PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable;
+        PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask;
+        PFN_vkCmdBeginRenderingKHR cmdBeginRendering;
+        PFN_vkCmdEndRenderingKHR cmdEndRendering;
+    };
+
+    /// <summary>
+    /// Libraries a pipeline was linked from without link time optimization, linked again with it on a shader worker
+    /// </summary>
+    struct PipelineLibraryLink {
+        std::array<VkPipeline, 4> libraries;
+        VkPipelineLayout layout;
+    };
+
+    /// <summary>
+    /// Pipeline which has been replaced, destroyed once no frame in flight can still use it
+    /// </summary>
+    struct RetiredPipeline {
+        VkPipeline pipeline;
+        uint64_t frame;
+    };
+
+    /// <summary>
+    /// Every vertex attribute other than the position. Stored in its own stream after the positions in the vertex buffer.
+    /// </summary>
+    struct VertexAttributes {
+        glm::vec3 color;
+        glm::vec3 normal;
+    };
+
     struct Vertex {
-        glm::vec2 pos; 
-        glm::vec3 color; 
+        glm::vec3 pos; 
+        VertexAttributes attributes;
 
         /// <summary>
         /// Generates VkVertexInputBindingDescription from vertex object. This describes at which rate to load data from memory throughout the verticies. 
         /// Such as: number of bytes between data entries or if should move the next data entry after each vertex or after each instance
+        /// Positions and the remaining attributes are in separate streams, so that depth only passes fetch nothing but positions.
         /// </summary>
         /// <returns></returns>
-        static VkVertexInputBindingDescription getBindingDescription() {
-            VkVertexInputBindingDescription bindingDescription{}; 
+        static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions() {
+            std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{}; 
 
-            //all vertex data is in one array, so only using one binding 
-            bindingDescription.binding = 0; //specifies index of the binding in the array of bindings
+            //binding 0: position stream, the only binding of the depth only pipelines
+            bindingDescriptions[0].binding = 0; //specifies index of the binding in the array of bindings
 
             //number of bytes from one entry to the next
-            bindingDescription.stride = sizeof(Vertex); 
+            bindingDescriptions[0].stride = sizeof(glm::vec3); 
 
             //can have one of the following: 
                 //1. VK_VERTEX_INPUT_RATE_VERTEX: move to the next data entry after each vertex
                 //2. VK_VERTEX_INPUT_RATE_INSTANCE: move to the next data entry after each instance
             //not using instanced rendering so per-vertex data
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; 
+            bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; 
+
+            //binding 1: everything else, only fetched by the passes which shade
+            bindingDescriptions[1].binding = 1;
+            bindingDescriptions[1].stride = sizeof(VertexAttributes);
+            bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-            return bindingDescription; 
+            return bindingDescriptions; 
         }
 
         /// <summary>
@@ -61,8 +604,8 @@ private:
         /// vertex data originating from a binding descritpion. For this program, there are 2: position and color. 
         /// </summary>
         /// <returns>Array containing attribute descriptions</returns>
-        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{}; 
+        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{}; 
 
             /* Struct */
                 //1. binding - which binding the per-vertex data comes in 
@@ -80,16 +623,21 @@ private:
                 //4. offset - specifies the number of bytes since the start of the per-vertex data to read from
             attributeDescriptions[0].binding = 0;
             attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
 
-            //the binding is loading over vertex at a time and the position attribute is at an offset of 0 bytes from the beginning of the struct.
-            //offset macro calculates this distance for us
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
+            //the position stream holds nothing but positions, so the attribute starts at the beginning of each entry
+            attributeDescriptions[0].offset = 0;
 
-            attributeDescriptions[1].binding = 0;
+            //offset macro calculates the distance from the start of each entry of the attribute stream
+            attributeDescriptions[1].binding = 1;
             attributeDescriptions[1].location = 1;
             attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, color);
+            attributeDescriptions[1].offset = offsetof(VertexAttributes, color);
+
+            attributeDescriptions[2].binding = 1;
+            attributeDescriptions[2].location = 2;
+            attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attributeDescriptions[2].offset = offsetof(VertexAttributes, normal);
 
             return attributeDescriptions;
         }
@@ -102,36 +650,490 @@ private:
     //    {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
     //}; 
 
-    const std::vector<Vertex> vertices = {
-    {{0.0f, -0.5f}, {1.0f, 1.0f, 1.0f}},
-    {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+    //filled by createScene, the original triangle is still the first object
+    std::vector<Vertex> vertices;
+
+    /// <summary>
+    /// Range of the vertex buffer drawn with one model matrix. Static objects never move, which lets the shadow cascades that 
+    /// only contain static objects be cached.
+    /// </summary>
+    struct SceneObject {
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        bool isStatic;
+        glm::mat4 model = glm::mat4(1.0f);
+        glm::vec4 boundingSphere;   //xyz: center in object space, w: radius
+    };
+    std::vector<SceneObject> sceneObjects;
+
+    /// <summary>
+    /// How a dynamic object of the stress scene moves: around its starting position and rotation, at its own speed
+    /// </summary>
+    struct StressMotion {
+        uint32_t object;
+        glm::vec3 position;
+        float angle;
+        float speed;
+        float phase;
+    };
+    std::vector<StressMotion> stressMotions;
+
+    /// <summary>
+    /// Push constants of every pipeline which draws scene objects
+    /// </summary>
+    struct DrawPushConstants {
+        glm::mat4 model;
+        uint32_t cascade;   //depth only pipelines: shadow cascade to render, or CAMERA_VIEW for the depth prepass
+    };
+
+    /// <summary>
+    /// Per frame camera and lighting information shared by the vertex, fragment and light binning shaders.
+    /// Layout must match the UniformBufferObject block declared in the shaders (std140).
+    /// </summary>
+    struct UniformBufferObject {
+        alignas(16) glm::mat4 view;
+        alignas(16) glm::mat4 proj;
+        alignas(16) glm::mat4 invProj;
+        alignas(16) glm::mat4 invView;
+        alignas(16) glm::vec4 screenSize;   //xy: framebuffer size in pixels, z: near plane, w: far plane
+        alignas(16) glm::uvec4 clusterGrid; //xyz: number of clusters along each axis, w: number of active lights
+        alignas(16) glm::mat4 lightView;    //world to light space of the sun, shared by every shadow cascade
+        alignas(16) glm::vec4 sunDirection; //xyz: direction the sunlight travels in
+        alignas(16) glm::vec4 sunColor;     //rgb: color scaled by intensity
+        alignas(16) glm::vec4 shadowParams; //x: view depth where the static cascades start, y/z: light space z range of all casters
+        alignas(16) glm::mat4 viewProjections[MAX_VIEWS];  //world to clip space of each multiview view, the first one is proj * view
+    };
+
+    /// <summary>
+    /// One shadow cascade as it is stored in the cascade storage buffer (std430)
+    /// </summary>
+    struct ShadowCascade {
+        glm::mat4 viewProj;     //world to shadow map clip space
+        glm::vec4 split;        //x: near view depth, y: far view depth, z: world size of a shadow map texel
+    };
+
+    /// <summary>
+    /// Point light as it is stored in the light storage buffer (std430)
+    /// </summary>
+    struct PointLight {
+        glm::vec4 positionRadius;   //xyz: world position, w: radius of influence
+        glm::vec4 color;            //rgb: color, a: intensity
     };
 
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
         std::optional<uint32_t> transferFamily; 
+        //queue family used for post processing, a compute only family when the device has one so that it runs asynchronously to graphics
+        std::optional<uint32_t> computeFamily;
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value() && transferFamily.has_value();
         }
     };
+    QueueFamilyIndices queueFamilyIndices;      //of physicalDevice, set once it is picked
 
     const uint32_t WIDTH = 800;
     const uint32_t HEIGHT = 600;
 
     bool frameBufferResized = false; //explicit declaration of resize, used if driver does not trigger VK_ERROR_OUT_OF_DATE
 
-    //how many frames will be sent through the pipeline
-    const int MAX_FRAMES_IN_FLIGHT = 2; 
+    //how many frames will be sent through the pipeline, options.framesInFlight or the default of the mode
+    const uint32_t framesInFlight;
 
     //tracker for which frame is being processed of the available permitted frames
-    size_t currentFrame = 0; 
+    size_t currentFrame = 0;
+
+    /* Clustered Lighting */
+    //the view frustum is split into a grid of clusters (froxels), each frame lights are binned into the clusters they touch
+    //so that the fragment shader only loops over the lights near it. X and Y must match the workgroup size of clusterLights.comp
+    const uint32_t CLUSTER_GRID_X = 16;
+    const uint32_t CLUSTER_GRID_Y = 9;
+    const uint32_t CLUSTER_GRID_Z = 24;
+    const uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+    //average number of lights each cluster can reference before the compact light index list is full
+    const uint32_t AVERAGE_LIGHTS_PER_CLUSTER = 32;
+    const uint32_t MAX_LIGHTS = 1024;
+    const uint32_t LIGHT_COUNT = 256;
+
+    const float CAMERA_NEAR = 0.1f;
+    const float CAMERA_FAR = 10.0f;
+
+    //starting state of each light, animated in updateUniformBuffer
+    std::vector<PointLight> lights;
+
+    /* Shader Variants */
+    //pipelines ask for their shaders by variant name, see createShaderVariants
+    std::map<std::string, ShaderVariant> shaderVariants;
+    //constant_id of the feature toggles of the scene shaders (scene.frag, clusteredLighting.glsl)
+    const uint32_t SPEC_OUTPUT_GBUFFER = 0;
+    const uint32_t SPEC_RECEIVE_SHADOWS = 1;
+    const uint32_t SPEC_DEBUG_VIEW = 2;
+    const uint32_t SPEC_SHARED_CLUSTERS = 3;
+
+    /* Shader Compiler */
+    //false when the sources could not be found, the prebuilt SPIR-V files are loaded then
+    bool compileShaderSources = false;
+    //starts out as options.optimizeShaders, only the shader benchmark changes it
+    std::atomic<bool> optimizeShaders{ true };
+    //SPIR-V of every compiled source and the files each one includes, by file name -- written by the shader workers
+    std::map<std::string, std::vector<char>> shaderCode;
+    std::map<std::string, std::set<std::string>> shaderIncludes;
+    std::mutex shaderCodeMutex;
+
+    //compiles and pipeline builds run on the shader workers, the render loop only swaps the results in
+    std::vector<std::thread> shaderWorkers;
+    std::deque<std::function<void()>> shaderJobs;
+    std::mutex shaderJobMutex;
+    std::condition_variable shaderJobCondition;
+    size_t runningShaderJobs = 0;
+    bool shaderJobsPaused = false;      //while the swapchain is recreated, no pipeline may be built against it
+    bool stopShaderWorkers = false;
+    std::vector<RebuiltPipeline> rebuiltPipelines;  //guarded by shaderJobMutex
+    std::vector<RebuiltPipeline> takenRebuiltPipelines;     //swapped with rebuiltPipelines by the render loop, the two keep their capacity
+
+    std::thread shaderWatcher;
+    std::atomic<bool> stopShaderWatcher{ false };
+
+    std::vector<ReloadablePipeline> reloadablePipelines;
+    std::vector<RetiredPipeline> retiredPipelines;
+
+    /* Pipeline Libraries */
+    //picked when the device is created: off without VK_EXT_graphics_pipeline_library, every graphics pipeline is monolithic then
+    bool usePipelineLibraries = false;
+    //without fast linking, a link is as slow as an optimized one, so pipelines are linked optimized right away
+    bool pipelineLibraryFastLinking = false;
+    //by a hash of the state each part is made from -- written by the shader workers as well
+    std::map<uint64_t, PipelineLibrary> pipelineLibraries;
+    //fast linked pipelines waiting for their optimized link to be queued, see scheduleOptimizedLink
+    std::map<VkPipeline, PipelineLibraryLink> fastLinkedPipelines;
+    std::mutex pipelineLibraryMutex;
+
+    /* Shader Objects */
+    //VK_EXT_shader_object is only enabled when it is asked for, the scene passes are drawn with pipelines otherwise
+    bool shaderObjectsSupported = false;
+    bool useShaderObjects = false;      //switched at runtime by the shader object benchmark
+    ShaderObjectFunctions shaderObjectFunctions{};
+    //unlinked, so that any vertex shader can be bound with any fragment shader
+    VkShaderEXT sceneVertexShader = VK_NULL_HANDLE;
+    VkShaderEXT sceneFragmentShader = VK_NULL_HANDLE;
+    VkShaderEXT depthOnlyVertexShader = VK_NULL_HANDLE;
+    //vertex input is dynamic state as well, the depth only passes use the first binding and attribute
+    std::vector<VkVertexInputBindingDescription2EXT> sceneVertexBindings;
+    std::vector<VkVertexInputAttributeDescription2EXT> sceneVertexAttributes;
+    float recordTime = 0.0f;            //milliseconds on the CPU to record the scene commands of the last frame
+
+    /* Tracing */
+    //events kept per timeline, about a minute of frames on the main thread
+    const size_t TRACE_BUFFER_EVENTS = 1 << 16;
+    bool tracing = false;
+    int64_t traceStart = 0;
+    std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;
+    std::mutex traceBufferMutex;                //only taken to add a timeline
+    static thread_local TraceBuffer* threadTraceBuffer;
+    TraceBuffer* graphicsQueueTrace = nullptr;
+    TraceBuffer* computeQueueTrace = nullptr;
+    //VK_EXT_calibrated_timestamps samples the GPU and CPU clocks together, without it the GPU ranges are left out of the trace
+    bool calibratedTimestamps = false;
+    VkTimeDomainEXT hostTimeDomain;
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr;
+
+    /* Pipeline Statistics */
+    //one query per scene pass, indexed by ScenePass -- the shadow query spans every cascade rendered that frame
+    const uint32_t PIPELINE_STATISTICS_PER_IMAGE = 3;
+    bool pipelineStatisticsSupported = false;
+    VkQueryPool pipelineStatisticsQueryPool = VK_NULL_HANDLE;
+    std::vector<bool> pipelineStatisticsWritten;
+    std::array<PipelineStatistics, 3> passStatistics{};     //the last frame which was read back
+
+    /* Metrics */
+    //always recorded, only written out when options.metricsFile is set
+    std::vector<std::unique_ptr<Metric>> metrics;
+    Metric* framesMetric = nullptr;
+    Metric* frameTimeMetric = nullptr;
+    Metric* gpuFrameTimeMetric = nullptr;
+    Metric* renderScaleMetric = nullptr;
+    Metric* graphicsSubmitsMetric = nullptr;
+    Metric* computeSubmitsMetric = nullptr;
+    Metric* transferSubmitsMetric = nullptr;
+    Metric* uploadBytesMetric = nullptr;
+    Metric* pipelineLibraryHitsMetric = nullptr;
+    Metric* pipelineLibraryMissesMetric = nullptr;
+    Metric* shaderCacheHitsMetric = nullptr;
+    Metric* shaderCacheMissesMetric = nullptr;
+    Metric* swapchainRecreationsMetric = nullptr;
+    Metric* heapAllocationsMetric = nullptr;
+    Metric* frameHeapAllocationsMetric = nullptr;
+    //by memory heap, usage and budget need VK_EXT_memory_budget
+    std::vector<Metric*> heapSizeMetrics;
+    std::vector<Metric*> heapUsageMetrics;
+    std::vector<Metric*> heapBudgetMetrics;
+    bool memoryBudgetSupported = false;
+    std::chrono::steady_clock::time_point lastFrameStart;
+    std::thread metricsWriter;
+    std::mutex metricsMutex;
+    std::condition_variable metricsCondition;
+    bool stopMetricsWriter = false;
+
+    /* Object Tracking */
+    //only filled with options.trackObjects, taken by the shader workers as well since they create pipelines and shader modules
+    std::mutex objectTrackerMutex;
+    std::map<VkObjectType, TrackedObjectType> trackedObjects;
+    bool debugUtilsSupported = false;
+    PFN_vkSetDebugUtilsObjectNameEXT setDebugUtilsObjectName = nullptr;
+    std::thread::id mainThreadId;
+    uint64_t objectTrackerFrame = 0;
+    bool objectFrameActive = false;         //between beginObjectFrame and endObjectFrame
+    bool objectChurnExpected = false;       //the swapchain was recreated this frame
+    uint32_t frameObjectsCreated = 0;
+    uint32_t frameObjectsDestroyed = 0;
+    std::vector<std::string> frameObjectCreations;      //by the render loop this frame, e.g. "VkCommandBuffer copyBuffer"
+    std::map<std::string, uint64_t> objectChurn;        //times each was created in a steady-state frame
+
+    /* Allocation Tracking */
+    //operator new and the Vulkan host allocation callbacks count per thread, drawFrame takes the difference over a frame of the render loop
+    uint64_t frameAllocationsStart = 0;
+    uint64_t frameAllocatedBytesStart = 0;
+    uint64_t frameHeapAllocations = 0;          //made by the last frame
+    bool allocationsExpected = false;           //the swapchain was recreated or a rebuilt pipeline swapped in this frame
+    uint64_t steadyStateAllocationFrames = 0;   //frames after the warmup which allocated, with options.checkAllocations
+    uint64_t steadyStateAllocations = 0;
+
+    /* Flight Recorder */
+    //ring of the last frames, always recorded: a record is a few clock reads, cheap enough to leave on in production
+    std::vector<FlightRecord> flightRecords;
+    double flightSubmitsStart = 0.0;        //metric values at the start of the frame being recorded
+    double flightUploadBytesStart = 0.0;
+    double flightRecreationsStart = 0.0;
+    bool flightFrameExpectedSlow = false;   //the last frame recreated the swapchain or swapped in pipelines, its time is not a hitch
+    uint64_t hitchFrame = 0;                //slowest frame of the hitch waiting for the frames after it, 0 when there is none
+    float hitchInterval = 0.0f;
+    uint64_t hitchWindowStart = 0;          //frames of the window written for the hitch: [start, end)
+    uint64_t hitchWindowEnd = 0;
+    uint64_t lastHitchWindowEnd = 0;        //frames before this were written with an earlier hitch
+    //written on a thread of its own so that the frames after a hitch do not wait on the disk: the render loop fills hitchRecords,
+    //the writer swaps it with writerRecords -- both keep their capacity, so handing over a window never allocates
+    std::vector<FlightRecord> hitchRecords;
+    std::vector<FlightRecord> writerRecords;
+    uint64_t hitchRecordsFrame = 0;
+    float hitchRecordsInterval = 0.0f;
+    bool hitchRecordsReady = false;
+    bool stopFlightRecorder = false;
+    std::thread flightRecorderWriter;
+    std::mutex flightRecorderMutex;
+    std::condition_variable flightRecorderCondition;
+
+    /* Displays */
+    std::vector<DisplayWindow> displays;
+    //what the post processing submit waits on and what is presented, refilled each frame -- sized once for every display so this never allocates
+    std::vector<VkSemaphore> postWaitSemaphores;
+    std::vector<VkPipelineStageFlags> postWaitStages;
+    std::vector<VkSwapchainKHR> presentSwapChains;
+    std::vector<uint32_t> presentImageIndices;
+    std::vector<VkResult> presentResults;
+
+    /* Batch Views */
+    //one layered target for every batch: each layer is a grid of views, each view its own viewport of the viewport array
+    ImageAttachment batchColor;
+    ImageAttachment batchDepth;
+    uint32_t batchLayers = 0;
+    VkRenderPass batchRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer batchFramebuffer = VK_NULL_HANDLE;
+    VkDescriptorSetLayout batchSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool batchDescriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout batchPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline batchPipeline = VK_NULL_HANDLE;
+    std::vector<BatchSlot> batchSlots;
+    //the same for every batch, filled once
+    std::vector<VkViewport> batchViewports;
+    std::vector<VkRect2D> batchScissors;
+    std::vector<VkBufferImageCopy> batchCopyRegions;
+    uint64_t batchBytesRead = 0;
+
+    /* Offline */
+    //an output per frame in flight takes the place of the swapchain, the state of each is shared with the I/O workers under offlineMutex
+    std::vector<OfflineOutput> offlineOutputs;
+    std::vector<std::thread> offlineWorkers;
+    std::mutex offlineMutex;
+    std::condition_variable offlineCondition;      //an output became ready or free, or the workers are stopped
+    bool stopOfflineWorkers = false;
+    //totals of the workers, to tell which stage bounds the run
+    double offlineEncodeSeconds = 0.0;
+    double offlineWriteSeconds = 0.0;
+    double offlineWaitSeconds = 0.0;        //the render loop waited for an output to be encoded
+    uint64_t offlineFramesWritten = 0;
+    uint64_t offlineBytesWritten = 0;
+
+    /* Poster */
+    //the tiles go through the offline outputs, each is rendered with a guard band around it which is left out of the file
+    uint32_t posterTilesAcross = 0;
+    uint32_t posterTilesDown = 0;
+    uint64_t posterDataOffset = 0;      //of the first tile in the file, the others follow it in order, each of the same size
+    std::fstream posterStream;
+    std::mutex posterStreamMutex;       //the workers write their tiles in whatever order they finish them
+
+    /* Capture and Replay */
+    std::ofstream captureStream;
+    std::chrono::steady_clock::time_point captureStart;
+    uint64_t capturedFrames = 0;
+    uint32_t captureDynamicObjects = 0;
+    //the replayed capture is mapped, the header and frames point into the mapping
+    const char* replayData = nullptr;
+    size_t replaySize = 0;
+    const CaptureHeader* replayHeader = nullptr;
+    size_t replayFramesOffset = 0;
+    size_t replayFrameStride = 0;
+    size_t replayFrameCount = 0;
+    const CapturedFrame* replayFrame = nullptr;     //frame being drawn, nullptr when not replaying
+
+    /* HUD */
+    //size in pixels, follows from the layout in hud.comp: a line of 8x12 characters per text line above a 64 pixel graph
+    const uint32_t HUD_WIDTH = 264;
+    const uint32_t HUD_HEIGHT = 124;
+    bool hudVisible = true;
+    float cpuFrameTime = 0.0f;      //milliseconds between the starts of the last two frames
+    float hudTime = 0.0f;           //milliseconds on the GPU of the HUD pass itself
+    HudData hudData{};
+    std::vector<uint32_t> hudHeaps; //device local memory heaps, their use is shown on the HUD
+    VkDescriptorSetLayout hudSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout hudPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline hudPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool hudDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> hudDescriptorSets;
+    std::vector<VkBuffer> hudBuffers;
+    std::vector<VkDeviceMemory> hudBuffersMemory;
+    std::vector<void*> hudBuffersMapped;
+    std::vector<bool> hudTimestampsWritten;
+    VkBuffer hudHistoryBuffer = VK_NULL_HANDLE;     //ring of HudData::SAMPLES samples, written and read by hud.comp only
+    VkDeviceMemory hudHistoryMemory = VK_NULL_HANDLE;
+    bool hudHistoryCleared = false;
+    //frames started since startup, tells when a retired pipeline is no longer in flight
+    uint64_t frameNumber = 0;
+
+    /* Shadows */
+    //directional shadows from the sun, rendered into one layer of a depth array per cascade:
+    //the near cascades are fit on the GPU to the depth buffer every frame, the far ones only hold static casters and are cached
+    const uint32_t SHADOW_CASCADE_COUNT = 4;
+    const uint32_t DYNAMIC_CASCADE_COUNT = 2;
+    const uint32_t SHADOW_MAP_SIZE = 2048;
+    //view depth where the static cascades take over from the dynamic ones
+    const float STATIC_CASCADE_SPLIT = 3.0f;
+    const uint32_t CAMERA_VIEW = ~0u;
+    const glm::vec3 SUN_DIRECTION = glm::vec3(-0.4f, -1.0f, 0.3f);
+    const glm::vec3 SUN_COLOR = glm::vec3(1.0f, 0.95f, 0.85f) * 0.8f;
+
+    ImageAttachment shadowMap;                      //view covers every cascade, sampled by the lighting
+    std::vector<VkImageView> shadowCascadeViews;    //one layer each, rendered into
+    std::vector<VkFramebuffer> shadowFramebuffers;
+    VkRenderPass shadowRenderPass;
+    VkSampler shadowSampler;
+    //matrix each static cascade was last rendered with, along with whether it has to be rendered again
+    std::vector<glm::mat4> cachedCascadeMatrices;
+    std::vector<bool> cascadeCached;
+    std::vector<bool> cascadeHasDynamic;
+    std::vector<bool> cascadesToRender;             //picked by updateShadowCascades for the frame being recorded
+
+    //depth prepass: only positions are drawn, the result is fit against and then loaded by the main render pass
+    VkRenderPass depthPrepassRenderPass;
+    VkFramebuffer depthPrepassFramebuffer;
+    VkPipelineLayout depthOnlyPipelineLayout;
+    VkPipeline depthPrepassPipeline;
+    VkPipeline shadowPipeline;
+    VkPipeline depthBoundsPipeline;
+    VkPipeline cascadeFitPipeline;
+
+    //per swapchain image cascades: the CPU writes the static ones, the fit pass writes the dynamic ones
+    std::vector<VkBuffer> cascadeBuffers;
+    std::vector<VkDeviceMemory> cascadeBuffersMemory;
+    std::vector<void*> cascadeBuffersMapped;
+    std::vector<VkBuffer> depthBoundsBuffers;       //min and max depth of the depth prepass
+    std::vector<VkDeviceMemory> depthBoundsBuffersMemory;
+
+    /* Post Processing */
+    //the scene is rendered into an HDR target, compute passes then produce the LDR image which is copied into the swapchain image
+    const VkFormat HDR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    //bloom chain starts at half resolution, each level is half the size of the previous one
+    const uint32_t BLOOM_MIP_LEVELS = 5;
+    //downsample sets for every level, upsample sets for every level but the smallest, one composite set and one upscale set
+    const uint32_t POST_SETS_PER_IMAGE = 2 * BLOOM_MIP_LEVELS + 1;
+
+    /// <summary>
+    /// Values used by the post processing passes. Baked into the compute command buffers as push constants.
+    /// </summary>
+    struct PostProcessSettings {
+        float exposure = 1.0f;
+        float bloomThreshold = 1.0f;    //HDR brightness where bloom starts
+        float bloomKnee = 0.5f;         //width of the soft transition around the threshold
+        float bloomIntensity = 0.6f;
+        glm::vec3 colorFilter = glm::vec3(1.0f);
+        float saturation = 1.1f;
+        float contrast = 1.05f;
+    };
+    PostProcessSettings postSettings;
+
+    /* Dynamic Resolution */
+    //the scene is rendered into the top left corner of the HDR target, the size of that region follows the GPU time of recent frames
+    //graphics start, graphics end, compute start, compute end, HUD start, HUD end
+    const uint32_t TIMESTAMPS_PER_IMAGE = 6;
+    VkExtent2D renderExtent;
+    VkExtent2D viewExtent;          //of each view, the views share the width of renderExtent
+    float renderScale = 1.0f;
+    float gpuTime = 0.0f;           //milliseconds, smoothed
+    float gpuFrameTime = 0.0f;      //milliseconds, the last frame which was read back
+    float gpuSceneTime = 0.0f;      //milliseconds of the graphics and the post processing submit of that frame
+    float gpuPostTime = 0.0f;
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    std::vector<bool> timestampsWritten;
+    std::vector<float> timestampRenderScales;   //render scale of the frame that wrote the timestamps of each image
+    std::vector<uint64_t> timestampFrames;      //number of that frame
+    uint64_t graphicsTimestampMask = 0;         //valid bits of the timestamps of each queue, 0 when the queue does not support them
+    uint64_t computeTimestampMask = 0;
+    float timestampPeriod = 0.0f;               //nanoseconds per timestamp tick
+
+    /// <summary>
+    /// Push constants of the bloom downsample and upsample passes
+    /// </summary>
+    struct BloomPushConstants {
+        glm::vec4 sourceRegion; //xy: scale from frame uv to source uv, zw: largest source uv that holds rendered pixels
+        glm::vec2 srcTexelSize;
+        float threshold;        //downsample only, 0 disables the threshold
+        float knee;
+    };
+
+    /// <summary>
+    /// Push constants of the fused composite pass (bloom, tonemap, color grading, anti-aliasing)
+    /// </summary>
+    struct CompositePushConstants {
+        glm::vec4 colorFilter;  //rgb: tint, a: saturation
+        glm::vec4 sourceRegion; //same as BloomPushConstants::sourceRegion, for the HDR target
+        glm::uvec2 renderExtent;
+        float exposure;
+        float bloomIntensity;
+        float contrast;
+    };
+
+    /// <summary>
+    /// Push constants of the upscale pass
+    /// </summary>
+    struct UpscalePushConstants {
+        glm::vec4 sourceRegion; //same as BloomPushConstants::sourceRegion, for the composited image
+        glm::vec2 sourceSize;   //size of the whole composited image in pixels
+    };
+
+    /// <summary>
+    /// Mip chain that the bloom is built in, each level has its own view so that it can be bound as a storage image
+    /// </summary>
+    struct BloomChain {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        std::vector<VkImageView> levelViews;
+        std::vector<VkExtent2D> levelExtents;
+    };
 
     //Sync obj storage 
     std::vector<VkSemaphore> imageAvailableSemaphores; 
     std::vector<VkSemaphore> renderFinishedSemaphores; 
+    std::vector<VkSemaphore> sceneFinishedSemaphores;   //graphics queue is done with the HDR target, post processing can start
 
     //vulkan command storage
     VkCommandPool graphicsCommandPool;
@@ -139,20 +1141,80 @@ private:
     VkCommandPool transferCommandPool; 
     std::vector<VkCommandBuffer> transferCommandBuffers;
     VkCommandPool tempCommandPool; //command pool for temporary use in small operations
+    VkCommandPool computeCommandPool;
+    std::vector<VkCommandBuffer> computeCommandBuffers;
 
     //buffer and memory information storage
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory; 
+    VkDeviceSize vertexAttributeOffset;     //start of the attribute stream, the position stream starts at 0
+
+    //per swapchain image buffers for camera and light data
+    std::vector<VkBuffer> uniformBuffers;
+    std::vector<VkDeviceMemory> uniformBuffersMemory;
+    std::vector<VkBuffer> lightBuffers;
+    std::vector<VkDeviceMemory> lightBuffersMemory;
+    std::vector<void*> lightBuffersMapped;
+    //per swapchain image results of the light binning pass
+    std::vector<VkBuffer> lightGridBuffers;         //(offset, count) into the light index list for each cluster
+    std::vector<VkDeviceMemory> lightGridBuffersMemory;
+    std::vector<VkBuffer> lightIndexBuffers;        //compact list of light indices referenced by the light grid
+    std::vector<VkDeviceMemory> lightIndexBuffersMemory;
+    std::vector<VkBuffer> lightCounterBuffers;      //atomic counter used to allocate space in the light index list
+    std::vector<VkDeviceMemory> lightCounterBuffersMemory;
+
+    //descriptor storage
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> descriptorSets;
 
     //pipeline and dependency storage
-    VkPipeline graphicsPipeline; 
-    VkRenderPass renderPass; 
+    VkPipeline graphicsPipeline;
+    VkRenderPass renderPass;
     VkPipelineLayout pipelineLayout;
+    VkPipeline clusterPipeline;
+    VkPipelineLayout clusterPipelineLayout;
+
+    //written by the depth prepass, then loaded read only by the main render pass of either path
+    ImageAttachment depthAttachment;
+    VkImageView depthArrayView;     //every view of the depth attachment for the framebuffers, depthAttachment.view is the first one
+
+    /* Multiview */
+    //with options.views above 1 the depth prepass and the main pass render every view in one pass, chained to both render passes
+    uint32_t viewMask = 0;
+    VkRenderPassMultiviewCreateInfo renderPassMultiview{};
+
+    /* Deferred Shading */
+    //G-buffer written by the first subpass and read back as input attachments by the lighting subpass.
+    //These are transient: they never leave tile memory on tiled GPUs and are never stored
+    ImageAttachment gBufferAlbedo;
+    ImageAttachment gBufferNormal;
+    VkDescriptorSetLayout gBufferSetLayout;
+    VkDescriptorSet gBufferDescriptorSet;
+    VkPipeline lightingPipeline;
+    VkPipelineLayout lightingPipelineLayout;
+
+    //per swapchain image post processing targets, so that post processing of one frame never waits on the geometry of the next
+    std::vector<ImageAttachment> hdrTargets;        //view is the first layer, which the bloom chain is built from
+    std::vector<VkImageView> hdrArrayViews;         //every layer, drawn by the main pass and read by the composite pass
+    std::vector<ImageAttachment> compositeTargets;  //tonemapped image at render resolution
+    std::vector<ImageAttachment> ldrTargets;        //upscaled image at swapchain resolution
+    std::vector<BloomChain> bloomChains;
+    VkSampler postSampler;
+    VkDescriptorSetLayout postSetLayout;
+    VkDescriptorPool postDescriptorPool;
+    std::vector<VkDescriptorSet> postDescriptorSets;
+    VkPipelineLayout postPipelineLayout;
+    VkPipeline bloomDownsamplePipeline;
+    VkPipeline bloomUpsamplePipeline;
+    VkPipeline compositePipeline;
+    VkPipeline upscalePipeline;
 
     //queue family
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     VkQueue transferQueue; 
+    VkQueue computeQueue;
 
     GLFWwindow* window;
     VkInstance instance;
@@ -196,6 +1258,7 @@ private:
         std::vector<VkSurfaceFormatKHR> formats;
         std::vector<VkPresentModeKHR> presentModes;
     };
+    SwapChainSupportDetails swapChainSupport;   //of the current swapchain, queried again whenever it is created
 
     /// <summary>
     /// Definition of vulkan main loop
@@ -207,6 +1270,22 @@ private:
     /// </summary>
     void drawFrame();
 
+    /// <summary>
+    /// Compile every shader without and with the optimization passes, create the pipelines and render a number of frames with each, 
+    /// then print pipeline creation time, GPU time and SPIR-V size side by side. Runs instead of the main loop.
+    /// </summary>
+    void runShaderBenchmark();
+
+    /// <summary>
+    /// Throw unless the frames of a benchmark can be timed and compared: the render scale has to stay fixed and timestamps are needed
+    /// </summary>
+    void checkBenchmarkPreconditions(const std::string& benchmark);
+
+    /// <summary>
+    /// Render BENCHMARK_WARMUP_FRAMES frames, then BENCHMARK_FRAMES more whose CPU record time and GPU time are averaged, in milliseconds
+    /// </summary>
+    void measureFrames(const std::string& benchmark, double& cpuTime, double& gpuTime);
+
     /// <summary>
     /// Vulkan requires that explicitly created objects be destroyed as these will not be destroyed automatically. This handles that step. 
     /// </summary>
@@ -256,6 +1335,11 @@ private:
     /// </summary>
     bool checkDeviceExtensionSupport(VkPhysicalDevice device); 
 
+    /// <summary>
+    /// Check if the picked device has an optional extension
+    /// </summary>
+    bool isDeviceExtensionAvailable(const char* extensionName);
+
     /// <summary>
     /// Find what queues are available for the device
     /// Queues support different types of commands such as : processing compute commands or memory transfer commands
@@ -273,10 +1357,16 @@ private:
     /// <returns></returns>
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties); 
 
+    /// <summary>
+    /// Memory properties for what the GPU writes and the CPU reads: host visible and coherent, and host cached where the device has it,
+    /// since reading uncached memory is slow
+    /// </summary>
+    VkMemoryPropertyFlags findReadbackMemoryProperties();
+
     /// <summary>
     /// Request specific details about swap chain support for a given device
     /// </summary>
-    SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+    void querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface, SwapChainSupportDetails& details);
 
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats); 
 
@@ -295,6 +1385,7 @@ private:
     /// Create a graphics pipeline to handle the needs for the application with the vertex and fragment shaders. The pipeline is immutable so it must be created if any changes are needed.
     /// </summary>
     void createGraphicsPipeline(); 
+    VkPipeline buildGraphicsPipeline();
 
     /// <summary>
     /// Create a shader module from bytecode. The shader module is a wrapper around the shader code with function definitions. 
@@ -304,89 +1395,792 @@ private:
     VkShaderModule createShaderModule(const std::vector<char>& code); 
 
     /// <summary>
-    /// Create a rendering pass object which will tell vulkan information about framebuffer attachments:
-    /// number of color and depth buffers, how many samples to use for each, how to handle contents
+    /// Register every named shader variant, with the values of its specialization constants picked from the startup options
     /// </summary>
-    void createRenderPass(); 
-    
+    void createShaderVariants();
+
     /// <summary>
-    /// Create framebuffers that will hold representations of the images in the swapchain
+    /// Load the module of a shader variant and fill in the create info of its stage, specialization included
     /// </summary>
-    void createFramebuffers(); 
+    void createShaderStage(const std::string& variantName, ShaderStage& stage);
+    void createShaderStage(const ShaderVariant& variant, ShaderStage& stage);
+    void destroyShaderStage(ShaderStage& stage);
 
     /// <summary>
-    /// Create command pools which will contain all predefined draw commands for later use in vulkan main loop
+    /// Create a compute pipeline from a single shader variant
     /// </summary>
-    void createCommandPools(); 
+    VkPipeline buildComputePipeline(const std::string& variantName, VkPipelineLayout layout);
 
-    
-    void createPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, VkCommandPool &pool); 
+    /// <summary>
+    /// Create a pipeline with build and remember how, so that it is built again on a shader worker whenever the source of one of its variants changes. 
+    /// Build runs on a worker thread then, so it may only read state which does not change until the swapchain is recreated.
+    /// </summary>
+    void createReloadablePipeline(VkPipeline& pipeline, const std::vector<std::string>& variantNames, const std::function<VkPipeline()>& build);
 
     /// <summary>
-    /// Allocate and record the commands for each swapchain image
+    /// Start the shader workers and compile every source of the shader directory on them, waits until they are done
     /// </summary>
-    void createCommandBuffers(); 
+    void createShaderCompiler();
 
     /// <summary>
-    /// Create semaphores that are going to be used to sync rendering and presentation queues
+    /// Stop the watcher and the shader workers, and destroy every pipeline which was rebuilt or retired
     /// </summary>
-    void createSemaphores(); 
+    void destroyShaderCompiler();
 
     /// <summary>
-    /// Fences are needed for CPU-GPU sync. Creates these required objects
+    /// SPIR-V of a variant: compiled from its source, or read from its prebuilt file when the sources are not compiled at runtime
     /// </summary>
-    void createFences(); 
+    std::vector<char> loadShaderCode(const ShaderVariant& variant);
 
     /// <summary>
-    /// Create tracking information in order to link fences with the swap chain images using 
+    /// Compile a GLSL source of the shader directory, or read it back from the on-disk cache when neither it nor any file it includes has changed.
+    /// Throws with the compiler output when the source does not compile.
     /// </summary>
-    void createFenceImageTracking();
+    std::vector<char> compileShader(const std::string& sourceFile);
 
     /// <summary>
-    /// Create a vertex buffer to hold the vertex information that will be passed to the GPU. 
+    /// Queue work for the shader workers
     /// </summary>
-    void createVertexBuffer(); 
+    void addShaderJob(std::function<void()> job);
+    void runShaderWorker();
+    void waitForShaderJobs();
 
     /// <summary>
-    /// Create a buffer with the given arguments
+    /// Keep the shader workers from starting anything new while the swapchain and its pipelines are recreated, returns once the running jobs are done
     /// </summary>
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory); 
+    void pauseShaderJobs();
+    void resumeShaderJobs();
 
     /// <summary>
-    /// Copy data from one buffer to another
+    /// Wait for files of the shader directory to change and reload them. Runs on its own thread.
     /// </summary>
-    /// <param name="srcBuffer">Buffer that will act as the source in the transfer</param>
-    /// <param name="dstBuffer">Buffer that will be the destination of the transfer</param>
-    /// <param name="size">Size of the data to be copied</param>
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size); 
+    void watchShaderSources();
 
-    static std::vector<char> readFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    /// <summary>
+    /// Compile every source which is or includes the changed file, then rebuild every pipeline made from one of them. Only queues the work.
+    /// </summary>
+    void reloadShader(const std::string& changedFile);
+    void rebuildPipelines(const std::set<std::string>& sourceFiles);
 
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file " + filename); 
-        }
+    /// <summary>
+    /// Swap the rebuilt pipelines in and destroy the retired ones which no frame in flight can use anymore, or all of them when the device is idle. 
+    /// Must be called before the command buffers of a frame are recorded.
+    /// </summary>
+    void updateReloadedPipelines(bool deviceIdle);
 
-        //get the size of the file
-        size_t fileSize = (size_t)file.tellg(); 
-        std::vector<char> buffer(fileSize); 
+    /// <summary>
+    /// Check the device for VK_EXT_graphics_pipeline_library, fills in the features to enable and adds the extensions when it is used
+    /// </summary>
+    void checkPipelineLibrarySupport(VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& features, std::vector<const char*>& extensions);
 
-        //move back to beginning of file to actually begin reading data
-        file.seekg(0);
-        file.read(buffer.data(), fileSize); 
+    /// <summary>
+    /// Stand-in for vkCreateGraphicsPipelines: with pipeline libraries the four parts of the pipeline are looked up in the cache 
+    /// (compiled when missing) and fast linked, otherwise a monolithic pipeline is created. Stages must match pipelineInfo.pStages.
+    /// </summary>
+    VkResult linkGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, const ShaderStage* stages, VkPipeline* pipeline);
+    VkResult createPipelineLibrary(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkGraphicsPipelineLibraryFlagsEXT part, VkPipeline* library);
+    VkResult linkPipelineLibraries(const PipelineLibraryLink& link, bool optimize, VkPipeline* pipeline);
 
-        //cleanup 
-        file.close(); 
-        return buffer; 
-    }
+    /// <summary>
+    /// When pipeline was fast linked, queue its optimized link on the shader workers. The result replaces it like a rebuilt pipeline.
+    /// </summary>
+    void scheduleOptimizedLink(VkPipeline* target, VkPipeline pipeline, uint32_t generation);
 
     /// <summary>
-    /// Callback function that is called by GLFW when the window is resized
+    /// Destroy the cached libraries made against a render pass which is about to be destroyed, or every library for VK_NULL_HANDLE
     /// </summary>
-    static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
-        //retreive the pointer to the instance of the class that was created in initWindow() -> glfwSetWindowUserPointer
-        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window)); 
-        app->frameBufferResized = true; 
+    void destroyPipelineLibraries(VkRenderPass renderPass);
+
+    /// <summary>
+    /// Check the device for VK_EXT_calibrated_timestamps when tracing, adds the extension when the host clock can be calibrated against the GPU
+    /// </summary>
+    void checkCalibratedTimestampSupport(std::vector<const char*>& extensions);
+
+    /// <summary>
+    /// Start recording the timelines of the main thread and the GPU queues. The zones of other threads are recorded once they call setTraceThreadName.
+    /// </summary>
+    void createTracing();
+    void setTraceThreadName(const std::string& name);
+    TraceBuffer* createTraceBuffer(const std::string& name);
+    void recordTraceEvent(TraceBuffer* buffer, const char* name, int64_t start, int64_t end);
+    static int64_t traceTime();
+
+    /// <summary>
+    /// Move the timestamps an image wrote onto the CPU clock and record them on the timelines of their queues
+    /// </summary>
+    void traceGpuTimestamps(const std::array<uint64_t, 4>& timestamps);
+
+    /// <summary>
+    /// Write every timeline to options.traceFile as Chrome trace JSON, which chrome://tracing and the Perfetto UI open
+    /// </summary>
+    void exportTrace();
+
+    /// <summary>
+    /// Enable the pipeline statistics queries when the options ask for them and the device supports them
+    /// </summary>
+    void checkPipelineStatisticsSupport(VkPhysicalDeviceFeatures& features);
+
+    /// <summary>
+    /// Create the pipeline statistics queries of every swapchain image
+    /// </summary>
+    void createPipelineStatisticsQueries();
+
+    /// <summary>
+    /// Wrap the commands of a scene pass in its pipeline statistics query. Must be recorded outside of a render pass.
+    /// </summary>
+    void beginPassStatistics(VkCommandBuffer commandBuffer, uint32_t imageIndex, ScenePass pass);
+    void endPassStatistics(VkCommandBuffer commandBuffer, uint32_t imageIndex, ScenePass pass);
+
+    /// <summary>
+    /// Read the statistics of the last frame which used the given image, the same way as its timestamps
+    /// </summary>
+    void readPipelineStatistics(uint32_t imageIndex);
+    void printPipelineStatistics();
+
+    /// <summary>
+    /// Check the device for VK_EXT_memory_budget when writing metrics or drawing the HUD, adds the extension so that the usage of every heap can be reported
+    /// </summary>
+    void checkMemoryBudgetSupport(std::vector<const char*>& extensions);
+
+    /// <summary>
+    /// Register every metric of the renderer, and start the metrics writer when options.metricsFile is set
+    /// </summary>
+    void createMetrics();
+    Metric* registerMetric(MetricType type, const std::string& name, const std::string& help, const std::string& labels = "", 
+        const std::vector<double>& bounds = {});
+
+    /// <summary>
+    /// Stop the metrics writer, writing the file one last time
+    /// </summary>
+    void destroyMetrics();
+
+    /// <summary>
+    /// Thread which samples the memory heaps and writes the metrics file every second, so that the render loop never waits on the disk
+    /// </summary>
+    void runMetricsWriter();
+    void sampleMemoryHeaps();
+
+    /// <summary>
+    /// Write the metrics in the Prometheus text exposition format. Goes through a temporary file, so a reader never sees half of it.
+    /// </summary>
+    void writeMetrics();
+
+    /// <summary>
+    /// Enable VK_EXT_debug_utils on the instance when tracking objects, so that every tracked object is named in the driver as well
+    /// </summary>
+    void checkDebugUtilsSupport(const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& extensions);
+    void createObjectTracker();
+
+    /// <summary>
+    /// Record a newly created object, or remove a destroyed one. Called right after every create and right before every destroy,
+    /// does nothing unless options.trackObjects is set or when the handle is VK_NULL_HANDLE.
+    /// </summary>
+    template <typename Handle>
+    void trackObject(VkObjectType type, Handle handle, const std::string& name) {
+        if (options.trackObjects) {
+            trackObjectHandle(type, (uint64_t)handle, name);
+        }
+    }
+    template <typename Handle>
+    void untrackObject(VkObjectType type, Handle handle) {
+        if (options.trackObjects) {
+            untrackObjectHandle(type, (uint64_t)handle);
+        }
+    }
+    void trackObjectHandle(VkObjectType type, uint64_t handle, const std::string& name);
+    void untrackObjectHandle(VkObjectType type, uint64_t handle);
+
+    /// <summary>
+    /// Bracket drawFrame: objects the render loop creates in between are churn once the renderer has warmed up
+    /// </summary>
+    void beginObjectFrame();
+    void endObjectFrame();
+
+    /// <summary>
+    /// Print the objects which are still alive and the churn seen while running, right before the device is destroyed
+    /// </summary>
+    void reportObjectLeaks();
+
+    /// <summary>
+    /// Allocator to create the instance and the device with: the counting callbacks with options.checkAllocations, the driver's own otherwise.
+    /// Commands which create no object allocate through the allocator of their device, so this covers what a frame allocates in the driver.
+    /// </summary>
+    const VkAllocationCallbacks* hostAllocator() const;
+
+    /// <summary>
+    /// Bracket drawFrame: heap allocations the render loop makes in between are counted into the metrics, and with options.checkAllocations
+    /// every frame after the warmup which allocated is reported
+    /// </summary>
+    void beginAllocationFrame();
+    void endAllocationFrame();
+
+    /// <summary>
+    /// Print how many steady-state frames allocated and fail the run if any did, with options.checkAllocations. Runs after cleanup.
+    /// </summary>
+    void checkSteadyStateAllocations();
+
+    /// <summary>
+    /// Size the ring of the flight recorder and start its writer thread, when options.hitchThreshold is set
+    /// </summary>
+    void createFlightRecorder();
+    void destroyFlightRecorder();
+
+    /// <summary>
+    /// Start the record of the current frame, after its frame time is known: a previous frame over the threshold starts a hitch unless it was
+    /// slow for a known reason, and once enough frames have followed one, the window around it is handed to the writer
+    /// </summary>
+    void beginFlightFrame();
+
+    /// <summary>
+    /// Time the end of a phase of the current frame
+    /// </summary>
+    void markFramePhase(FramePhase phase);
+    void endFlightFrame();
+
+    /// <summary>
+    /// Add the GPU times read back for an earlier frame to its record, if it is still in the ring
+    /// </summary>
+    void recordFlightGpuTimes(uint64_t frame, float sceneTime, float postTime);
+
+    /// <summary>
+    /// Copy the frames of the hitch window which are in the ring to the writer. Skipped when the writer is still busy with the last one.
+    /// </summary>
+    void handOverHitchWindow();
+
+    /// <summary>
+    /// Thread which writes every window it is handed as Chrome trace JSON, named after the frame of the hitch
+    /// </summary>
+    void runFlightRecorderWriter();
+    void writeHitchTrace(const std::vector<FlightRecord>& records, uint64_t frame, float interval);
+
+    /// <summary>
+    /// Open the windows of options.displays next to the main one, each on a monitor of its own while there are enough
+    /// </summary>
+    void createDisplayWindows();
+
+    /// <summary>
+    /// Create the surfaces, swapchains and acquire semaphores of the display windows. Their format has to be the one of the main swapchain.
+    /// </summary>
+    void createDisplays();
+    void destroyDisplays();
+    void createDisplaySwapChain(DisplayWindow& display);
+    void destroyDisplaySwapChain(DisplayWindow& display);
+
+    /// <summary>
+    /// Acquire an image of every display for the current frame. A display without one this frame is skipped, the others still present.
+    /// </summary>
+    void acquireDisplayImages();
+
+    /// <summary>
+    /// Record the copies of the output of the frame into the acquired display images, after the copy into the main swapchain image
+    /// </summary>
+    void recordDisplayCopies(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    /// <summary>
+    /// Recreate the swapchains of the displays which were out of date in this frame, leaving the main one alone
+    /// </summary>
+    void recreateOutOfDateDisplays();
+
+    /// <summary>
+    /// Check the device for what the batch views draw with, when the options ask for them: a viewport array and the viewport index and
+    /// layer written by the vertex shader (VK_EXT_shader_viewport_index_layer). Fills in the feature and adds the extension.
+    /// </summary>
+    void checkBatchViewSupport(VkPhysicalDeviceFeatures& features, std::vector<const char*>& extensions);
+
+    /// <summary>
+    /// Create the layered target, the render pass, the pipeline and the readback ring of the batch views
+    /// </summary>
+    void createBatchViews();
+    void destroyBatchViews();
+    VkPipeline buildBatchPipeline();
+
+    /// <summary>
+    /// Render options.batchCount batches through the readback ring instead of running the main loop, then print the throughput
+    /// </summary>
+    void runBatchViews();
+
+    /// <summary>
+    /// Place the cameras of every view of the batch on a spiral around the scene, each batch continues the spiral of the one before it
+    /// </summary>
+    void updateBatchCameras(BatchSlot& slot);
+
+    /// <summary>
+    /// Record the batch of a slot: every view in one pass, one instanced draw per object, then a single copy of all views into the readback buffer
+    /// </summary>
+    void recordBatch(BatchSlot& slot);
+
+    /// <summary>
+    /// Hand the views of a batch which has finished to whoever wants them -- written to options.batchDirectory when it is set
+    /// </summary>
+    void readBatch(const BatchSlot& slot);
+
+    /// <summary>
+    /// Create the offline outputs in place of the swapchain: as many as there are frames in flight, of options.offlineWidth x options.offlineHeight
+    /// or of a poster tile with its guard band
+    /// </summary>
+    void createOfflineOutputs();
+    void destroyOfflineOutputs();
+
+    /// <summary>
+    /// Render options.offlineFrames frames without presenting and write each as a QOI image, or every tile of the poster into its file,
+    /// instead of running the main loop. Prints how long each stage took, so that the slowest one can be told apart.
+    /// </summary>
+    void runOffline();
+
+    /// <summary>
+    /// Draw a frame into the output of the current frame in flight, once the workers are done with what was in it before
+    /// </summary>
+    void drawOfflineFrame();
+
+    /// <summary>
+    /// Hand the outputs whose frames have finished on the GPU to the I/O workers, without waiting on any
+    /// </summary>
+    void collectOfflineOutputs();
+
+    /// <summary>
+    /// Body of an I/O worker: compresses the oldest ready output, frees it for the render loop and then writes the file
+    /// </summary>
+    void runOfflineWorker();
+
+    /// <summary>
+    /// Check that the poster can be rendered with the other options and size the tiles of it. The offline outputs are a tile and its guard band.
+    /// </summary>
+    void createPosterTiles();
+
+    /// <summary>
+    /// Create options.posterFile with everything but the tiles: the header and the directory of the image, which point at where each tile
+    /// will be. Tiles are uncompressed, so the place of each is known before any is rendered and nothing of the image is kept in memory.
+    /// </summary>
+    void openPoster();
+    void closePoster();
+
+    /// <summary>
+    /// Projection of the whole poster, narrowed to what a tile and its guard band see of it
+    /// </summary>
+    glm::mat4 posterTileProjection(uint64_t tile);
+
+    /// <summary>
+    /// Copy the tile out of an output into the RGB rows the file holds, leaving the guard band out. Returns the size of the tile.
+    /// </summary>
+    size_t packPosterTile(const OfflineOutput& output, std::vector<unsigned char>& packed);
+    bool writePosterTile(uint64_t tile, const unsigned char* packed, size_t size);
+
+    /// <summary>
+    /// Map the capture given with --replay and check that it fits the renderer. Runs before the window is created, which takes the size of the capture.
+    /// </summary>
+    void openReplay();
+    void closeReplay();
+
+    /// <summary>
+    /// Replace the built-in scene and lights with those of the replayed capture, before they are uploaded
+    /// </summary>
+    void loadReplayScene();
+
+    /// <summary>
+    /// Move the dynamic objects to where they were in the frame being replayed, instead of animating them
+    /// </summary>
+    void applyReplayFrame();
+
+    /// <summary>
+    /// Draw every frame of the capture and print the CPU and GPU frame times. Runs instead of the main loop.
+    /// </summary>
+    void runReplay();
+
+    /// <summary>
+    /// Open the capture file given with --capture and write the scene to it, once it is created
+    /// </summary>
+    void createCapture();
+
+    /// <summary>
+    /// Append the inputs of the current frame to the capture: its start time, the animation time, the render scale and the dynamic objects
+    /// </summary>
+    void captureFrame(float time);
+    void destroyCapture();
+
+    /// <summary>
+    /// Create the HUD pass: its pipeline, which writes the same output format as the upscale pass, and a mapped buffer and descriptor set per image
+    /// </summary>
+    void createHud();
+    void destroyHud();
+
+    /// <summary>
+    /// Add the last frame to the samples of the HUD, fill in its text and copy both into the HUD buffer of the given image
+    /// </summary>
+    void updateHud(uint32_t imageIndex);
+
+    /// <summary>
+    /// Draw the HUD over the LDR output of the image, after the upscale pass. Records nothing when the HUD is off or hidden.
+    /// </summary>
+    void recordHud(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    /// <summary>
+    /// Check that the device can render options.views views in one pass and fill in the multiview feature to enable, when there is more than one
+    /// </summary>
+    void checkMultiviewSupport(VkPhysicalDeviceMultiviewFeatures& features);
+
+    /// <summary>
+    /// Chain the view mask to the create info of a render pass which draws the scene from every view
+    /// </summary>
+    void addRenderPassViews(VkRenderPassCreateInfo& renderPassInfo);
+
+    /// <summary>
+    /// Place the cameras of the views next to the main camera, all looking at the point it looks at
+    /// </summary>
+    void updateViewProjections(UniformBufferObject& ubo, const glm::vec3& eye, const glm::vec3& target);
+
+    /// <summary>
+    /// Check the device for VK_EXT_shader_object when the options ask for it, fills in the features to enable and adds the extensions when it is used
+    /// </summary>
+    void checkShaderObjectSupport(VkPhysicalDeviceShaderObjectFeaturesEXT& features, VkPhysicalDeviceDynamicRenderingFeaturesKHR& dynamicRenderingFeatures, std::vector<const char*>& extensions);
+
+    /// <summary>
+    /// Load the shader object entry points and create a shader object for each shader of the scene passes
+    /// </summary>
+    void createShaderObjects();
+    VkShaderEXT createShaderObject(const std::string& variantName, VkShaderStageFlags nextStage);
+    void destroyShaderObjects();
+
+    /// <summary>
+    /// Bind what a scene pass is drawn with and set its viewport and scissor: its pipeline, or its shader objects along with every piece of state
+    /// the pipeline would have held. Must be recorded between beginScenePass and endScenePass.
+    /// </summary>
+    void bindScenePass(VkCommandBuffer commandBuffer, ScenePass pass, const VkViewport& viewport, const VkRect2D& scissor);
+
+    /// <summary>
+    /// Begin a scene pass: its render pass, or with shader objects the same attachments through dynamic rendering, with barriers in place of the
+    /// layout transitions and dependencies of the render pass. Target is the swapchain image of the main pass or the cascade of a shadow pass.
+    /// </summary>
+    void beginScenePass(VkCommandBuffer commandBuffer, ScenePass pass, const VkRenderPassBeginInfo& renderPassInfo, uint32_t target);
+    void endScenePass(VkCommandBuffer commandBuffer, ScenePass pass, uint32_t target);
+
+    /// <summary>
+    /// Render a number of frames with pipelines and then with shader objects, and print the CPU recording time and GPU time of both. Runs instead of the main loop.
+    /// </summary>
+    void runShaderObjectBenchmark();
+
+    /// <summary>
+    /// Create a rendering pass object which will tell vulkan information about framebuffer attachments:
+    /// number of color and depth buffers, how many samples to use for each, how to handle contents
+    /// </summary>
+    void createRenderPass(); 
+    
+    /// <summary>
+    /// Create framebuffers that will hold representations of the images in the swapchain
+    /// </summary>
+    void createFramebuffers(); 
+
+    /// <summary>
+    /// Create command pools which will contain all predefined draw commands for later use in vulkan main loop
+    /// </summary>
+    void createCommandPools(); 
+
+    
+    void createPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, VkCommandPool &pool); 
+
+    /// <summary>
+    /// Allocate a command buffer for each swapchain image
+    /// </summary>
+    void createCommandBuffers(); 
+
+    /// <summary>
+    /// Record the scene commands for the given swapchain image. Recorded every frame since the render area changes with the render scale.
+    /// </summary>
+    void recordCommandBuffer(uint32_t imageIndex);
+
+    /// <summary>
+    /// Create semaphores that are going to be used to sync rendering and presentation queues
+    /// </summary>
+    void createSemaphores(); 
+
+    /// <summary>
+    /// Fences are needed for CPU-GPU sync. Creates these required objects
+    /// </summary>
+    void createFences(); 
+
+    /// <summary>
+    /// Create tracking information in order to link fences with the swap chain images using 
+    /// </summary>
+    void createFenceImageTracking();
+
+    /// <summary>
+    /// Create a vertex buffer to hold the vertex information that will be passed to the GPU. 
+    /// </summary>
+    void createVertexBuffer(); 
+
+    /// <summary>
+    /// Create a buffer with the given arguments
+    /// </summary>
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory); 
+
+    /// <summary>
+    /// Copy data from one buffer to another
+    /// </summary>
+    /// <param name="srcBuffer">Buffer that will act as the source in the transfer</param>
+    /// <param name="dstBuffer">Buffer that will be the destination of the transfer</param>
+    /// <param name="size">Size of the data to be copied</param>
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+
+    /// <summary>
+    /// Describe the resources that the shaders will access. Shared by the graphics pipeline and the light binning compute pipeline.
+    /// </summary>
+    void createDescriptorSetLayout();
+
+    /// <summary>
+    /// Create a uniform buffer for each swapchain image so that a frame in flight is never overwritten
+    /// </summary>
+    void createUniformBuffers();
+
+    /// <summary>
+    /// Create the pool which the descriptor sets will be allocated from
+    /// </summary>
+    void createDescriptorPool();
+
+    /// <summary>
+    /// Allocate a descriptor set for each swapchain image and point it at the buffers of that image
+    /// </summary>
+    void createDescriptorSets();
+
+    /// <summary>
+    /// Write the camera and light data for the frame which will be rendered to the given swapchain image
+    /// </summary>
+    void updateUniformBuffer(uint32_t currentImage);
+
+    /// <summary>
+    /// Generate the starting positions and colors for all lights in the scene
+    /// </summary>
+    void createLights();
+
+    /// <summary>
+    /// Create the light storage buffers along with the light grid and light index list that the binning pass writes into
+    /// </summary>
+    void createClusterBuffers();
+
+    /// <summary>
+    /// Create the compute pipeline which bins the lights into the cluster grid
+    /// </summary>
+    void createClusterPipeline();
+
+    /// <summary>
+    /// Record the light binning dispatch for a frame. Must be recorded outside of a render pass, before the draw that uses the results.
+    /// </summary>
+    void recordLightBinning(VkCommandBuffer commandBuffer, size_t imageIndex);
+
+    /// <summary>
+    /// Create a 2D image and bind newly allocated memory to it. 
+    /// If more than one queue family is given the image is shared concurrently between them.
+    /// </summary>
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, 
+        VkImage& image, VkDeviceMemory& imageMemory, const std::vector<uint32_t>& queueFamilies = {}, uint32_t arrayLayers = 1);
+
+    /// <summary>
+    /// Create a 2D view of a single mip level of the given image, or a 2D array view of its first layers
+    /// </summary>
+    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevel = 0,
+        VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, uint32_t layerCount = 1);
+
+    /// <summary>
+    /// Destroy an attachment created with createImage/createImageView and reset its handles
+    /// </summary>
+    void destroyAttachment(ImageAttachment& attachment);
+
+    /// <summary>
+    /// Pick the first format of the candidates which supports the requested features for the given tiling
+    /// </summary>
+    VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+    VkFormat findDepthFormat();
+
+    /// <summary>
+    /// Create an attachment which only needs to exist during a render pass. Uses lazily allocated memory when the device has it, 
+    /// so that tiled GPUs never have to back the attachment with real memory.
+    /// </summary>
+    void createTransientAttachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags, ImageAttachment& attachment);
+
+    /// <summary>
+    /// Create the color attachments of the G-buffer used by the deferred render pass
+    /// </summary>
+    void createGBuffer();
+
+    /// <summary>
+    /// Create the deferred shading render pass: 
+    /// subpass 0 writes the G-buffer, subpass 1 reads it through input attachments and writes the lit result to the HDR target
+    /// </summary>
+    void createDeferredRenderPass();
+
+    /// <summary>
+    /// Create the pipeline for the lighting subpass, which draws a single fullscreen triangle
+    /// </summary>
+    void createLightingPipeline();
+    VkPipeline buildLightingPipeline();
+
+    /// <summary>
+    /// Point the input attachment descriptors at the current G-buffer
+    /// </summary>
+    void createGBufferDescriptorSet();
+
+    /// <summary>
+    /// Build the vertices and objects of the scene: a floor, static pillars and the original triangle, which spins
+    /// </summary>
+    void createScene();
+
+    /// <summary>
+    /// Add the two triangles of a quad to the vertices, facing the side the normal points to
+    /// </summary>
+    void addSceneQuad(const glm::vec3 corners[4], const glm::vec3& normal, const glm::vec3& color);
+
+    /// <summary>
+    /// Record the vertices added since firstVertex as a new object, with a bounding sphere around them
+    /// </summary>
+    void addSceneObject(uint32_t firstVertex, bool isStatic);
+
+    /// <summary>
+    /// Move the dynamic objects of the scene to where they are at the given time
+    /// </summary>
+    void updateScene(float time);
+
+    /// <summary>
+    /// Build the generated stress scene from options.stress instead of the built-in scene
+    /// </summary>
+    void createStressScene();
+    void updateStressScene(float time);
+
+    /// <summary>
+    /// Create the depth attachment written by the depth prepass, at the size of the swap chain images
+    /// </summary>
+    void createDepthAttachment();
+
+    /// <summary>
+    /// Create the cascade array, its sampler, the depth only render passes and the shadow framebuffers. These do not depend on the swapchain.
+    /// </summary>
+    void createShadowResources();
+    void destroyShadowResources();
+
+    /// <summary>
+    /// Create the depth prepass and shadow pipelines, which only read the position stream, along with the cascade fit compute pipelines
+    /// </summary>
+    void createShadowPipelines();
+
+    /// <summary>
+    /// Create the depth prepass pipeline, or the shadow pipeline which draws both faces with a depth bias
+    /// </summary>
+    VkPipeline buildDepthOnlyPipeline(bool shadowPass);
+
+    /// <summary>
+    /// Create the cascade and depth bounds buffers of each swapchain image
+    /// </summary>
+    void createShadowBuffers();
+
+    /// <summary>
+    /// Fill in the shadow values of the uniform buffer, write the static cascades of the given image and pick the cascades to render this frame
+    /// </summary>
+    void updateShadowCascades(uint32_t imageIndex, UniformBufferObject& ubo);
+
+    /// <summary>
+    /// Record the depth prepass, the cascade fit and the shadow passes. Must be recorded outside of a render pass, before the main render pass.
+    /// </summary>
+    void recordShadowPasses(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    /// <summary>
+    /// Record the reduction of the prepass depth and the fit of the dynamic cascades to it
+    /// </summary>
+    void recordCascadeFit(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    /// <summary>
+    /// Draw every scene object with its model matrix. Binds only the position stream for depth only pipelines.
+    /// </summary>
+    void recordSceneDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, bool positionsOnly, uint32_t cascade);
+
+    /// <summary>
+    /// Queue families which touch the images used by post processing, without duplicates
+    /// </summary>
+    std::vector<uint32_t> getPostProcessQueueFamilies();
+
+    /// <summary>
+    /// Create the HDR target the scene is rendered into along with the bloom chain and LDR output of each swapchain image
+    /// </summary>
+    void createPostProcessTargets();
+
+    void destroyPostProcessTargets();
+
+    /// <summary>
+    /// Create the sampler, layouts and compute pipelines of the post processing chain. 
+    /// The composite pipeline bakes in the channel order and encoding of the swapchain format.
+    /// </summary>
+    void createPostProcessPipelines();
+
+    /// <summary>
+    /// Allocate the descriptor sets of every post processing dispatch of every swapchain image
+    /// </summary>
+    void createPostProcessDescriptorSets();
+
+    /// <summary>
+    /// Allocate the post processing command buffer of each swapchain image. These are submitted to the compute queue.
+    /// </summary>
+    void createComputeCommandBuffers();
+
+    /// <summary>
+    /// Record the post processing chain for the given swapchain image, ending with the copy into the swapchain image
+    /// </summary>
+    void recordPostProcessCommands(uint32_t imageIndex);
+
+    /// <summary>
+    /// Create the timestamp queries used to measure the GPU time of each frame
+    /// </summary>
+    void createTimestampQueries();
+
+    /// <summary>
+    /// Read the GPU time of the last frame which used the given image and pick the render scale of the next frame from it
+    /// </summary>
+    void updateRenderScale(uint32_t imageIndex);
+
+    static std::vector<char> readFile(const std::string& filename) {
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file " + filename); 
+        }
+
+        //get the size of the file
+        size_t fileSize = (size_t)file.tellg(); 
+        std::vector<char> buffer(fileSize); 
+
+        //move back to beginning of file to actually begin reading data
+        file.seekg(0);
+        file.read(buffer.data(), fileSize); 
+
+        //cleanup 
+        file.close(); 
+        return buffer; 
+    }
+
+    /// <summary>
+    /// Callback function that is called by GLFW when the window is resized
+    /// </summary>
+    static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+        //retreive the pointer to the instance of the class that was created in initWindow() -> glfwSetWindowUserPointer
+        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window)); 
+        app->frameBufferResized = true; 
+    }
+
+    /// <summary>
+    /// Callback function that is called by GLFW on key presses: F12 writes the trace recorded so far, F1 hides and shows the HUD
+    /// </summary>
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        if (key == GLFW_KEY_F12 && action == GLFW_PRESS && app->tracing) {
+            app->exportTrace();
+        }
+        if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+            app->hudVisible = !app->hudVisible;
+        }
+    }
+
+    /// <summary>
+    /// Callback function that is called by GLFW when a display window is closed: it closes the main window, which ends the main loop
+    /// </summary>
+    static void displayCloseCallback(GLFWwindow* window) {
+        auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        glfwSetWindowShouldClose(app->window, GLFW_TRUE);
     }
 
 #pragma region Unused Functions
@@ -0,0 +1,292 @@
+#include "HelloTriangleApplication.h"
+
+#include <cstdio>
+
+/*
+* HUD
+*   Frame times, GPU pass times and memory use drawn over the final image, for when nobody is watching stdout.
+*   It is one more compute pass at the end of the post processing chain, a single dispatch over the HUD rectangle of the LDR output,
+*   right before the copy into the swapchain image. The post processing runs on the compute queue, which may not be able to rasterize,
+*   so the text and the graph are drawn by the compute shader rather than by instanced quads: every invocation decides on its own pixel.
+*   The ring of frame time samples lives on the GPU: the CPU only copies the text, the newest sample and where it goes into the mapped
+*   HUD buffer of the image, and the pass writes the sample into the ring before the graph reads it. The pass also scales the graph
+*   to the slowest sample it holds. While the HUD is hidden the pass still runs, over no pixels, so that the ring misses no frames.
+*   The pass measures itself with a pair of timestamps and shows the result, so its cost stays visible.
+*/
+
+//frames between two samples of the memory heaps
+const uint64_t HUD_MEMORY_INTERVAL = 30;
+
+void HelloTriangleApplication::createHud() {
+    if (!options.hud) {
+        return;
+    }
+
+    /* Descriptor Set Layout */
+    //0. LDR output, storage
+    //1. HUD buffer
+    //2. ring of samples
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &hudSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create HUD descriptor set layout");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, hudSetLayout, "hudSetLayout");
+
+    /* Pipeline */
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(HudPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &hudSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &hudPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create HUD pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, hudPipelineLayout, "hudPipelineLayout");
+
+    //the HUD writes into the image the upscale pass wrote, so it takes the output format constants of that variant
+    const ShaderVariant& upscale = shaderVariants["upscale"];
+    shaderVariants["hud"] = { "hud.comp", "hud.spv", VK_SHADER_STAGE_COMPUTE_BIT, { upscale.constants[0], upscale.constants[1] } };
+
+    VkPipelineLayout layout = hudPipelineLayout;
+    createReloadablePipeline(hudPipeline, { "hud" }, [this, layout]() { return buildComputePipeline("hud", layout); });
+
+    /* Buffers */
+    size_t imageCount = swapChainImages.size();
+    hudBuffers.resize(imageCount);
+    hudBuffersMemory.resize(imageCount);
+    hudBuffersMapped.resize(imageCount);
+    hudTimestampsWritten.assign(imageCount, false);
+
+    for (size_t i = 0; i < imageCount; i++) {
+        //rewritten by the CPU every frame, kept mapped like the light buffers
+        createBuffer(sizeof(HudData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            hudBuffers[i], hudBuffersMemory[i]);
+        vkMapMemory(device, hudBuffersMemory[i], 0, sizeof(HudData), 0, &hudBuffersMapped[i]);
+    }
+
+    //shared by every image, the frames write into it in the order they are submitted. Cleared by the first frame recorded after this
+    createBuffer(HudData::SAMPLES * sizeof(glm::vec2), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, hudHistoryBuffer, hudHistoryMemory);
+    hudHistoryCleared = false;
+
+    /* Descriptor Sets */
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[0].descriptorCount = static_cast<uint32_t>(imageCount);
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(imageCount) * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = static_cast<uint32_t>(imageCount);
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &hudDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create HUD descriptor pool");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, hudDescriptorPool, "hudDescriptorPool");
+
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, hudSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = hudDescriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(imageCount);
+    allocInfo.pSetLayouts = layouts.data();
+
+    hudDescriptorSets.resize(imageCount);
+    if (vkAllocateDescriptorSets(device, &allocInfo, hudDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate HUD descriptor sets");
+    }
+
+    for (size_t i = 0; i < imageCount; i++) {
+        VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, ldrTargets[i].view, VK_IMAGE_LAYOUT_GENERAL };
+        VkDescriptorBufferInfo bufferInfo{ hudBuffers[i], 0, sizeof(HudData) };
+        VkDescriptorBufferInfo historyInfo{ hudHistoryBuffer, 0, VK_WHOLE_SIZE };
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+        for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+            descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[j].dstSet = hudDescriptorSets[i];
+            descriptorWrites[j].dstBinding = j;
+            descriptorWrites[j].descriptorCount = 1;
+        }
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[0].pImageInfo = &imageInfo;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[1].pBufferInfo = &bufferInfo;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[2].pBufferInfo = &historyInfo;
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    /* Memory Heaps */
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    hudHeaps.clear();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            hudHeaps.push_back(i);
+        }
+    }
+}
+
+void HelloTriangleApplication::destroyHud() {
+    if (!options.hud) {
+        return;
+    }
+
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, hudPipeline);
+    vkDestroyPipeline(device, hudPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, hudPipelineLayout);
+    vkDestroyPipelineLayout(device, hudPipelineLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, hudSetLayout);
+    vkDestroyDescriptorSetLayout(device, hudSetLayout, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, hudDescriptorPool);
+    vkDestroyDescriptorPool(device, hudDescriptorPool, nullptr);
+
+    for (size_t i = 0; i < hudBuffers.size(); i++) {
+        untrackObject(VK_OBJECT_TYPE_BUFFER, hudBuffers[i]);
+        vkDestroyBuffer(device, hudBuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, hudBuffersMemory[i]);
+        vkFreeMemory(device, hudBuffersMemory[i], nullptr);
+    }
+    hudBuffers.clear();
+    hudBuffersMemory.clear();
+    hudBuffersMapped.clear();
+
+    untrackObject(VK_OBJECT_TYPE_BUFFER, hudHistoryBuffer);
+    vkDestroyBuffer(device, hudHistoryBuffer, nullptr);
+    untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, hudHistoryMemory);
+    vkFreeMemory(device, hudHistoryMemory, nullptr);
+}
+
+void HelloTriangleApplication::updateHud(uint32_t imageIndex) {
+    if (!options.hud) {
+        return;
+    }
+
+    /* Own Timing */
+    //written by the frame which last used this image, which has finished, like the other timestamps
+    if (hudTimestampsWritten[imageIndex]) {
+        std::array<uint64_t, 2> timestamps{};
+        VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 4, 2,
+            sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            hudTime = static_cast<float>((timestamps[1] - timestamps[0]) & computeTimestampMask) * timestampPeriod / 1000000.0f;
+        }
+    }
+
+    /* Samples */
+    //the slot of the oldest sample takes the newest one, hud.comp writes it there
+    hudData.head = (hudData.head + 1) % HudData::SAMPLES;
+    hudData.newest = glm::vec2(cpuFrameTime, gpuFrameTime);
+
+    /* Memory */
+    if (frameNumber % HUD_MEMORY_INTERVAL == 0) {
+        sampleMemoryHeaps();
+    }
+
+    //with VK_EXT_memory_budget: used / budget of the device local heaps, their size otherwise
+    double usedMemory = 0.0;
+    double availableMemory = 0.0;
+    for (uint32_t heap : hudHeaps) {
+        if (memoryBudgetSupported) {
+            usedMemory += heapUsageMetrics[heap]->value.load(std::memory_order_relaxed);
+            availableMemory += heapBudgetMetrics[heap]->value.load(std::memory_order_relaxed);
+        }
+        else {
+            availableMemory += heapSizeMetrics[heap]->value.load(std::memory_order_relaxed);
+        }
+    }
+    const double MEGABYTE = 1024.0 * 1024.0;
+
+    /* Text */
+    char lines[HudData::TEXT_LINES][HudData::TEXT_COLUMNS + 1] = {};
+    snprintf(lines[0], sizeof(lines[0]), "CPU %5.2f MS  REC %4.2f MS", cpuFrameTime, recordTime);
+    snprintf(lines[1], sizeof(lines[1]), "GPU %5.2f SCENE %.2f POST %.2f", gpuFrameTime, gpuSceneTime, gpuPostTime);
+    if (memoryBudgetSupported) {
+        snprintf(lines[2], sizeof(lines[2]), "VRAM %.0f / %.0f MB", usedMemory / MEGABYTE, availableMemory / MEGABYTE);
+    }
+    else {
+        snprintf(lines[2], sizeof(lines[2]), "VRAM %.0f MB", availableMemory / MEGABYTE);
+    }
+    snprintf(lines[3], sizeof(lines[3]), "SCALE %.2f HUD %.2f ALLOC %u", renderScale, hudTime, static_cast<unsigned>(std::min<uint64_t>(frameHeapAllocations, 9999)));
+
+    for (uint32_t line = 0; line < HudData::TEXT_LINES; line++) {
+        for (uint32_t column = 0; column < HudData::TEXT_COLUMNS; column++) {
+            hudData.text[line * HudData::TEXT_COLUMNS + column] = static_cast<uint32_t>(static_cast<unsigned char>(lines[line][column]));
+        }
+    }
+
+    memcpy(hudBuffersMapped[imageIndex], &hudData, sizeof(hudData));
+}
+
+void HelloTriangleApplication::recordHud(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    if (!options.hud) {
+        return;
+    }
+    bool visible = hudVisible;
+    hudTimestampsWritten[imageIndex] = visible && computeTimestampMask != 0;
+
+    //the memory of the ring starts out undefined, its samples are shown as empty until a frame has written them
+    VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if (!hudHistoryCleared) {
+        vkCmdFillBuffer(commandBuffer, hudHistoryBuffer, 0, VK_WHOLE_SIZE, 0);
+        srcStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+        hudHistoryCleared = true;
+    }
+
+    //draws over what the upscale pass wrote, and reads the ring as the HUD pass of the frame before it left it
+    VkMemoryBarrier outputBarrier{};
+    outputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    outputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    outputBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &outputBarrier, 0, nullptr, 0, nullptr);
+
+    if (visible && computeTimestampMask != 0) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 4);
+    }
+
+    //top left corner, kept clear of the window border. A hidden HUD covers no pixels, a single group only adds the sample to the ring
+    HudPushConstants push{};
+    push.origin = glm::ivec2(8, 8);
+    push.size = visible ? glm::ivec2(HUD_WIDTH, HUD_HEIGHT) : glm::ivec2(0, 0);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hudPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hudPipelineLayout, 0, 1, &hudDescriptorSets[imageIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, hudPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    if (visible) {
+        vkCmdDispatch(commandBuffer, (HUD_WIDTH + 7) / 8, (HUD_HEIGHT + 7) / 8, 1);
+    }
+    else {
+        vkCmdDispatch(commandBuffer, 1, 1, 1);
+    }
+
+    if (visible && computeTimestampMask != 0) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 5);
+    }
+}
@@ -0,0 +1,245 @@
+#include "HelloTriangleApplication.h"
+
+#include <filesystem>
+#include <sstream>
+
+/*
+* Metrics
+*   Counters, gauges and histograms of the renderer, for watching it from outside rather than reading the Frames line on stdout.
+*   Every metric is registered once at startup, so the render loop and the shader workers only ever touch atomics:
+*   a frame costs a handful of relaxed atomic adds and no lock.
+*   A writer thread samples the memory heaps and writes everything once a second in the Prometheus text exposition format,
+*   to the file given with --metrics-file. Pointing the textfile collector of node_exporter at its directory publishes it.
+*/
+
+const auto METRICS_WRITE_INTERVAL = std::chrono::seconds(1);
+//seconds, around the usual refresh rates
+const std::vector<double> FRAME_TIME_BUCKETS = { 0.002, 0.004, 0.007, 0.0111, 0.0167, 0.0222, 0.0333, 0.05, 0.1, 0.25 };
+
+/// <summary>
+/// Add to an atomic double. std::atomic<double>::fetch_add is C++20, a compare exchange loop is lock-free as well.
+/// </summary>
+static void atomicAdd(std::atomic<double>& target, double amount) {
+    double expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + amount, std::memory_order_relaxed)) {
+    }
+}
+
+void HelloTriangleApplication::Metric::increment(double amount) {
+    atomicAdd(value, amount);
+}
+
+void HelloTriangleApplication::Metric::set(double newValue) {
+    value.store(newValue, std::memory_order_relaxed);
+}
+
+void HelloTriangleApplication::Metric::observe(double sample) {
+    //first bucket whose upper bound holds the sample, the +Inf bucket when none does
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), sample) - bounds.begin();
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    atomicAdd(sum, sample);
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HelloTriangleApplication::checkMemoryBudgetSupport(std::vector<const char*>& extensions) {
+    memoryBudgetSupported = false;
+    if ((options.metricsFile.empty() && !options.hud) || !isDeviceExtensionAvailable(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        return;
+    }
+
+    memoryBudgetSupported = true;
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+HelloTriangleApplication::Metric* HelloTriangleApplication::registerMetric(MetricType type, const std::string& name, const std::string& help,
+    const std::string& labels, const std::vector<double>& bounds) {
+    auto metric = std::make_unique<Metric>();
+    metric->type = type;
+    metric->name = name;
+    metric->labels = labels;
+    metric->help = help;
+
+    if (type == MetricType::Histogram) {
+        metric->bounds = bounds;
+        metric->buckets = std::make_unique<std::atomic<uint64_t>[]>(bounds.size() + 1);
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            metric->buckets[i].store(0);
+        }
+    }
+
+    metrics.push_back(std::move(metric));
+    return metrics.back().get();
+}
+
+void HelloTriangleApplication::createMetrics() {
+    //series of the same name are registered one after another, they are written under a single HELP and TYPE
+    framesMetric = registerMetric(MetricType::Counter, "renderer_frames_total", "Frames drawn.");
+    frameTimeMetric = registerMetric(MetricType::Histogram, "renderer_frame_time_seconds",
+        "Time between the starts of consecutive frames on the CPU.", "", FRAME_TIME_BUCKETS);
+    gpuFrameTimeMetric = registerMetric(MetricType::Histogram, "renderer_gpu_frame_time_seconds",
+        "GPU time of the graphics and post processing submits of a frame.", "", FRAME_TIME_BUCKETS);
+    renderScaleMetric = registerMetric(MetricType::Gauge, "renderer_render_scale", "Render resolution relative to the swapchain.");
+    renderScaleMetric->set(renderScale);
+
+    graphicsSubmitsMetric = registerMetric(MetricType::Counter, "renderer_queue_submits_total", "Calls to vkQueueSubmit.", "queue=\"graphics\"");
+    computeSubmitsMetric = registerMetric(MetricType::Counter, "renderer_queue_submits_total", "Calls to vkQueueSubmit.", "queue=\"compute\"");
+    transferSubmitsMetric = registerMetric(MetricType::Counter, "renderer_queue_submits_total", "Calls to vkQueueSubmit.", "queue=\"transfer\"");
+    uploadBytesMetric = registerMetric(MetricType::Counter, "renderer_upload_bytes_total", "Bytes copied from staging buffers to device local buffers.");
+
+    pipelineLibraryHitsMetric = registerMetric(MetricType::Counter, "renderer_pipeline_library_lookups_total",
+        "Lookups of a pipeline part in the pipeline library cache.", "result=\"hit\"");
+    pipelineLibraryMissesMetric = registerMetric(MetricType::Counter, "renderer_pipeline_library_lookups_total",
+        "Lookups of a pipeline part in the pipeline library cache.", "result=\"miss\"");
+    shaderCacheHitsMetric = registerMetric(MetricType::Counter, "renderer_shader_cache_lookups_total",
+        "Lookups of compiled SPIR-V in the on-disk shader cache.", "result=\"hit\"");
+    shaderCacheMissesMetric = registerMetric(MetricType::Counter, "renderer_shader_cache_lookups_total",
+        "Lookups of compiled SPIR-V in the on-disk shader cache.", "result=\"miss\"");
+
+    swapchainRecreationsMetric = registerMetric(MetricType::Counter, "renderer_swapchain_recreations_total", "Times the swapchain was recreated.");
+    heapAllocationsMetric = registerMetric(MetricType::Counter, "renderer_heap_allocations_total", "Heap allocations made while drawing frames.");
+    frameHeapAllocationsMetric = registerMetric(MetricType::Gauge, "renderer_frame_heap_allocations", "Heap allocations made while drawing the last frame.");
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    heapSizeMetrics.clear();
+    heapUsageMetrics.clear();
+    heapBudgetMetrics.clear();
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        std::string labels = "heap=\"" + std::to_string(i) + "\",device_local=\""
+            + ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false") + "\"";
+        heapSizeMetrics.push_back(registerMetric(MetricType::Gauge, "renderer_memory_heap_size_bytes", "Size of the memory heap.", labels));
+        heapSizeMetrics.back()->set(static_cast<double>(memoryProperties.memoryHeaps[i].size));
+    }
+    if (memoryBudgetSupported) {
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            heapUsageMetrics.push_back(registerMetric(MetricType::Gauge, "renderer_memory_heap_usage_bytes",
+                "Memory of the heap in use by this process.", heapSizeMetrics[i]->labels));
+        }
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            heapBudgetMetrics.push_back(registerMetric(MetricType::Gauge, "renderer_memory_heap_budget_bytes",
+                "Memory of the heap this process can use before allocations start to fail or slow down.", heapSizeMetrics[i]->labels));
+        }
+    }
+
+    if (!options.metricsFile.empty()) {
+        stopMetricsWriter = false;
+        metricsWriter = std::thread([this]() { runMetricsWriter(); });
+    }
+}
+
+void HelloTriangleApplication::destroyMetrics() {
+    if (!metricsWriter.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        stopMetricsWriter = true;
+    }
+    metricsCondition.notify_all();
+    metricsWriter.join();
+}
+
+void HelloTriangleApplication::runMetricsWriter() {
+    setTraceThreadName("metrics writer");
+
+    std::unique_lock<std::mutex> lock(metricsMutex);
+    while (true) {
+        bool stopping = metricsCondition.wait_for(lock, METRICS_WRITE_INTERVAL, [this]() { return stopMetricsWriter; });
+
+        //the last write at shutdown holds the final counts
+        sampleMemoryHeaps();
+        writeMetrics();
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void HelloTriangleApplication::sampleMemoryHeaps() {
+    if (!memoryBudgetSupported) {
+        return;
+    }
+
+    //queries of a physical device need no synchronization with the render loop
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+    for (size_t i = 0; i < heapUsageMetrics.size(); i++) {
+        heapUsageMetrics[i]->set(static_cast<double>(budgetProperties.heapUsage[i]));
+        heapBudgetMetrics[i]->set(static_cast<double>(budgetProperties.heapBudget[i]));
+    }
+}
+
+void HelloTriangleApplication::writeMetrics() {
+    TraceZone zone(*this, "writeMetrics");
+
+    std::ostringstream text;
+    //enough digits for byte counts to stay exact, few enough for the sums not to show rounding noise
+    text.precision(15);
+
+    //labels of a series, with one more label appended for the buckets of a histogram
+    auto series = [](const Metric& metric, const std::string& extraLabel) {
+        std::string labels = metric.labels;
+        if (!extraLabel.empty()) {
+            labels += (labels.empty() ? "" : ",") + extraLabel;
+        }
+        return labels.empty() ? std::string() : "{" + labels + "}";
+    };
+
+    const std::string* family = nullptr;
+    for (const auto& metric : metrics) {
+        if (family == nullptr || *family != metric->name) {
+            const char* typeNames[] = { "counter", "gauge", "histogram" };
+            text << "# HELP " << metric->name << " " << metric->help << "\n";
+            text << "# TYPE " << metric->name << " " << typeNames[static_cast<size_t>(metric->type)] << "\n";
+            family = &metric->name;
+        }
+
+        if (metric->type != MetricType::Histogram) {
+            text << metric->name << series(*metric, "") << " " << metric->value.load(std::memory_order_relaxed) << "\n";
+            continue;
+        }
+
+        //buckets are read before the count, which is added to last: +Inf never ends up below the other buckets
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < metric->bounds.size(); i++) {
+            cumulative += metric->buckets[i].load(std::memory_order_relaxed);
+            std::ostringstream bound;
+            bound << metric->bounds[i];
+            text << metric->name << "_bucket" << series(*metric, "le=\"" + bound.str() + "\"") << " " << cumulative << "\n";
+        }
+        cumulative += metric->buckets[metric->bounds.size()].load(std::memory_order_relaxed);
+        uint64_t count = std::max(cumulative, metric->count.load(std::memory_order_relaxed));
+
+        text << metric->name << "_bucket" << series(*metric, "le=\"+Inf\"") << " " << count << "\n";
+        text << metric->name << "_sum" << series(*metric, "") << " " << metric->sum.load(std::memory_order_relaxed) << "\n";
+        text << metric->name << "_count" << series(*metric, "") << " " << count << "\n";
+    }
+
+    std::filesystem::path path = options.metricsFile;
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        if (!file) {
+            std::cerr << "failed to open metrics file " << temporaryPath.string() << std::endl;
+            return;
+        }
+        file << text.str();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::cerr << "failed to write metrics file " << path.string() << ": " << error.message() << std::endl;
+    }
+}
@@ -0,0 +1,88 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Multiview
+*   With --views N the depth prepass and the main pass draw the scene from N cameras at once: VK_KHR_multiview (core in vulkan 1.1)
+*   broadcasts every draw to the layers of the attachments set in the view mask of the render pass, and the vertex shader picks
+*   the camera of its layer by gl_ViewIndex. The geometry is recorded, bound and culled once, not once per view.
+*   The views are the main camera moved sideways by --view-separation each, all looking at the same point, so 2 views make a
+*   stereo pair. The HDR target and the depth attachment get a layer per view, each as large as the render extent split by the
+*   number of views, and the composite pass places them next to each other in the swapchain image.
+*   Work which does not depend on the view is done once for the main camera: the light clusters, the shadow cascades and the
+*   bloom, which is taken from the first view. Only the forward render pass has views.
+*/
+
+void HelloTriangleApplication::checkMultiviewSupport(VkPhysicalDeviceMultiviewFeatures& features) {
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    viewMask = (1u << options.views) - 1;
+
+    if (options.views <= 1) {
+        return;
+    }
+
+    //the deferred subpasses and the passes drawn with shader objects have no view mask
+    if (options.deferred || options.shaderObjects || options.shaderObjectBenchmark) {
+        throw std::runtime_error("several views need the forward render pass, without --deferred and shader objects");
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_1) {
+        throw std::runtime_error("several views need vulkan 1.1 on the device");
+    }
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+    VkPhysicalDeviceMultiviewProperties multiviewProperties{};
+    multiviewProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &multiviewProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    if (features.multiview != VK_TRUE) {
+        throw std::runtime_error("multiview is not supported by the device");
+    }
+    if (options.views > multiviewProperties.maxMultiviewViewCount) {
+        throw std::runtime_error("the device renders at most " + std::to_string(multiviewProperties.maxMultiviewViewCount) + " views in one pass");
+    }
+
+    //only the feature which is used is enabled
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    features.multiview = VK_TRUE;
+}
+
+void HelloTriangleApplication::addRenderPassViews(VkRenderPassCreateInfo& renderPassInfo) {
+    if (options.views <= 1) {
+        return;
+    }
+
+    //both passes have a single subpass; the views are close to each other, which the correlation mask tells the driver
+    renderPassMultiview = {};
+    renderPassMultiview.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+    renderPassMultiview.subpassCount = 1;
+    renderPassMultiview.pViewMasks = &viewMask;
+    renderPassMultiview.correlationMaskCount = 1;
+    renderPassMultiview.pCorrelationMasks = &viewMask;
+
+    renderPassInfo.pNext = &renderPassMultiview;
+}
+
+void HelloTriangleApplication::updateViewProjections(UniformBufferObject& ubo, const glm::vec3& eye, const glm::vec3& target) {
+    //views which are not rendered keep the main camera
+    glm::mat4 mainViewProjection = ubo.proj * ubo.view;
+    for (uint32_t view = 0; view < MAX_VIEWS; view++) {
+        ubo.viewProjections[view] = mainViewProjection;
+    }
+
+    glm::vec3 right = glm::normalize(glm::cross(target - eye, glm::vec3(0.0f, 1.0f, 0.0f)));
+    for (uint32_t view = 1; view < options.views; view++) {
+        glm::vec3 viewEye = eye + right * (static_cast<float>(view) * options.viewSeparation);
+        ubo.viewProjections[view] = ubo.proj * glm::lookAt(viewEye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
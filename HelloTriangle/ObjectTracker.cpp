@@ -0,0 +1,176 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Object tracking
+*   Every Vulkan object the renderer creates is recorded in a registry keyed by its object type, along with a name and the frame it
+*   was created in, until it is destroyed. With VK_EXT_debug_utils the same name is given to the driver, so validation messages
+*   and captures show it instead of a bare handle.
+*   Once the renderer has warmed up, a frame should neither create nor destroy anything: objects the render loop creates in
+*   such a frame are reported as churn, once for every kind of object. Swapchain recreation is expected to create objects,
+*   and so are the shader workers rebuilding pipelines in the background.
+*   Whatever is still alive right before the device is destroyed is reported as a leak.
+*/
+
+//frames until the renderer is in its steady state: the first frames fill the per-image resources and swap in the first optimized pipelines
+const uint64_t OBJECT_TRACKER_WARMUP_FRAMES = 100;
+
+/// <summary>
+/// Name of the handle type of an object type, for the reports
+/// </summary>
+static const char* objectTypeName(VkObjectType type) {
+    switch (type) {
+    case VK_OBJECT_TYPE_BUFFER: return "VkBuffer";
+    case VK_OBJECT_TYPE_IMAGE: return "VkImage";
+    case VK_OBJECT_TYPE_IMAGE_VIEW: return "VkImageView";
+    case VK_OBJECT_TYPE_DEVICE_MEMORY: return "VkDeviceMemory";
+    case VK_OBJECT_TYPE_SAMPLER: return "VkSampler";
+    case VK_OBJECT_TYPE_SHADER_MODULE: return "VkShaderModule";
+    case VK_OBJECT_TYPE_SHADER_EXT: return "VkShaderEXT";
+    case VK_OBJECT_TYPE_PIPELINE: return "VkPipeline";
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT: return "VkPipelineLayout";
+    case VK_OBJECT_TYPE_RENDER_PASS: return "VkRenderPass";
+    case VK_OBJECT_TYPE_FRAMEBUFFER: return "VkFramebuffer";
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT: return "VkDescriptorSetLayout";
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL: return "VkDescriptorPool";
+    case VK_OBJECT_TYPE_COMMAND_POOL: return "VkCommandPool";
+    case VK_OBJECT_TYPE_COMMAND_BUFFER: return "VkCommandBuffer";
+    case VK_OBJECT_TYPE_QUERY_POOL: return "VkQueryPool";
+    case VK_OBJECT_TYPE_SEMAPHORE: return "VkSemaphore";
+    case VK_OBJECT_TYPE_FENCE: return "VkFence";
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR: return "VkSwapchainKHR";
+    default: return "unknown object";
+    }
+}
+
+void HelloTriangleApplication::checkDebugUtilsSupport(const std::vector<VkExtensionProperties>& availableExtensions, std::vector<const char*>& extensions) {
+    debugUtilsSupported = false;
+    if (!options.trackObjects) {
+        return;
+    }
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
+            debugUtilsSupported = true;
+            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            return;
+        }
+    }
+    std::cout << "VK_EXT_debug_utils is not supported, tracked objects are not named in the driver \n";
+}
+
+void HelloTriangleApplication::createObjectTracker() {
+    if (!options.trackObjects) {
+        return;
+    }
+
+    mainThreadId = std::this_thread::get_id();
+    if (debugUtilsSupported) {
+        setDebugUtilsObjectName = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT"));
+    }
+}
+
+void HelloTriangleApplication::trackObjectHandle(VkObjectType type, uint64_t handle, const std::string& name) {
+    if (handle == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(objectTrackerMutex);
+        TrackedObjectType& tracked = trackedObjects[type];
+        tracked.live[handle] = { name, objectTrackerFrame };
+        tracked.created++;
+        frameObjectsCreated++;
+
+        //only the render loop is expected to be quiet, the shader workers build pipelines whenever a source changes
+        if (objectFrameActive && std::this_thread::get_id() == mainThreadId) {
+            frameObjectCreations.push_back(std::string(objectTypeName(type)) + " " + name);
+        }
+    }
+
+    if (setDebugUtilsObjectName != nullptr) {
+        VkDebugUtilsObjectNameInfoEXT nameInfo{};
+        nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+        nameInfo.objectType = type;
+        nameInfo.objectHandle = handle;
+        nameInfo.pObjectName = name.c_str();
+        setDebugUtilsObjectName(device, &nameInfo);
+    }
+}
+
+void HelloTriangleApplication::untrackObjectHandle(VkObjectType type, uint64_t handle) {
+    if (handle == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(objectTrackerMutex);
+    TrackedObjectType& tracked = trackedObjects[type];
+    if (tracked.live.erase(handle) == 0) {
+        //a create site which is not tracked, or an object destroyed twice
+        std::cerr << "destroyed an untracked " << objectTypeName(type) << " 0x" << std::hex << handle << std::dec << std::endl;
+        return;
+    }
+    tracked.destroyed++;
+    frameObjectsDestroyed++;
+}
+
+void HelloTriangleApplication::beginObjectFrame() {
+    if (!options.trackObjects) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(objectTrackerMutex);
+    objectTrackerFrame = frameNumber;
+    objectFrameActive = true;
+    objectChurnExpected = false;
+    frameObjectCreations.clear();
+    frameObjectsCreated = 0;
+    frameObjectsDestroyed = 0;
+}
+
+void HelloTriangleApplication::endObjectFrame() {
+    if (!options.trackObjects) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(objectTrackerMutex);
+    objectFrameActive = false;
+    if (frameNumber < OBJECT_TRACKER_WARMUP_FRAMES || objectChurnExpected || frameObjectCreations.empty()) {
+        return;
+    }
+
+    //every kind of object is printed the first time only, the shutdown report has how often it happened
+    for (const auto& creation : frameObjectCreations) {
+        if (objectChurn[creation]++ == 0) {
+            std::cout << "frame " << frameNumber << " created " << frameObjectsCreated << " and destroyed " << frameObjectsDestroyed
+                << " objects in a steady-state frame, including " << creation << std::endl;
+        }
+    }
+}
+
+void HelloTriangleApplication::reportObjectLeaks() {
+    if (!options.trackObjects) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(objectTrackerMutex);
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+    size_t leaked = 0;
+
+    for (const auto& [type, tracked] : trackedObjects) {
+        created += tracked.created;
+        destroyed += tracked.destroyed;
+        leaked += tracked.live.size();
+
+        for (const auto& [handle, object] : tracked.live) {
+            std::cout << "leaked " << objectTypeName(type) << " " << object.name << " (0x" << std::hex << handle << std::dec
+                << "), created in frame " << object.frame << std::endl;
+        }
+    }
+
+    for (const auto& [creation, count] : objectChurn) {
+        std::cout << "created " << count << " times in steady-state frames: " << creation << std::endl;
+    }
+
+    std::cout << "objects created: " << created << " | destroyed: " << destroyed << " | leaked: " << leaked << std::endl;
+}
@@ -0,0 +1,459 @@
+#include "HelloTriangleApplication.h"
+
+#include <filesystem>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/*
+* Offline
+*   With --offline N the frames are rendered for a file and not for a screen: nothing is presented, so nothing waits on vsync, and every
+*   frame is written to --offline-dir as a QOI image. The run is a pipeline of three stages, each on its own:
+*       - the GPU renders and copies the frame into a linear, host visible output image which takes the place of the swapchain image
+*       - an I/O worker compresses the output straight out of the mapped memory, then hands the output back to the render loop
+*       - the same worker writes the compressed frame to disk, while the output is already being rendered into again
+*   There is an output per frame in flight, and offline more frames are in flight than when presenting, so a slow frame to compress or
+*   write is absorbed by the others. The render loop only waits on the workers when every output is taken, which makes the time of the
+*   whole run that of the slowest stage and not the sum of the three; the summary at the end tells which stage that was.
+*   The scene moves on by 1 / --offline-rate seconds of scene time per frame, however long the frames take.
+*   The tiles of a poster go through the same pipeline, written into a single file instead of a file each, see Poster.cpp.
+*/
+
+//the upscale pass encodes sRGB for this format, which is the color space QOI assumes, and the channels are in the order QOI writes them
+const VkFormat OFFLINE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+/* QOI */
+//"the Quite OK Image format", see qoiformat.org: lossless, and compressed in a single pass over the pixels with a few comparisons each
+const uint8_t QOI_OP_INDEX = 0x00;  //the pixel is in the table of recently seen pixels
+const uint8_t QOI_OP_DIFF = 0x40;   //every channel is within [-2, 1] of the previous pixel
+const uint8_t QOI_OP_LUMA = 0x80;   //green is within [-32, 31] of the previous pixel, red and blue follow green within [-8, 7]
+const uint8_t QOI_OP_RUN = 0xc0;    //the previous pixel repeated up to QOI_MAX_RUN times
+const uint8_t QOI_OP_RGB = 0xfe;
+const uint32_t QOI_MAX_RUN = 62;
+const size_t QOI_HEADER_SIZE = 14;
+const uint8_t QOI_END[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+/// <summary>
+/// Compress an RGBA image with rows rowPitch bytes apart into a 3 channel QOI image, the alpha is left out.
+/// Returns the size of the image, encoded only grows so that it is not allocated again for every frame.
+/// </summary>
+static size_t encodeQoi(const unsigned char* pixels, VkDeviceSize rowPitch, uint32_t width, uint32_t height, std::vector<unsigned char>& encoded) {
+    //worst case is a tag and three channels for every pixel
+    size_t maxSize = QOI_HEADER_SIZE + static_cast<size_t>(width) * height * 4 + sizeof(QOI_END);
+    if (encoded.size() < maxSize) {
+        encoded.resize(maxSize);
+    }
+    unsigned char* out = encoded.data();
+    size_t size = 0;
+
+    auto write32 = [&](uint32_t value) {
+        out[size++] = static_cast<unsigned char>(value >> 24);
+        out[size++] = static_cast<unsigned char>(value >> 16);
+        out[size++] = static_cast<unsigned char>(value >> 8);
+        out[size++] = static_cast<unsigned char>(value);
+    };
+    out[size++] = 'q';
+    out[size++] = 'o';
+    out[size++] = 'i';
+    out[size++] = 'f';
+    write32(width);
+    write32(height);
+    out[size++] = 3;    //channels
+    out[size++] = 0;    //sRGB with linear alpha
+
+    //pixels are packed as RGBA with an opaque alpha, so the zeroed table never matches one
+    uint32_t index[64] = {};
+    uint32_t previous = 0xff000000;
+    uint32_t run = 0;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const unsigned char* row = pixels + y * rowPitch;
+        for (uint32_t x = 0; x < width; x++) {
+            const unsigned char* texel = row + x * 4;
+            uint32_t r = texel[0];
+            uint32_t g = texel[1];
+            uint32_t b = texel[2];
+            uint32_t pixel = r | (g << 8) | (b << 16) | 0xff000000;
+
+            if (pixel == previous) {
+                run++;
+                if (run == QOI_MAX_RUN) {
+                    out[size++] = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out[size++] = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            uint32_t hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (index[hash] == pixel) {
+                out[size++] = static_cast<unsigned char>(QOI_OP_INDEX | hash);
+            }
+            else {
+                index[hash] = pixel;
+
+                //differences wrap around, as the decoder adds them modulo 256
+                int dr = static_cast<int8_t>(r - (previous & 0xff));
+                int dg = static_cast<int8_t>(g - ((previous >> 8) & 0xff));
+                int db = static_cast<int8_t>(b - ((previous >> 16) & 0xff));
+                int dgr = dr - dg;
+                int dgb = db - dg;
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out[size++] = static_cast<unsigned char>(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && dgr >= -8 && dgr <= 7 && dgb >= -8 && dgb <= 7) {
+                    out[size++] = static_cast<unsigned char>(QOI_OP_LUMA | (dg + 32));
+                    out[size++] = static_cast<unsigned char>(((dgr + 8) << 4) | (dgb + 8));
+                }
+                else {
+                    out[size++] = QOI_OP_RGB;
+                    out[size++] = static_cast<unsigned char>(r);
+                    out[size++] = static_cast<unsigned char>(g);
+                    out[size++] = static_cast<unsigned char>(b);
+                }
+            }
+            previous = pixel;
+        }
+    }
+    if (run > 0) {
+        out[size++] = static_cast<unsigned char>(QOI_OP_RUN | (run - 1));
+    }
+
+    std::memcpy(out + size, QOI_END, sizeof(QOI_END));
+    return size + sizeof(QOI_END);
+}
+
+void HelloTriangleApplication::createOfflineOutputs() {
+    //whatever else presents or runs a loop of its own can not share the frames
+    if (options.displays > 0 || options.batchViews > 0 || replayHeader != nullptr) {
+        throw std::runtime_error("offline rendering can not be combined with displays, batch views or a replay");
+    }
+
+    VkExtent2D extent = { options.offlineWidth, options.offlineHeight };
+    if (options.posterWidth > 0) {
+        createPosterTiles();
+        extent = { options.posterTileSize + 2 * POSTER_TILE_MARGIN, options.posterTileSize + 2 * POSTER_TILE_MARGIN };
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+    uint32_t largest = std::max(extent.width, extent.height);
+    if (largest > limits.maxImageDimension2D || extent.width > limits.maxFramebufferWidth || extent.height > limits.maxFramebufferHeight) {
+        throw std::runtime_error("offline frames of " + std::to_string(extent.width) + "x" + std::to_string(extent.height) + " do not fit the device");
+    }
+
+    //linear images are only guaranteed for few formats and uses, the output is only ever copied into
+    VkImageFormatProperties formatProperties;
+    if (vkGetPhysicalDeviceImageFormatProperties(physicalDevice, OFFLINE_FORMAT, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR, VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        0, &formatProperties) != VK_SUCCESS || formatProperties.maxExtent.width < extent.width || formatProperties.maxExtent.height < extent.height) {
+        throw std::runtime_error("the device can not copy frames of this size into a linear image");
+    }
+
+    swapChainImageFormat = OFFLINE_FORMAT;
+    swapChainExtent = extent;
+
+    //the workers read every byte of an output
+    VkMemoryPropertyFlags outputProperties = findReadbackMemoryProperties();
+
+    offlineOutputs.resize(framesInFlight);
+    swapChainImages.resize(framesInFlight);
+    for (size_t i = 0; i < offlineOutputs.size(); i++) {
+        OfflineOutput& output = offlineOutputs[i];
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, OFFLINE_FORMAT, VK_IMAGE_TILING_LINEAR, VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            outputProperties, output.image, output.memory);
+        swapChainImages[i] = output.image;
+
+        //rows of a linear image may be padded, the driver tells where they are
+        VkImageSubresource subresource{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+        VkSubresourceLayout layout;
+        vkGetImageSubresourceLayout(device, output.image, &subresource, &layout);
+
+        void* mapped = nullptr;
+        vkMapMemory(device, output.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        output.pixels = static_cast<const unsigned char*>(mapped) + layout.offset;
+        output.rowPitch = layout.rowPitch;
+        output.state = OfflineOutputState::Free;
+    }
+}
+
+void HelloTriangleApplication::destroyOfflineOutputs() {
+    //freeing the memory unmaps it
+    for (auto& output : offlineOutputs) {
+        untrackObject(VK_OBJECT_TYPE_IMAGE, output.image);
+        vkDestroyImage(device, output.image, nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, output.memory);
+        vkFreeMemory(device, output.memory, nullptr);
+    }
+    offlineOutputs.clear();
+}
+
+void HelloTriangleApplication::runOffline() {
+    uint64_t frameTotal = options.offlineFrames;
+    if (options.posterWidth > 0) {
+        openPoster();
+        frameTotal = static_cast<uint64_t>(posterTilesAcross) * posterTilesDown;
+    }
+    else {
+        std::filesystem::create_directories(options.offlineDirectory);
+    }
+
+    //the render loop keeps a core to itself
+    uint32_t workerCount = options.ioThreads;
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    stopOfflineWorkers = false;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        offlineWorkers.emplace_back([this]() { runOfflineWorker(); });
+    }
+
+    int frameCount = 0;
+    auto start = Clock::now();
+    auto secondStart = start;
+
+    while (frameNumber < frameTotal && !glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+        drawOfflineFrame();
+        frameCount++;
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - secondStart).count();
+        if (duration >= 1000) {
+            std::cout << "Frames: " << frameNumber << "/" << frameTotal << " | " << frameCount << " fps | GPU: " << gpuTime << " ms" << std::endl;
+            frameCount = 0;
+            secondStart = Clock::now();
+        }
+    }
+
+    //the frames still on the GPU go to the workers as well, which write every ready output before they stop
+    vkDeviceWaitIdle(device);
+    collectOfflineOutputs();
+    {
+        std::lock_guard<std::mutex> lock(offlineMutex);
+        stopOfflineWorkers = true;
+    }
+    offlineCondition.notify_all();
+    for (auto& worker : offlineWorkers) {
+        worker.join();
+    }
+    offlineWorkers.clear();
+    if (options.posterWidth > 0) {
+        closePoster();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t frames = std::max<uint64_t>(offlineFramesWritten, 1);
+    double rawBytes = static_cast<double>(swapChainExtent.width) * swapChainExtent.height * 3 * offlineFramesWritten;
+
+    //the workers are busy for all of the run when they are the slowest stage, the render loop waits on them then as well
+    double workerBusy = (offlineEncodeSeconds + offlineWriteSeconds) / (workerCount * seconds);
+    std::cout << "offline: " << offlineFramesWritten << " frames of " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << seconds
+        << " s | " << offlineFramesWritten / seconds << " fps | " << framesInFlight << " in flight, " << workerCount << " I/O threads" << std::endl;
+    std::cout << "  encode: " << offlineEncodeSeconds * 1000.0 / frames << " ms/frame | write: " << offlineWriteSeconds * 1000.0 / frames
+        << " ms/frame | ratio: " << (offlineBytesWritten > 0 ? rawBytes / offlineBytesWritten : 0.0) << ":1" << std::endl;
+    std::cout << "  render loop waited on the workers " << offlineWaitSeconds / seconds * 100.0 << "% of the run, workers busy "
+        << workerBusy * 100.0 << "%" << std::endl;
+    if (options.posterWidth > 0) {
+        std::cout << "  poster: " << options.posterWidth << "x" << options.posterHeight << " in " << posterTilesAcross << "x" << posterTilesDown
+            << " tiles written to " << options.posterFile << " | " << offlineBytesWritten / seconds / (1024.0 * 1024.0) << " MB/s" << std::endl;
+    }
+}
+
+void HelloTriangleApplication::drawOfflineFrame() {
+    TraceZone frameZone(*this, "drawOfflineFrame");
+    beginObjectFrame();
+    beginAllocationFrame();
+
+    auto frameStart = std::chrono::steady_clock::now();
+    if (frameNumber > 0) {
+        cpuFrameTime = std::chrono::duration<float, std::milli>(frameStart - lastFrameStart).count();
+        frameTimeMetric->observe(cpuFrameTime / 1000.0);
+    }
+    lastFrameStart = frameStart;
+    beginFlightFrame();
+
+    {
+        TraceZone zone(*this, "wait for frame fence");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    markFramePhase(FramePhase::FrameFence);
+
+    //the output goes with the frame in flight, the frame rendered into it before is done on the GPU but may still be compressed
+    uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+    OfflineOutput& output = offlineOutputs[imageIndex];
+    collectOfflineOutputs();
+    {
+        TraceZone zone(*this, "wait for encoder");
+        auto waitStart = Clock::now();
+        std::unique_lock<std::mutex> lock(offlineMutex);
+        offlineCondition.wait(lock, [&output]() { return output.state == OfflineOutputState::Free; });
+        offlineWaitSeconds += std::chrono::duration<double>(Clock::now() - waitStart).count();
+    }
+    markFramePhase(FramePhase::Acquire);
+    markFramePhase(FramePhase::ImageFence);
+
+    updateReloadedPipelines(false);
+    updateRenderScale(imageIndex);
+    readPipelineStatistics(imageIndex);
+    updateHud(imageIndex);
+    updateUniformBuffer(imageIndex);
+    markFramePhase(FramePhase::Update);
+
+    {
+        TraceZone zone(*this, "record");
+        auto recordStart = Clock::now();
+        recordCommandBuffer(imageIndex);
+        recordTime = std::chrono::duration<float, std::milli>(Clock::now() - recordStart).count();
+        recordPostProcessCommands(imageIndex);
+    }
+    markFramePhase(FramePhase::Record);
+
+    /* Command Buffer */
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &graphicsCommandBuffers[imageIndex];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &sceneFinishedSemaphores[currentFrame];
+
+    {
+        TraceZone zone(*this, "graphics submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer");
+        }
+        graphicsSubmitsMetric->increment();
+    }
+    markFramePhase(FramePhase::GraphicsSubmit);
+
+    /* Post Processing */
+    //the output is free once the workers let go of it, so the scene is all there is to wait for, and nothing waits on this submit but the fence
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    VkSubmitInfo postSubmitInfo{};
+    postSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    postSubmitInfo.waitSemaphoreCount = 1;
+    postSubmitInfo.pWaitSemaphores = &sceneFinishedSemaphores[currentFrame];
+    postSubmitInfo.pWaitDstStageMask = &waitStage;
+    postSubmitInfo.commandBufferCount = 1;
+    postSubmitInfo.pCommandBuffers = &computeCommandBuffers[imageIndex];
+
+    vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+    {
+        TraceZone zone(*this, "compute submit");
+        if (vkQueueSubmit(computeQueue, 1, &postSubmitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit post processing command buffer");
+        }
+        computeSubmitsMetric->increment();
+    }
+    {
+        std::lock_guard<std::mutex> lock(offlineMutex);
+        output.frame = frameNumber;
+        output.state = OfflineOutputState::Rendering;
+    }
+    markFramePhase(FramePhase::ComputeSubmit);
+
+    //frames which finished in the meantime are handed on now rather than when their output comes around again
+    collectOfflineOutputs();
+    markFramePhase(FramePhase::Present);
+
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    endAllocationFrame();
+    endFlightFrame();
+    endObjectFrame();
+    frameNumber++;
+    framesMetric->increment();
+}
+
+void HelloTriangleApplication::collectOfflineOutputs() {
+    bool ready = false;
+    {
+        std::lock_guard<std::mutex> lock(offlineMutex);
+        //an output belongs to the frame in flight of the same index, whose fence goes with its last submit
+        for (size_t i = 0; i < offlineOutputs.size(); i++) {
+            if (offlineOutputs[i].state == OfflineOutputState::Rendering && vkGetFenceStatus(device, inFlightFences[i]) == VK_SUCCESS) {
+                offlineOutputs[i].state = OfflineOutputState::Ready;
+                ready = true;
+            }
+        }
+    }
+    if (ready) {
+        offlineCondition.notify_all();
+    }
+}
+
+void HelloTriangleApplication::runOfflineWorker() {
+    //kept from frame to frame, a worker only allocates for its first one
+    std::vector<unsigned char> encoded;
+
+    std::unique_lock<std::mutex> lock(offlineMutex);
+    while (true) {
+        //oldest first, so that the files are written about in order
+        OfflineOutput* next = nullptr;
+        offlineCondition.wait(lock, [this, &next]() {
+            next = nullptr;
+            for (auto& output : offlineOutputs) {
+                if (output.state == OfflineOutputState::Ready && (next == nullptr || output.frame < next->frame)) {
+                    next = &output;
+                }
+            }
+            return next != nullptr || stopOfflineWorkers;
+        });
+        if (next == nullptr) {
+            return;
+        }
+        next->state = OfflineOutputState::Encoding;
+        uint64_t frame = next->frame;
+        lock.unlock();
+
+        //poster tiles are stored uncompressed, so that where each goes in the file is known up front
+        auto encodeStart = Clock::now();
+        size_t size = 0;
+        {
+            TraceZone zone(*this, "encode frame");
+            if (options.posterWidth > 0) {
+                size = packPosterTile(*next, encoded);
+            }
+            else {
+                size = encodeQoi(next->pixels, next->rowPitch, swapChainExtent.width, swapChainExtent.height, encoded);
+            }
+        }
+        auto writeStart = Clock::now();
+
+        //the pixels are compressed, the render loop can have the output back before the file is written
+        lock.lock();
+        next->state = OfflineOutputState::Free;
+        lock.unlock();
+        offlineCondition.notify_all();
+
+        bool written = false;
+        if (options.posterWidth > 0) {
+            TraceZone zone(*this, "write tile");
+            written = writePosterTile(frame, encoded.data(), size);
+        }
+        else {
+            std::string number = std::to_string(frame);
+            number.insert(0, number.size() < 6 ? 6 - number.size() : 0, '0');
+            std::filesystem::path path = std::filesystem::path(options.offlineDirectory) / ("frame-" + number + ".qoi");
+            {
+                TraceZone zone(*this, "write frame");
+                std::ofstream file(path, std::ios::binary);
+                written = file && file.write(reinterpret_cast<const char*>(encoded.data()), size);
+            }
+            if (!written) {
+                std::cerr << "failed to write offline frame " << path.string() << std::endl;
+            }
+        }
+        auto writeEnd = Clock::now();
+
+        lock.lock();
+        offlineEncodeSeconds += std::chrono::duration<double>(writeStart - encodeStart).count();
+        offlineWriteSeconds += std::chrono::duration<double>(writeEnd - writeStart).count();
+        if (written) {
+            offlineFramesWritten++;
+            offlineBytesWritten += size;
+        }
+    }
+}
@@ -0,0 +1,373 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Graphics pipeline libraries
+*   With VK_EXT_graphics_pipeline_library a graphics pipeline is made of four parts which are compiled on their own:
+*       1. vertex input interface: vertex bindings and attributes, input assembly
+*       2. pre-rasterization shaders: vertex shader, viewport, rasterization state
+*       3. fragment shader: fragment shader, depth and stencil state
+*       4. fragment output interface: color blending and the attachments written
+*   Each part is cached under a hash of the state it is made from, so a new pipeline which shares its vertex format, shaders or
+*   blending with an existing one only compiles what is new. The parts are fast linked, which takes a fraction of a full compile,
+*   and the pipeline is linked again with link time optimization on a shader worker -- the result is swapped in like a reloaded pipeline.
+*   Where the extension is not available (or --no-pipeline-library is given) every pipeline is created monolithic as before.
+*/
+
+/// <summary>
+/// FNV-1a over the fields of the state a library is made from. Structs are only added whole when they have no padding.
+/// </summary>
+struct PipelineStateHash {
+    uint64_t value = 14695981039346656037ull;
+
+    void addBytes(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            value = (value ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void add(const T& field) {
+        addBytes(&field, sizeof(T));
+    }
+
+    template <typename T>
+    void addArray(const T* fields, uint32_t count) {
+        add(count);
+        if (fields != nullptr) {
+            addBytes(fields, sizeof(T) * count);
+        }
+    }
+};
+
+static bool isFragmentStage(const VkPipelineShaderStageCreateInfo& stage) {
+    return stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+}
+
+/// <summary>
+/// Key of the library for one part of a pipeline: everything that part of the create info is made from
+/// </summary>
+/// <param name="codeHashes">hash of the SPIR-V of each of pipelineInfo.pStages</param>
+static uint64_t pipelineLibraryKey(const VkGraphicsPipelineCreateInfo& pipelineInfo, const std::vector<uint64_t>& codeHashes, VkGraphicsPipelineLibraryFlagsEXT part) {
+    PipelineStateHash hash;
+    hash.add(part);
+
+    if (pipelineInfo.pDynamicState != nullptr) {
+        hash.addArray(pipelineInfo.pDynamicState->pDynamicStates, pipelineInfo.pDynamicState->dynamicStateCount);
+    }
+
+    //the vertex input is the only part which does not depend on the layout or the render pass
+    if (part != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) {
+        hash.add(pipelineInfo.renderPass);
+        hash.add(pipelineInfo.subpass);
+    }
+    if (part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT || part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) {
+        hash.add(pipelineInfo.layout);
+
+        bool fragment = (part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+        for (uint32_t i = 0; i < pipelineInfo.stageCount; i++) {
+            if (isFragmentStage(pipelineInfo.pStages[i]) != fragment) {
+                continue;
+            }
+
+            const auto& stage = pipelineInfo.pStages[i];
+            hash.add(stage.stage);
+            hash.addBytes(stage.pName, std::strlen(stage.pName));
+            hash.add(codeHashes[i]);
+            if (stage.pSpecializationInfo != nullptr) {
+                hash.addArray(stage.pSpecializationInfo->pMapEntries, stage.pSpecializationInfo->mapEntryCount);
+                hash.add(stage.pSpecializationInfo->dataSize);
+                hash.addBytes(stage.pSpecializationInfo->pData, stage.pSpecializationInfo->dataSize);
+            }
+        }
+    }
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT: {
+        const auto& vertexInput = *pipelineInfo.pVertexInputState;
+        hash.addArray(vertexInput.pVertexBindingDescriptions, vertexInput.vertexBindingDescriptionCount);
+        hash.addArray(vertexInput.pVertexAttributeDescriptions, vertexInput.vertexAttributeDescriptionCount);
+        hash.add(pipelineInfo.pInputAssemblyState->topology);
+        hash.add(pipelineInfo.pInputAssemblyState->primitiveRestartEnable);
+        break;
+    }
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT: {
+        const auto& viewportState = *pipelineInfo.pViewportState;
+        hash.addArray(viewportState.pViewports, viewportState.viewportCount);
+        hash.addArray(viewportState.pScissors, viewportState.scissorCount);
+
+        const auto& rasterizer = *pipelineInfo.pRasterizationState;
+        hash.add(rasterizer.depthClampEnable);
+        hash.add(rasterizer.rasterizerDiscardEnable);
+        hash.add(rasterizer.polygonMode);
+        hash.add(rasterizer.cullMode);
+        hash.add(rasterizer.frontFace);
+        hash.add(rasterizer.depthBiasEnable);
+        hash.add(rasterizer.depthBiasConstantFactor);
+        hash.add(rasterizer.depthBiasClamp);
+        hash.add(rasterizer.depthBiasSlopeFactor);
+        hash.add(rasterizer.lineWidth);
+        break;
+    }
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT: {
+        //the multisample state belongs to both fragment parts
+        const auto& multisampling = *pipelineInfo.pMultisampleState;
+        hash.add(multisampling.rasterizationSamples);
+        hash.add(multisampling.sampleShadingEnable);
+        hash.add(multisampling.minSampleShading);
+        hash.addArray(multisampling.pSampleMask, (multisampling.rasterizationSamples + 31) / 32);
+        hash.add(multisampling.alphaToCoverageEnable);
+        hash.add(multisampling.alphaToOneEnable);
+
+        if (part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT && pipelineInfo.pDepthStencilState != nullptr) {
+            const auto& depthStencil = *pipelineInfo.pDepthStencilState;
+            hash.add(depthStencil.depthTestEnable);
+            hash.add(depthStencil.depthWriteEnable);
+            hash.add(depthStencil.depthCompareOp);
+            hash.add(depthStencil.depthBoundsTestEnable);
+            hash.add(depthStencil.stencilTestEnable);
+            hash.add(depthStencil.front);
+            hash.add(depthStencil.back);
+            hash.add(depthStencil.minDepthBounds);
+            hash.add(depthStencil.maxDepthBounds);
+        }
+        if (part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) {
+            const auto& colorBlending = *pipelineInfo.pColorBlendState;
+            hash.add(colorBlending.logicOpEnable);
+            hash.add(colorBlending.logicOp);
+            hash.addArray(colorBlending.pAttachments, colorBlending.attachmentCount);
+            hash.add(colorBlending.blendConstants);
+        }
+        break;
+    }
+    }
+
+    return hash.value;
+}
+
+void HelloTriangleApplication::checkPipelineLibrarySupport(VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& features, std::vector<const char*>& extensions) {
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    usePipelineLibraries = false;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    bool extensionsAvailable = isDeviceExtensionAvailable(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        isDeviceExtensionAvailable(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+    //the feature query needs vulkan 1.1 on the device as well
+    if (options.pipelineLibraries && extensionsAvailable && deviceProperties.apiVersion >= VK_API_VERSION_1_1) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{};
+        libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &libraryProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        usePipelineLibraries = (features.graphicsPipelineLibrary == VK_TRUE);
+        pipelineLibraryFastLinking = (libraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE);
+    }
+
+    if (!usePipelineLibraries) {
+        std::cout << "graphics pipeline libraries not used, pipelines are created monolithic \n";
+        features.graphicsPipelineLibrary = VK_FALSE;
+        return;
+    }
+
+    extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+}
+
+VkResult HelloTriangleApplication::linkGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, const ShaderStage* stages, VkPipeline* pipeline) {
+    if (!usePipelineLibraries) {
+        VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline);
+        if (result == VK_SUCCESS) {
+            trackObject(VK_OBJECT_TYPE_PIPELINE, *pipeline, "graphics pipeline");
+        }
+        return result;
+    }
+
+    const VkGraphicsPipelineLibraryFlagsEXT parts[] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+    };
+
+    std::vector<uint64_t> codeHashes(pipelineInfo.stageCount);
+    for (uint32_t i = 0; i < pipelineInfo.stageCount; i++) {
+        PipelineStateHash codeHash;
+        codeHash.addBytes(stages[i].code.data(), stages[i].code.size());
+        codeHashes[i] = codeHash.value;
+    }
+
+    PipelineLibraryLink link{};
+    link.layout = pipelineInfo.layout;
+
+    for (size_t i = 0; i < link.libraries.size(); i++) {
+        uint64_t key = pipelineLibraryKey(pipelineInfo, codeHashes, parts[i]);
+        {
+            std::lock_guard<std::mutex> lock(pipelineLibraryMutex);
+            auto cached = pipelineLibraries.find(key);
+            if (cached != pipelineLibraries.end()) {
+                link.libraries[i] = cached->second.library;
+                pipelineLibraryHitsMetric->increment();
+                continue;
+            }
+        }
+        pipelineLibraryMissesMetric->increment();
+
+        //compiled outside of the lock, so that the workers build different parts at the same time
+        VkPipeline library;
+        VkResult result = createPipelineLibrary(pipelineInfo, parts[i], &library);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        //another worker may have built the same part in the meantime, the first one stays
+        std::lock_guard<std::mutex> lock(pipelineLibraryMutex);
+        VkRenderPass renderPass = (parts[i] == VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) ? VK_NULL_HANDLE : pipelineInfo.renderPass;
+        auto inserted = pipelineLibraries.emplace(key, PipelineLibrary{ library, renderPass });
+        if (!inserted.second) {
+            untrackObject(VK_OBJECT_TYPE_PIPELINE, library);
+            vkDestroyPipeline(device, library, nullptr);
+        }
+        link.libraries[i] = inserted.first->second.library;
+    }
+
+    VkResult result = linkPipelineLibraries(link, !pipelineLibraryFastLinking, pipeline);
+    if (result == VK_SUCCESS && pipelineLibraryFastLinking) {
+        std::lock_guard<std::mutex> lock(pipelineLibraryMutex);
+        fastLinkedPipelines[*pipeline] = link;
+    }
+
+    return result;
+}
+
+VkResult HelloTriangleApplication::createPipelineLibrary(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkGraphicsPipelineLibraryFlagsEXT part, VkPipeline* library) {
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = part;
+
+    //the intermediate representation is kept so that the parts can be linked with optimization later
+    VkGraphicsPipelineCreateInfo partInfo{};
+    partInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    partInfo.pNext = &libraryInfo;
+    partInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    partInfo.pDynamicState = pipelineInfo.pDynamicState;
+
+    std::vector<VkPipelineShaderStageCreateInfo> partStages;
+    bool fragment = (part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+    if (part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT || fragment) {
+        for (uint32_t i = 0; i < pipelineInfo.stageCount; i++) {
+            if (isFragmentStage(pipelineInfo.pStages[i]) == fragment) {
+                partStages.push_back(pipelineInfo.pStages[i]);
+            }
+        }
+        partInfo.stageCount = static_cast<uint32_t>(partStages.size());
+        partInfo.pStages = partStages.data();
+        partInfo.layout = pipelineInfo.layout;
+    }
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        partInfo.pVertexInputState = pipelineInfo.pVertexInputState;
+        partInfo.pInputAssemblyState = pipelineInfo.pInputAssemblyState;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        partInfo.pViewportState = pipelineInfo.pViewportState;
+        partInfo.pRasterizationState = pipelineInfo.pRasterizationState;
+        partInfo.pTessellationState = pipelineInfo.pTessellationState;
+        partInfo.renderPass = pipelineInfo.renderPass;
+        partInfo.subpass = pipelineInfo.subpass;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        partInfo.pDepthStencilState = pipelineInfo.pDepthStencilState;
+        partInfo.pMultisampleState = pipelineInfo.pMultisampleState;
+        partInfo.renderPass = pipelineInfo.renderPass;
+        partInfo.subpass = pipelineInfo.subpass;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        partInfo.pColorBlendState = pipelineInfo.pColorBlendState;
+        partInfo.pMultisampleState = pipelineInfo.pMultisampleState;
+        partInfo.renderPass = pipelineInfo.renderPass;
+        partInfo.subpass = pipelineInfo.subpass;
+        break;
+    }
+
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &partInfo, nullptr, library);
+    if (result == VK_SUCCESS) {
+        trackObject(VK_OBJECT_TYPE_PIPELINE, *library, "pipeline library");
+    }
+    return result;
+}
+
+VkResult HelloTriangleApplication::linkPipelineLibraries(const PipelineLibraryLink& link, bool optimize, VkPipeline* pipeline) {
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = static_cast<uint32_t>(link.libraries.size());
+    libraryInfo.pLibraries = link.libraries.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = link.layout;
+
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline);
+    if (result == VK_SUCCESS) {
+        trackObject(VK_OBJECT_TYPE_PIPELINE, *pipeline, optimize ? "optimized linked pipeline" : "linked pipeline");
+    }
+    return result;
+}
+
+void HelloTriangleApplication::scheduleOptimizedLink(VkPipeline* target, VkPipeline pipeline, uint32_t generation) {
+    PipelineLibraryLink link;
+    {
+        std::lock_guard<std::mutex> lock(pipelineLibraryMutex);
+        auto fastLinked = fastLinkedPipelines.find(pipeline);
+        if (fastLinked == fastLinkedPipelines.end()) {
+            return;
+        }
+        link = fastLinked->second;
+        fastLinkedPipelines.erase(fastLinked);
+    }
+
+    addShaderJob([this, target, pipeline, generation, link]() {
+        //an older generation was made against a render pass which is gone now, and its libraries with it
+        //the registry only changes while the workers are paused, during startup and while the swapchain is recreated, so a worker can read it
+        auto reloadable = std::find_if(reloadablePipelines.begin(), reloadablePipelines.end(),
+            [target](const ReloadablePipeline& entry) { return entry.pipeline == target; });
+        if (reloadable == reloadablePipelines.end() || reloadable->generation != generation) {
+            return;
+        }
+
+        VkPipeline optimized;
+        if (linkPipelineLibraries(link, true, &optimized) != VK_SUCCESS) {
+            throw std::runtime_error("failed to link optimized pipeline");
+        }
+
+        std::lock_guard<std::mutex> lock(shaderJobMutex);
+        rebuiltPipelines.push_back({ target, optimized, generation, pipeline });
+    });
+}
+
+void HelloTriangleApplication::destroyPipelineLibraries(VkRenderPass renderPass) {
+    std::lock_guard<std::mutex> lock(pipelineLibraryMutex);
+    for (auto library = pipelineLibraries.begin(); library != pipelineLibraries.end();) {
+        if (renderPass != VK_NULL_HANDLE && library->second.renderPass != renderPass) {
+            library++;
+            continue;
+        }
+        untrackObject(VK_OBJECT_TYPE_PIPELINE, library->second.library);
+        vkDestroyPipeline(device, library->second.library, nullptr);
+        library = pipelineLibraries.erase(library);
+    }
+}
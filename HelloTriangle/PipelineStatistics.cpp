@@ -0,0 +1,109 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Pipeline statistics
+*   Tells whether a pass is vertex or fragment bound: a query around each scene pass counts the vertices fetched, the vertex shader
+*   invocations, the primitives which come out of clipping and the fragment shader invocations.
+*   Like the timestamps, the queries of an image are read once the image is acquired again: the frame which wrote them has finished,
+*   so reading them never stalls the render loop. The counts printed are those of a frame a few frames old.
+*/
+
+const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+void HelloTriangleApplication::checkPipelineStatisticsSupport(VkPhysicalDeviceFeatures& features) {
+    pipelineStatisticsSupported = false;
+    if (!options.pipelineStatistics) {
+        return;
+    }
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    if (!supportedFeatures.pipelineStatisticsQuery) {
+        std::cout << "pipeline statistics queries are not supported, the passes are not counted \n";
+        return;
+    }
+
+    features.pipelineStatisticsQuery = VK_TRUE;
+    pipelineStatisticsSupported = true;
+}
+
+void HelloTriangleApplication::createPipelineStatisticsQueries() {
+    pipelineStatisticsQueryPool = VK_NULL_HANDLE;
+    if (!pipelineStatisticsSupported) {
+        return;
+    }
+
+    size_t imageCount = swapChainImages.size();
+    pipelineStatisticsWritten.assign(imageCount, false);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolInfo.queryCount = static_cast<uint32_t>(imageCount) * PIPELINE_STATISTICS_PER_IMAGE;
+    queryPoolInfo.pipelineStatistics = PIPELINE_STATISTICS_FLAGS;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &pipelineStatisticsQueryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline statistics query pool");
+    }
+    trackObject(VK_OBJECT_TYPE_QUERY_POOL, pipelineStatisticsQueryPool, "pipelineStatisticsQueryPool");
+}
+
+void HelloTriangleApplication::beginPassStatistics(VkCommandBuffer commandBuffer, uint32_t imageIndex, ScenePass pass) {
+    if (pipelineStatisticsQueryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    //queries of the image were reset at the start of the command buffer
+    uint32_t query = imageIndex * PIPELINE_STATISTICS_PER_IMAGE + static_cast<uint32_t>(pass);
+    vkCmdBeginQuery(commandBuffer, pipelineStatisticsQueryPool, query, 0);
+}
+
+void HelloTriangleApplication::endPassStatistics(VkCommandBuffer commandBuffer, uint32_t imageIndex, ScenePass pass) {
+    if (pipelineStatisticsQueryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    uint32_t query = imageIndex * PIPELINE_STATISTICS_PER_IMAGE + static_cast<uint32_t>(pass);
+    vkCmdEndQuery(commandBuffer, pipelineStatisticsQueryPool, query);
+}
+
+void HelloTriangleApplication::readPipelineStatistics(uint32_t imageIndex) {
+    if (pipelineStatisticsQueryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (pipelineStatisticsWritten[imageIndex]) {
+        std::array<PipelineStatistics, 3> statistics{};
+
+        //without VK_QUERY_RESULT_WAIT_BIT, a result which is somehow not available yet leaves the last one in place instead of blocking
+        VkResult result = vkGetQueryPoolResults(device, pipelineStatisticsQueryPool, imageIndex * PIPELINE_STATISTICS_PER_IMAGE,
+            PIPELINE_STATISTICS_PER_IMAGE, sizeof(statistics), statistics.data(), sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS) {
+            passStatistics = statistics;
+        }
+    }
+
+    //the command buffer recorded after this writes the queries of this image
+    pipelineStatisticsWritten[imageIndex] = true;
+}
+
+void HelloTriangleApplication::printPipelineStatistics() {
+    const char* passNames[] = { "depth prepass", "shadows", "main" };
+
+    for (size_t i = 0; i < passStatistics.size(); i++) {
+        const PipelineStatistics& pass = passStatistics[i];
+
+        //fragments per vertex shaded: high means fragment bound, around one or below means vertex bound
+        double fragmentsPerVertex = (pass.vertexShaderInvocations > 0)
+            ? static_cast<double>(pass.fragmentShaderInvocations) / static_cast<double>(pass.vertexShaderInvocations) : 0.0;
+
+        std::cout << "  " << passNames[i] << ": vertices " << pass.inputAssemblyVertices << " | VS " << pass.vertexShaderInvocations
+            << " | primitives after clipping " << pass.clippingPrimitives << " | FS " << pass.fragmentShaderInvocations
+            << " | FS/VS " << fragmentsPerVertex << std::endl;
+    }
+}
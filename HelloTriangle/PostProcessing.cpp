@@ -0,0 +1,466 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Post processing
+*   The scene is rendered into an HDR target instead of the swapchain image. A chain of compute passes turns it into the final image:
+*       1. bloom downsample: the HDR target is filtered down a mip chain, the bright pass threshold is fused into the first level
+*       2. bloom upsample: the chain is walked back up, each level adds a tent filtered copy of the level below it
+*       3. composite: bloom, exposure, tonemapping, color grading and FXAA-style anti-aliasing in one pass. The anti-aliasing
+*          tonemaps its neighbourhood on the fly, so no intermediate LDR image is ever written out and read back
+*       4. upscale: the composited image is scaled from the render resolution up to the swapchain resolution (bilinear, Lanczos or edge-aware)
+*   The result is copied into the swapchain image at the end of the chain.
+*   With dynamic resolution only the top left corner of the HDR target holds rendered pixels. Passes which read it are given the size of that
+*   region (sourceRegion) and clamp their taps to it, so everything before the upscale works at the render resolution.
+*   With several views the HDR target has a layer per view, and the composite pass places them side by side in columns of the frame.
+*   Bloom is built from the first layer only and laid over every column: the views look at the same scene from close by.
+*   Everything is submitted to the compute queue. When the device has a compute only queue family, the post processing of one frame
+*   runs alongside the geometry of the next frame on the graphics queue.
+*/
+
+//all post processing shaders use 8x8 workgroups
+static uint32_t postGroupCount(uint32_t pixels) {
+    return (pixels + 7) / 8;
+}
+
+std::vector<uint32_t> HelloTriangleApplication::getPostProcessQueueFamilies() {
+    QueueFamilyIndices indicies = queueFamilyIndices;
+    std::set<uint32_t> uniqueFamilies = { indicies.graphicsFamily.value(), indicies.computeFamily.value() };
+
+    return std::vector<uint32_t>(uniqueFamilies.begin(), uniqueFamilies.end());
+}
+
+void HelloTriangleApplication::createPostProcessTargets() {
+    size_t imageCount = swapChainImages.size();
+
+    //HDR target is written on the graphics queue and read on the compute queue,
+    //share it between the two families rather than transferring ownership twice every frame
+    std::vector<uint32_t> sharedFamilies = getPostProcessQueueFamilies();
+
+    hdrTargets.resize(imageCount);
+    hdrArrayViews.resize(imageCount);
+    compositeTargets.resize(imageCount);
+    ldrTargets.resize(imageCount);
+    bloomChains.resize(imageCount);
+
+    for (size_t i = 0; i < imageCount; i++) {
+        hdrTargets[i].format = HDR_FORMAT;
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, HDR_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, hdrTargets[i].image, hdrTargets[i].memory, sharedFamilies, options.views);
+        hdrTargets[i].view = createImageView(hdrTargets[i].image, HDR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+        hdrArrayViews[i] = createImageView(hdrTargets[i].image, HDR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY, options.views);
+
+        //render resolution never goes above the swapchain resolution, so the targets it writes are allocated at the largest size once
+        //storage images can not use sRGB formats, the composite shader encodes the output itself
+        compositeTargets[i].format = VK_FORMAT_R8G8B8A8_UNORM;
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, compositeTargets[i].format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, compositeTargets[i].image, compositeTargets[i].memory);
+        compositeTargets[i].view = createImageView(compositeTargets[i].image, compositeTargets[i].format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        ldrTargets[i].format = VK_FORMAT_R8G8B8A8_UNORM;
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, ldrTargets[i].format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ldrTargets[i].image, ldrTargets[i].memory);
+        ldrTargets[i].view = createImageView(ldrTargets[i].image, ldrTargets[i].format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        /* Bloom Chain */
+        BloomChain& bloom = bloomChains[i];
+        VkExtent2D levelExtent = { std::max(swapChainExtent.width / 2, 1u), std::max(swapChainExtent.height / 2, 1u) };
+
+        createImage(levelExtent.width, levelExtent.height, BLOOM_MIP_LEVELS, HDR_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bloom.image, bloom.memory);
+
+        bloom.levelViews.resize(BLOOM_MIP_LEVELS);
+        bloom.levelExtents.resize(BLOOM_MIP_LEVELS);
+        for (uint32_t level = 0; level < BLOOM_MIP_LEVELS; level++) {
+            bloom.levelViews[level] = createImageView(bloom.image, HDR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, level);
+            bloom.levelExtents[level] = levelExtent;
+            levelExtent = { std::max(levelExtent.width / 2, 1u), std::max(levelExtent.height / 2, 1u) };
+        }
+    }
+}
+
+void HelloTriangleApplication::destroyPostProcessTargets() {
+    for (size_t i = 0; i < hdrTargets.size(); i++) {
+        untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, hdrArrayViews[i]);
+        vkDestroyImageView(device, hdrArrayViews[i], nullptr);
+        destroyAttachment(hdrTargets[i]);
+        destroyAttachment(compositeTargets[i]);
+        destroyAttachment(ldrTargets[i]);
+
+        for (auto levelView : bloomChains[i].levelViews) {
+            untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, levelView);
+            vkDestroyImageView(device, levelView, nullptr);
+        }
+        untrackObject(VK_OBJECT_TYPE_IMAGE, bloomChains[i].image);
+        vkDestroyImage(device, bloomChains[i].image, nullptr);
+        untrackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, bloomChains[i].memory);
+        vkFreeMemory(device, bloomChains[i].memory, nullptr);
+    }
+
+    hdrTargets.clear();
+    hdrArrayViews.clear();
+    compositeTargets.clear();
+    ldrTargets.clear();
+    bloomChains.clear();
+}
+
+void HelloTriangleApplication::createPostProcessPipelines() {
+    /* Sampler */
+    //bilinear filtering does part of the work of the bloom filters, every tap covers four texels
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &postSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing sampler");
+    }
+    trackObject(VK_OBJECT_TYPE_SAMPLER, postSampler, "postSampler");
+
+    /* Descriptor Set Layout */
+    //0. source image, sampled
+    //1. destination image, storage
+    //2. bloom result -- only used by the composite pass
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &postSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing descriptor set layout");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, postSetLayout, "postSetLayout");
+
+    /* Pipeline Layout */
+    //one push constant range shared by all passes, each pass reads its own struct from the start of it
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = static_cast<uint32_t>(std::max({ sizeof(BloomPushConstants), sizeof(CompositePushConstants), sizeof(UpscalePushConstants) }));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &postSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &postPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, postPipelineLayout, "postPipelineLayout");
+
+    /* Output Format */
+    //the LDR image is copied into the swapchain image without any conversion,
+    //so the upscale pass has to write the channel order and encoding the swapchain format expects
+    uint32_t upscaleConstants[3] = { VK_FALSE, VK_FALSE, static_cast<uint32_t>(options.upscaleFilter) }; //0: swap red and blue, 1: sRGB encode, 2: filter
+    switch (swapChainImageFormat) {
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        upscaleConstants[1] = VK_TRUE;
+        //fall through
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        upscaleConstants[0] = VK_TRUE;
+        break;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        upscaleConstants[1] = VK_TRUE;
+        break;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        break;
+    default:
+        throw std::runtime_error("swap chain format is not supported by the post processing output");
+    }
+
+    //the format follows the swapchain, so this variant is registered again every time the swapchain is recreated
+    shaderVariants["upscale"] = { "upscale.comp", "upscale.spv", VK_SHADER_STAGE_COMPUTE_BIT,
+        { { 0, upscaleConstants[0] }, { 1, upscaleConstants[1] }, { 2, upscaleConstants[2] } } };
+
+    /* Pipelines */
+    auto createPostPipeline = [this](const std::string& variantName, VkPipeline& pipeline) {
+        VkPipelineLayout layout = postPipelineLayout;
+        createReloadablePipeline(pipeline, { variantName }, [this, variantName, layout]() { return buildComputePipeline(variantName, layout); });
+    };
+
+    createPostPipeline("bloomDownsample", bloomDownsamplePipeline);
+    createPostPipeline("bloomUpsample", bloomUpsamplePipeline);
+    createPostPipeline("postComposite", compositePipeline);
+    createPostPipeline("upscale", upscalePipeline);
+}
+
+void HelloTriangleApplication::createPostProcessDescriptorSets() {
+    uint32_t setCount = static_cast<uint32_t>(swapChainImages.size()) * POST_SETS_PER_IMAGE;
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = setCount * 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = setCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &postDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing descriptor pool");
+    }
+    trackObject(VK_OBJECT_TYPE_DESCRIPTOR_POOL, postDescriptorPool, "postDescriptorPool");
+
+    std::vector<VkDescriptorSetLayout> layouts(setCount, postSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = postDescriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    postDescriptorSets.resize(setCount);
+    if (vkAllocateDescriptorSets(device, &allocInfo, postDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate post processing descriptor sets");
+    }
+
+    //bloom chain, composited image and LDR output stay in the general layout for the whole chain so that they can be both sampled and stored to
+    //bloom result is left unwritten for the bloom passes, they do not use it
+    auto writeSet = [this](VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout, VkImageView destination, VkImageView bloom) {
+        std::array<VkDescriptorImageInfo, 3> imageInfos{};
+        imageInfos[0] = { postSampler, source, sourceLayout };
+        imageInfos[1] = { VK_NULL_HANDLE, destination, VK_IMAGE_LAYOUT_GENERAL };
+        imageInfos[2] = { postSampler, bloom, VK_IMAGE_LAYOUT_GENERAL };
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+        for (uint32_t j = 0; j < descriptorWrites.size(); j++) {
+            descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[j].dstSet = set;
+            descriptorWrites[j].dstBinding = j;
+            descriptorWrites[j].dstArrayElement = 0;
+            descriptorWrites[j].descriptorType = (j == 1) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[j].descriptorCount = 1;
+            descriptorWrites[j].pImageInfo = &imageInfos[j];
+        }
+
+        uint32_t writeCount = (bloom != VK_NULL_HANDLE) ? 3 : 2;
+        vkUpdateDescriptorSets(device, writeCount, descriptorWrites.data(), 0, nullptr);
+    };
+
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        VkDescriptorSet* sets = &postDescriptorSets[i * POST_SETS_PER_IMAGE];
+        const BloomChain& bloom = bloomChains[i];
+
+        //downsample: HDR target -> level 0 -> level 1 -> ...
+        writeSet(sets[0], hdrTargets[i].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, bloom.levelViews[0], VK_NULL_HANDLE);
+        for (uint32_t level = 1; level < BLOOM_MIP_LEVELS; level++) {
+            writeSet(sets[level], bloom.levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, bloom.levelViews[level], VK_NULL_HANDLE);
+        }
+
+        //upsample: each level reads the level below it and accumulates in place
+        for (uint32_t level = 0; level < BLOOM_MIP_LEVELS - 1; level++) {
+            writeSet(sets[BLOOM_MIP_LEVELS + level], bloom.levelViews[level + 1], VK_IMAGE_LAYOUT_GENERAL, bloom.levelViews[level], VK_NULL_HANDLE);
+        }
+
+        //composite: every view of the HDR target + bloom -> composited image at render resolution
+        writeSet(sets[POST_SETS_PER_IMAGE - 2], hdrArrayViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, compositeTargets[i].view, bloom.levelViews[0]);
+
+        //upscale: composited image -> LDR output at swapchain resolution
+        writeSet(sets[POST_SETS_PER_IMAGE - 1], compositeTargets[i].view, VK_IMAGE_LAYOUT_GENERAL, ldrTargets[i].view, VK_NULL_HANDLE);
+    }
+}
+
+void HelloTriangleApplication::createComputeCommandBuffers() {
+    computeCommandBuffers.resize(swapChainImages.size());
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = computeCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(computeCommandBuffers.size());
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, computeCommandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate compute command buffers");
+    }
+    for (auto commandBuffer : computeCommandBuffers) {
+        trackObject(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer, "computeCommandBuffers");
+    }
+
+    //commands are recorded in drawFrame, see recordPostProcessCommands
+}
+
+void HelloTriangleApplication::recordPostProcessCommands(uint32_t imageIndex) {
+    VkCommandBuffer commandBuffer = computeCommandBuffers[imageIndex];
+    const BloomChain& bloom = bloomChains[imageIndex];
+    VkDescriptorSet* sets = &postDescriptorSets[imageIndex * POST_SETS_PER_IMAGE];
+
+    //every pass reads what the previous pass wrote
+    VkMemoryBarrier passBarrier{};
+    passBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    passBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    passBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording compute command buffer");
+    }
+
+    if (computeTimestampMask != 0) {
+        //the HUD timestamps are reset along with the post processing ones
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 2, TIMESTAMPS_PER_IMAGE - 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 2);
+    }
+
+    /* Layouts */
+    //bloom chain, composited image and LDR output are fully rewritten every frame, so their previous contents can be discarded
+    std::array<VkImageMemoryBarrier, 3> discardBarriers{};
+    VkImage discardImages[] = { bloom.image, compositeTargets[imageIndex].image, ldrTargets[imageIndex].image };
+    uint32_t discardLevels[] = { BLOOM_MIP_LEVELS, 1, 1 };
+    for (size_t j = 0; j < discardBarriers.size(); j++) {
+        discardBarriers[j].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        discardBarriers[j].srcAccessMask = 0;
+        discardBarriers[j].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        discardBarriers[j].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        discardBarriers[j].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        discardBarriers[j].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        discardBarriers[j].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        discardBarriers[j].image = discardImages[j];
+        discardBarriers[j].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, discardLevels[j], 0, 1 };
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(discardBarriers.size()), discardBarriers.data());
+
+    //rendered part of the HDR target and of the composited image: uv scale and the center of the last rendered texel
+    glm::vec2 renderSize((float)renderExtent.width, (float)renderExtent.height);
+    glm::vec2 targetSize((float)swapChainExtent.width, (float)swapChainExtent.height);
+    glm::vec4 renderRegion(renderSize / targetSize, (renderSize - 0.5f) / targetSize);
+    glm::vec4 fullRegion(1.0f);
+    //rendered part of each layer of the HDR target, the same as renderRegion with a single view
+    glm::vec2 viewSize((float)viewExtent.width, (float)viewExtent.height);
+    glm::vec4 viewRegion(viewSize / targetSize, (viewSize - 0.5f) / targetSize);
+
+    /* Bloom Downsample */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, bloomDownsamplePipeline);
+
+    glm::vec2 sourceSize = viewSize;
+    for (uint32_t level = 0; level < BLOOM_MIP_LEVELS; level++) {
+        BloomPushConstants push{};
+        push.sourceRegion = (level == 0) ? viewRegion : fullRegion;
+        push.srcTexelSize = 1.0f / sourceSize;
+        //bright pass is fused into the first downsample so that the full resolution target is only read once here
+        push.threshold = (level == 0) ? postSettings.bloomThreshold : 0.0f;
+        push.knee = postSettings.bloomKnee;
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postPipelineLayout, 0, 1, &sets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, postPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+        vkCmdDispatch(commandBuffer, postGroupCount(bloom.levelExtents[level].width), postGroupCount(bloom.levelExtents[level].height), 1);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &passBarrier, 0, nullptr, 0, nullptr);
+
+        sourceSize = glm::vec2((float)bloom.levelExtents[level].width, (float)bloom.levelExtents[level].height);
+    }
+
+    /* Bloom Upsample */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, bloomUpsamplePipeline);
+
+    for (uint32_t level = BLOOM_MIP_LEVELS - 1; level-- > 0;) {
+        BloomPushConstants push{};
+        push.sourceRegion = fullRegion;
+        push.srcTexelSize = glm::vec2(1.0f / bloom.levelExtents[level + 1].width, 1.0f / bloom.levelExtents[level + 1].height);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postPipelineLayout, 0, 1, &sets[BLOOM_MIP_LEVELS + level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, postPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+        vkCmdDispatch(commandBuffer, postGroupCount(bloom.levelExtents[level].width), postGroupCount(bloom.levelExtents[level].height), 1);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &passBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    /* Composite */
+    //runs at the render resolution, anti-aliasing before upscaling keeps the upscale filter from stretching the jaggies
+    CompositePushConstants composite{};
+    composite.colorFilter = glm::vec4(postSettings.colorFilter, postSettings.saturation);
+    composite.sourceRegion = viewRegion;
+    composite.renderExtent = glm::uvec2(renderExtent.width, renderExtent.height);
+    composite.exposure = postSettings.exposure;
+    composite.bloomIntensity = postSettings.bloomIntensity;
+    composite.contrast = postSettings.contrast;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compositePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postPipelineLayout, 0, 1, &sets[POST_SETS_PER_IMAGE - 2], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, postPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(composite), &composite);
+    vkCmdDispatch(commandBuffer, postGroupCount(renderExtent.width), postGroupCount(renderExtent.height), 1);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &passBarrier, 0, nullptr, 0, nullptr);
+
+    /* Upscale */
+    UpscalePushConstants upscale{};
+    upscale.sourceRegion = renderRegion;
+    upscale.sourceSize = targetSize;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, upscalePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, postPipelineLayout, 0, 1, &sets[POST_SETS_PER_IMAGE - 1], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, postPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(upscale), &upscale);
+    vkCmdDispatch(commandBuffer, postGroupCount(swapChainExtent.width), postGroupCount(swapChainExtent.height), 1);
+
+    /* HUD */
+    recordHud(commandBuffer, imageIndex);
+
+    /* Copy To Swapchain */
+    //the acquire semaphore is waited on at the transfer stage, so the layout transition of the swapchain image has to come after it
+    VkMemoryBarrier outputBarrier{};
+    outputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    outputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    outputBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkImageMemoryBarrier swapChainBarrier{};
+    swapChainBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    swapChainBarrier.srcAccessMask = 0;
+    swapChainBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    swapChainBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    swapChainBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    swapChainBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    swapChainBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    swapChainBarrier.image = swapChainImages[imageIndex];
+    swapChainBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        1, &outputBarrier, 0, nullptr, 1, &swapChainBarrier);
+
+    //formats are of the same size class, so the LDR texels are copied over as they are
+    VkImageCopy copyRegion{};
+    copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    copyRegion.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+    vkCmdCopyImage(commandBuffer, ldrTargets[imageIndex].image, VK_IMAGE_LAYOUT_GENERAL, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    swapChainBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    swapChainBarrier.dstAccessMask = 0;
+    swapChainBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    swapChainBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    VkPipelineStageFlags outputStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    //an offline output is read by the CPU, which can only read a linear image in the general layout, and needs the copy made visible to it
+    if (options.offline()) {
+        swapChainBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        swapChainBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        outputStage = VK_PIPELINE_STAGE_HOST_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, outputStage, 0, 0, nullptr, 0, nullptr, 1, &swapChainBarrier);
+
+    recordDisplayCopies(commandBuffer, imageIndex);
+
+    if (computeTimestampMask != 0) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, imageIndex * TIMESTAMPS_PER_IMAGE + 3);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record compute command buffer");
+    }
+}
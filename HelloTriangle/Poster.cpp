@@ -0,0 +1,180 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Poster
+*   With --poster W H the scene is rendered into one image of W x H, which may be far larger than a single image the device can create
+*   or the memory can hold, e.g. 65536 x 65536. The poster is split into tiles of --poster-tile pixels, rendered one after the other
+*   through the offline pipeline (Offline.cpp): the render target, the outputs and what the I/O workers keep are the size of a tile,
+*   whatever the size of the poster, and only a few tiles are in memory at once.
+*   Each tile is the projection of the whole poster narrowed to the part the tile sees, so the tiles line up into one picture. Tiles are
+*   rendered with a guard band of POSTER_TILE_MARGIN pixels around them, which is left out of the file, so that the bloom and the other
+*   screen space effects see past the edge of the tile. Each tile fits its own shadow cascades, which can differ slightly at a seam.
+*   The file is a BigTIFF (TIFF with 64 bit offsets) made of uncompressed tiles in row order. Its header and directory are written before
+*   the first tile is rendered, as the place of every tile is known up front, and the workers write each tile where it belongs as soon as
+*   it has been read back, in whatever order they finish.
+*/
+
+/* BigTIFF */
+const uint16_t TIFF_SHORT = 3;
+const uint16_t TIFF_LONG = 4;
+const uint16_t TIFF_RATIONAL = 5;
+const uint16_t TIFF_LONG8 = 16;
+const uint64_t BIGTIFF_HEADER_SIZE = 16;
+const uint64_t BIGTIFF_ENTRY_SIZE = 20;
+const uint64_t POSTER_DIRECTORY_ENTRIES = 14;
+
+/// <summary>
+/// Write the lowest bytes of a value to the file, least significant first as the "II" of the header promises
+/// </summary>
+static void writeLittleEndian(std::ostream& stream, uint64_t value, size_t bytes) {
+    char buffer[8];
+    for (size_t i = 0; i < bytes; i++) {
+        buffer[i] = static_cast<char>(value >> (8 * i));
+    }
+    stream.write(buffer, static_cast<std::streamsize>(bytes));
+}
+
+void HelloTriangleApplication::createPosterTiles() {
+    //every tile has to be rendered the same way, as a part of a single view
+    if (options.offlineFrames > 0 || options.dynamicResolution || options.views > 1 || options.hud) {
+        throw std::runtime_error("a poster is rendered at full resolution from a single view, without --offline, --dynamic-resolution, --views or --hud");
+    }
+
+    uint32_t tile = options.posterTileSize;
+    posterTilesAcross = (options.posterWidth + tile - 1) / tile;
+    posterTilesDown = (options.posterHeight + tile - 1) / tile;
+}
+
+void HelloTriangleApplication::openPoster() {
+    posterStream.open(options.posterFile, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!posterStream) {
+        throw std::runtime_error("failed to create poster " + options.posterFile);
+    }
+
+    //tiles at the right and bottom edges are whole as well, readers leave out what is past the size of the image
+    uint64_t tileCount = static_cast<uint64_t>(posterTilesAcross) * posterTilesDown;
+    uint64_t tileBytes = static_cast<uint64_t>(options.posterTileSize) * options.posterTileSize * 3;
+
+    //the directory follows the header, then the offset and the size of every tile, then the tiles
+    uint64_t directoryOffset = BIGTIFF_HEADER_SIZE;
+    uint64_t offsetsOffset = directoryOffset + 8 + POSTER_DIRECTORY_ENTRIES * BIGTIFF_ENTRY_SIZE + 8;
+    uint64_t sizesOffset = offsetsOffset + tileCount * 8;
+    posterDataOffset = sizesOffset + tileCount * 8;
+
+    struct DirectoryEntry {
+        uint16_t tag;
+        uint16_t type;
+        uint64_t count;
+        uint64_t value;     //the values themselves when they fit in 8 bytes, else where they are
+    };
+    //sorted by tag, as TIFF requires
+    const DirectoryEntry entries[] = {
+        { 256, TIFF_LONG, 1, options.posterWidth },                     //ImageWidth
+        { 257, TIFF_LONG, 1, options.posterHeight },                    //ImageLength
+        { 258, TIFF_SHORT, 3, 8 | (8ull << 16) | (8ull << 32) },        //BitsPerSample
+        { 259, TIFF_SHORT, 1, 1 },                                      //Compression: none
+        { 262, TIFF_SHORT, 1, 2 },                                      //PhotometricInterpretation: RGB
+        { 277, TIFF_SHORT, 1, 3 },                                      //SamplesPerPixel
+        { 282, TIFF_RATIONAL, 1, 72 | (1ull << 32) },                   //XResolution: 72 / 1
+        { 283, TIFF_RATIONAL, 1, 72 | (1ull << 32) },                   //YResolution
+        { 284, TIFF_SHORT, 1, 1 },                                      //PlanarConfiguration: RGB together
+        { 296, TIFF_SHORT, 1, 2 },                                      //ResolutionUnit: inch
+        { 322, TIFF_LONG, 1, options.posterTileSize },                  //TileWidth
+        { 323, TIFF_LONG, 1, options.posterTileSize },                  //TileLength
+        { 324, TIFF_LONG8, tileCount, tileCount == 1 ? posterDataOffset : offsetsOffset },  //TileOffsets
+        { 325, TIFF_LONG8, tileCount, tileCount == 1 ? tileBytes : sizesOffset },           //TileByteCounts
+    };
+    static_assert(sizeof(entries) / sizeof(entries[0]) == POSTER_DIRECTORY_ENTRIES, "the directory is sized by POSTER_DIRECTORY_ENTRIES");
+
+    posterStream.write("II", 2);
+    writeLittleEndian(posterStream, 43, 2);     //BigTIFF
+    writeLittleEndian(posterStream, 8, 2);      //bytes per offset
+    writeLittleEndian(posterStream, 0, 2);
+    writeLittleEndian(posterStream, directoryOffset, 8);
+
+    writeLittleEndian(posterStream, POSTER_DIRECTORY_ENTRIES, 8);
+    for (const auto& entry : entries) {
+        writeLittleEndian(posterStream, entry.tag, 2);
+        writeLittleEndian(posterStream, entry.type, 2);
+        writeLittleEndian(posterStream, entry.count, 8);
+        writeLittleEndian(posterStream, entry.value, 8);
+    }
+    writeLittleEndian(posterStream, 0, 8);      //no directory after this one
+
+    //written out one by one rather than kept, so that nothing here grows with the poster
+    for (uint64_t tile = 0; tile < tileCount; tile++) {
+        writeLittleEndian(posterStream, posterDataOffset + tile * tileBytes, 8);
+    }
+    for (uint64_t tile = 0; tile < tileCount; tile++) {
+        writeLittleEndian(posterStream, tileBytes, 8);
+    }
+
+    if (!posterStream) {
+        throw std::runtime_error("failed to write the header of poster " + options.posterFile);
+    }
+}
+
+void HelloTriangleApplication::closePoster() {
+    posterStream.close();
+    if (posterStream.fail()) {
+        throw std::runtime_error("failed to write poster " + options.posterFile);
+    }
+}
+
+glm::mat4 HelloTriangleApplication::posterTileProjection(uint64_t tile) {
+    float width = static_cast<float>(options.posterWidth);
+    float height = static_cast<float>(options.posterHeight);
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), width / height, CAMERA_NEAR, CAMERA_FAR);
+    proj[1][1] *= -1;
+
+    //pixels of the poster the tile and its guard band cover, y goes down like the rows of the image
+    float size = static_cast<float>(options.posterTileSize + 2 * POSTER_TILE_MARGIN);
+    float left = static_cast<float>((tile % posterTilesAcross) * options.posterTileSize) - POSTER_TILE_MARGIN;
+    float top = static_cast<float>((tile / posterTilesAcross) * options.posterTileSize) - POSTER_TILE_MARGIN;
+
+    //scale that part of the poster up to the whole of clip space and move its center to the middle.
+    //the offset is applied before the divide by w, so it is scaled by w too
+    float scaleX = width / size;
+    float scaleY = height / size;
+    float centerX = (left + size * 0.5f) / width * 2.0f - 1.0f;
+    float centerY = (top + size * 0.5f) / height * 2.0f - 1.0f;
+
+    glm::mat4 crop(1.0f);
+    crop[0][0] = scaleX;
+    crop[1][1] = scaleY;
+    crop[3][0] = -scaleX * centerX;
+    crop[3][1] = -scaleY * centerY;
+    return crop * proj;
+}
+
+size_t HelloTriangleApplication::packPosterTile(const OfflineOutput& output, std::vector<unsigned char>& packed) {
+    uint32_t tile = options.posterTileSize;
+    size_t size = static_cast<size_t>(tile) * tile * 3;
+    if (packed.size() < size) {
+        packed.resize(size);
+    }
+
+    unsigned char* out = packed.data();
+    for (uint32_t y = 0; y < tile; y++) {
+        const unsigned char* row = output.pixels + (y + POSTER_TILE_MARGIN) * output.rowPitch + POSTER_TILE_MARGIN * 4;
+        for (uint32_t x = 0; x < tile; x++) {
+            out[0] = row[x * 4 + 0];
+            out[1] = row[x * 4 + 1];
+            out[2] = row[x * 4 + 2];
+            out += 3;
+        }
+    }
+    return size;
+}
+
+bool HelloTriangleApplication::writePosterTile(uint64_t tile, const unsigned char* packed, size_t size) {
+    std::lock_guard<std::mutex> lock(posterStreamMutex);
+    posterStream.seekp(static_cast<std::streamoff>(posterDataOffset + tile * size));
+    posterStream.write(reinterpret_cast<const char*>(packed), static_cast<std::streamsize>(size));
+    if (!posterStream) {
+        std::cerr << "failed to write tile " << tile << " of poster " << options.posterFile << std::endl;
+        posterStream.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Scene
+*   A floor which runs from in front of the camera to the far plane, two rows of pillars standing on it and the original triangle,
+*   balanced on its tip in the middle and spinning around the vertical axis. The floor and the pillars are static, the triangle is the only
+*   dynamic object. Everything is built from flat shaded quads, front faces are counter clockwise when seen from the side the normal points to.
+*/
+
+void HelloTriangleApplication::createScene() {
+    vertices.clear();
+    sceneObjects.clear();
+
+    //axis aligned box, every face points outward
+    auto addBox = [this](const glm::vec3& minCorner, const glm::vec3& maxCorner, const glm::vec3& color) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int side = 0; side < 2; side++) {
+                glm::vec3 normal(0.0f);
+                normal[axis] = side ? 1.0f : -1.0f;
+
+                //the two axes spanning this face
+                int u = (axis + 1) % 3;
+                int v = (axis + 2) % 3;
+
+                glm::vec3 corners[4];
+                for (int i = 0; i < 4; i++) {
+                    corners[i][axis] = side ? maxCorner[axis] : minCorner[axis];
+                    corners[i][u] = (i == 1 || i == 2) ? maxCorner[u] : minCorner[u];
+                    corners[i][v] = (i >= 2) ? maxCorner[v] : minCorner[v];
+                }
+
+                addSceneQuad(corners, normal, color);
+            }
+        }
+    };
+
+    /* Triangle */
+    //the original triangle, given a back face so that it can be seen from both sides while it spins
+    uint32_t first = static_cast<uint32_t>(vertices.size());
+    glm::vec3 trianglePositions[] = { {0.0f, -0.5f, 0.0f}, {0.5f, 0.5f, 0.0f}, {-0.5f, 0.5f, 0.0f} };
+    glm::vec3 triangleColors[] = { {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} };
+    for (int i = 0; i < 3; i++) {
+        vertices.push_back({ trianglePositions[i], { triangleColors[i], glm::vec3(0.0f, 0.0f, 1.0f) } });
+    }
+    for (int i = 2; i >= 0; i--) {
+        vertices.push_back({ trianglePositions[i], { triangleColors[i], glm::vec3(0.0f, 0.0f, -1.0f) } });
+    }
+    addSceneObject(first, false);
+
+    /* Floor */
+    //touches the tip of the triangle and reaches past the far plane
+    first = static_cast<uint32_t>(vertices.size());
+    glm::vec3 floorCorners[] = { {-4.0f, -0.5f, 1.5f}, {4.0f, -0.5f, 1.5f}, {4.0f, -0.5f, -8.5f}, {-4.0f, -0.5f, -8.5f} };
+    addSceneQuad(floorCorners, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.6f));
+    addSceneObject(first, true);
+
+    /* Pillars */
+    //two rows receding into the distance, so that every cascade has casters in it
+    const std::array<float, 5> pillarDepths = { -1.0f, -2.5f, -4.0f, -5.5f, -7.0f };
+    for (size_t i = 0; i < pillarDepths.size(); i++) {
+        float offset = 1.2f + 0.3f * static_cast<float>(i);
+        float height = 0.8f + 0.25f * static_cast<float>(i % 3);
+        glm::vec3 color = glm::vec3(0.8f, 0.5f + 0.1f * static_cast<float>(i), 0.4f);
+
+        for (float side : { -1.0f, 1.0f }) {
+            first = static_cast<uint32_t>(vertices.size());
+            glm::vec3 center(side * offset, -0.5f, pillarDepths[i]);
+            addBox(center - glm::vec3(0.15f, 0.0f, 0.15f), center + glm::vec3(0.15f, height, 0.15f), color);
+            addSceneObject(first, true);
+        }
+    }
+}
+
+void HelloTriangleApplication::addSceneQuad(const glm::vec3 corners[4], const glm::vec3& normal, const glm::vec3& color) {
+    //winding is picked from the normal so the corners can be given in either order
+    int order[6] = { 0, 1, 2, 0, 2, 3 };
+    if (glm::dot(glm::cross(corners[1] - corners[0], corners[2] - corners[0]), normal) < 0.0f) {
+        std::swap(order[1], order[2]);
+        std::swap(order[4], order[5]);
+    }
+
+    for (int index : order) {
+        vertices.push_back({ corners[index], { color, normal } });
+    }
+}
+
+void HelloTriangleApplication::addSceneObject(uint32_t firstVertex, bool isStatic) {
+    SceneObject object{};
+    object.firstVertex = firstVertex;
+    object.vertexCount = static_cast<uint32_t>(vertices.size()) - firstVertex;
+    object.isStatic = isStatic;
+
+    glm::vec3 minCorner = vertices[firstVertex].pos;
+    glm::vec3 maxCorner = vertices[firstVertex].pos;
+    for (uint32_t i = firstVertex; i < vertices.size(); i++) {
+        minCorner = glm::min(minCorner, vertices[i].pos);
+        maxCorner = glm::max(maxCorner, vertices[i].pos);
+    }
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+    object.boundingSphere = glm::vec4(center, glm::length(maxCorner - center));
+
+    sceneObjects.push_back(object);
+}
+
+void HelloTriangleApplication::updateScene(float time) {
+    if (options.stressScene) {
+        updateStressScene(time);
+        return;
+    }
+
+    //the triangle spins around the vertical axis through its center
+    sceneObjects[0].model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
@@ -0,0 +1,142 @@
+#include "HelloTriangleApplication.h"
+
+#include <sstream>
+#include <iomanip>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+/*
+* Shader benchmark
+*   Measures what the spirv-opt passes of the shader compiler buy. Every source is compiled once without and once with the passes, and for each:
+*       1. the SPIR-V of every source is added up
+*       2. with the device idle, every reloadable pipeline is built again from it -- the time spent in vkCreate*Pipelines
+*       3. a number of frames is rendered and their GPU time (the timestamps of the dynamic resolution) is averaged
+*   The render scale stays fixed and the hot reload is off, so that both runs render the same thing.
+*/
+
+/// <summary>
+/// Results of one run of the shader benchmark
+/// </summary>
+struct ShaderBenchmarkResult {
+    size_t spirvSize = 0;           //bytes
+    double pipelineTime = 0.0;      //milliseconds, all pipelines
+    double gpuTime = 0.0;           //milliseconds, average frame
+};
+
+void HelloTriangleApplication::runShaderBenchmark() {
+    if (!compileShaderSources) {
+        throw std::runtime_error("the shader benchmark needs the shader sources, see --shader-dir");
+    }
+    checkBenchmarkPreconditions("shader benchmark");
+
+    ShaderBenchmarkResult results[2];
+    for (int optimize = 0; optimize < 2; optimize++) {
+        ShaderBenchmarkResult& result = results[optimize];
+        vkDeviceWaitIdle(device);
+
+        //every pipeline library is compiled again, so that neither run is timed against the libraries of the one before it
+        waitForShaderJobs();
+        updateReloadedPipelines(true);
+        destroyPipelineLibraries(VK_NULL_HANDLE);
+
+        /* SPIR-V */
+        optimizeShaders = (optimize != 0);
+
+        std::vector<std::string> sourceFiles;
+        {
+            std::lock_guard<std::mutex> lock(shaderCodeMutex);
+            for (const auto& code : shaderCode) {
+                sourceFiles.push_back(code.first);
+            }
+        }
+
+        for (const auto& sourceFile : sourceFiles) {
+            addShaderJob([this, sourceFile]() {
+                std::vector<char> code = compileShader(sourceFile);
+                std::lock_guard<std::mutex> lock(shaderCodeMutex);
+                shaderCode[sourceFile] = std::move(code);
+            });
+        }
+        waitForShaderJobs();
+
+        {
+            std::lock_guard<std::mutex> lock(shaderCodeMutex);
+            for (const auto& code : shaderCode) {
+                result.spirvSize += code.second.size();
+            }
+        }
+
+        /* Pipelines */
+        //built one after another on this thread, so the time is that of the driver alone
+        //with pipeline libraries this is the time until the fast linked pipeline can be used
+        for (auto& reloadable : reloadablePipelines) {
+            auto start = Clock::now();
+            VkPipeline pipeline = reloadable.build();
+            result.pipelineTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            untrackObject(VK_OBJECT_TYPE_PIPELINE, *reloadable.pipeline);
+            vkDestroyPipeline(device, *reloadable.pipeline, nullptr);
+            *reloadable.pipeline = pipeline;
+            scheduleOptimizedLink(reloadable.pipeline, pipeline, reloadable.generation);
+        }
+
+        //the frames are timed with the optimized links in place
+        waitForShaderJobs();
+        updateReloadedPipelines(true);
+
+        /* Frames */
+        double cpuTime;
+        measureFrames("shader benchmark", cpuTime, result.gpuTime);
+    }
+
+    vkDeviceWaitIdle(device);
+    optimizeShaders = options.optimizeShaders;
+
+    auto change = [](double before, double after) {
+        std::ostringstream text;
+        text << std::showpos << std::fixed << std::setprecision(1) << (before > 0.0 ? (after - before) / before * 100.0 : 0.0) << "%";
+        return text.str();
+    };
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "shader benchmark, " << reloadablePipelines.size() << " pipelines, " << BENCHMARK_FRAMES << " frames at "
+        << renderExtent.width << "x" << renderExtent.height << "\n"
+        << std::left << std::setw(20) << "" << std::setw(16) << "unoptimized" << std::setw(16) << "optimized" << "change\n"
+        << std::setw(20) << "SPIR-V (bytes)" << std::setw(16) << results[0].spirvSize << std::setw(16) << results[1].spirvSize
+        << change(static_cast<double>(results[0].spirvSize), static_cast<double>(results[1].spirvSize)) << "\n"
+        << std::setw(20) << "pipelines (ms)" << std::setw(16) << results[0].pipelineTime << std::setw(16) << results[1].pipelineTime
+        << change(results[0].pipelineTime, results[1].pipelineTime) << "\n"
+        << std::setw(20) << "GPU frame (ms)" << std::setw(16) << results[0].gpuTime << std::setw(16) << results[1].gpuTime
+        << change(results[0].gpuTime, results[1].gpuTime) << std::endl;
+}
+
+void HelloTriangleApplication::checkBenchmarkPreconditions(const std::string& benchmark) {
+    if (options.dynamicResolution) {
+        throw std::runtime_error("the " + benchmark + " needs a fixed render scale, leave out --dynamic-resolution");
+    }
+    if (timestampQueryPool == VK_NULL_HANDLE) {
+        throw std::runtime_error("the " + benchmark + " needs timestamp queries");
+    }
+}
+
+void HelloTriangleApplication::measureFrames(const std::string& benchmark, double& cpuTime, double& gpuTime) {
+    cpuTime = 0.0;
+    gpuTime = 0.0;
+
+    int measuredFrames = 0;
+    for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES && !glfwWindowShouldClose(window); frame++) {
+        glfwPollEvents();
+        drawFrame();
+
+        if (frame >= BENCHMARK_WARMUP_FRAMES) {
+            cpuTime += recordTime;
+            gpuTime += gpuFrameTime;
+            measuredFrames++;
+        }
+    }
+    if (measuredFrames == 0) {
+        throw std::runtime_error("window closed before the " + benchmark + " finished");
+    }
+    cpuTime /= measuredFrames;
+    gpuTime /= measuredFrames;
+}
@@ -0,0 +1,592 @@
+#include "HelloTriangleApplication.h"
+
+#include <shaderc/shaderc.hpp>
+#include <spirv-tools/optimizer.hpp>
+
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/*
+* Shader compiler
+*   The GLSL sources are compiled at runtime with shaderc, so changing a shader no longer means running compile.bat and restarting.
+*       1. startup: every source of the shader directory is compiled on the shader workers before the pipelines are created. The SPIR-V is
+*          written to SHADER_CACHE_DIR under a hash of the source and every file it includes, so unchanged shaders are only read back next time.
+*       2. watch: a watcher thread waits for files of the shader directory to be written (inotify on linux, modification times elsewhere).
+*       3. reload: every source which is or includes the changed file is compiled again, then every pipeline made from one of them is built
+*          again -- both on the shader workers. The render loop swaps the new pipelines in before it records a frame and destroys the old
+*          ones once no frame in flight can use them, so it never waits for the compiler.
+*   The compiler output goes through the spirv-opt performance passes (inlining, dead code elimination, constant folding, ...) before it
+*   is cached, release builds strip the debug names as well. Specialization constants are left alone, the driver still folds those.
+*   A source which does not compile prints the compiler output and leaves the running pipelines as they are.
+*   When the shader directory can not be found the .spv files built by shaders/compile.bat are loaded instead, without hot reload.
+*/
+
+const std::filesystem::path SHADER_CACHE_DIR = "shaderCache";
+//part of every cache key, must change along with the compile options so that no stale SPIR-V is read back
+const uint32_t SHADER_CACHE_VERSION = 2;
+//how often the modification times are compared where inotify is not available
+const auto SHADER_POLL_INTERVAL = std::chrono::milliseconds(250);
+//editors often save in several writes, the events arriving within this time are taken as one change
+const auto SHADER_CHANGE_SETTLE_TIME = std::chrono::milliseconds(50);
+
+/// <summary>
+/// Progress of one reload: the last of its compiles to finish rebuilds the pipelines, once for every source that compiled
+/// </summary>
+struct ShaderReload {
+    std::mutex mutex;
+    size_t remaining;
+    std::set<std::string> compiledSources;
+};
+
+/// <summary>
+/// Resolves the quoted includes of a shader against the shader directory
+/// </summary>
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+public:
+    explicit ShaderIncluder(const std::filesystem::path& directory) : directory(directory) {}
+
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override {
+        auto* include = new IncludeData();
+
+        std::ifstream file(directory / requestedSource, std::ios::binary);
+        if (file) {
+            include->name = requestedSource;
+            include->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        else {
+            //an empty name tells shaderc the include failed, the content is the error message then
+            include->content = "failed to open " + (directory / requestedSource).string();
+        }
+
+        include->result.source_name = include->name.c_str();
+        include->result.source_name_length = include->name.size();
+        include->result.content = include->content.c_str();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+        return &include->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* data) override {
+        delete static_cast<IncludeData*>(data->user_data);
+    }
+
+private:
+    struct IncludeData {
+        std::string name;
+        std::string content;
+        shaderc_include_result result{};
+    };
+
+    std::filesystem::path directory;
+};
+
+static std::string readShaderSource(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("failed to open shader source " + path.string());
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//FNV-1a, only used to tell versions of a source apart
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// <summary>
+/// Add a source to the hash, followed by every file it includes the first time each one is seen.
+/// Only quoted includes next to the source are followed, which is all the shaders use.
+/// </summary>
+static uint64_t hashShaderSource(uint64_t hash, const std::filesystem::path& directory, const std::string& source, std::set<std::string>& includes) {
+    hash = hashBytes(hash, source.data(), source.size());
+
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            continue;
+        }
+
+        size_t open = line.find('"', start);
+        size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            continue;
+        }
+
+        std::string include = line.substr(open + 1, close - open - 1);
+        if (includes.insert(include).second) {
+            hash = hashShaderSource(hash, directory, readShaderSource(directory / include), includes);
+        }
+    }
+
+    return hash;
+}
+
+static shaderc_shader_kind shaderKind(const std::string& sourceFile) {
+    std::string extension = std::filesystem::path(sourceFile).extension().string();
+    if (extension == ".vert") {
+        return shaderc_vertex_shader;
+    }
+    if (extension == ".frag") {
+        return shaderc_fragment_shader;
+    }
+    if (extension == ".comp") {
+        return shaderc_compute_shader;
+    }
+    return shaderc_glsl_infer_from_source;
+}
+
+/// <summary>
+/// Run the spirv-opt performance passes over a module, which is what spirv-opt -O does. Release builds also drop the debug names.
+/// </summary>
+static std::vector<uint32_t> optimizeSpirv(const std::string& sourceFile, const std::vector<uint32_t>& spirv) {
+    spvtools::Optimizer optimizer(SPV_ENV_VULKAN_1_0);
+
+    std::string messages;
+    optimizer.SetMessageConsumer([&messages](spv_message_level_t level, const char* source, const spv_position_t& position, const char* message) {
+        if (level <= SPV_MSG_ERROR) {
+            messages += std::string(message) + "\n";
+        }
+    });
+
+    optimizer.RegisterPerformancePasses();
+#ifdef NDEBUG
+    optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+#endif
+
+    std::vector<uint32_t> optimized;
+    if (!optimizer.Run(spirv.data(), spirv.size(), &optimized)) {
+        throw std::runtime_error("failed to optimize " + sourceFile + ":\n" + messages);
+    }
+
+    return optimized;
+}
+
+static bool isShaderSource(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+void HelloTriangleApplication::createShaderCompiler() {
+    std::filesystem::path directory = options.shaderDirectory;
+    compileShaderSources = std::filesystem::is_directory(directory);
+    optimizeShaders = options.optimizeShaders;
+
+    //leave most of the cores to the driver, which compiles the rebuilt pipelines on the same workers
+    //started without the sources as well, the optimized links of the pipeline libraries run on them
+    uint32_t workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        shaderWorkers.emplace_back([this]() { runShaderWorker(); });
+    }
+
+    if (!compileShaderSources) {
+        //the SPIR-V files are not checked in, they are built from the sources by shaders/compile.bat
+        std::cout << "shader sources not found in " << options.shaderDirectory << ", loading the SPIR-V files built by shaders/compile.bat \n";
+        return;
+    }
+
+    std::filesystem::create_directories(SHADER_CACHE_DIR);
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (!isShaderSource(entry.path())) {
+            continue;
+        }
+
+        std::string sourceFile = entry.path().filename().string();
+        addShaderJob([this, sourceFile]() {
+            //a source which fails is reported here, and again when a pipeline asks for it
+            std::vector<char> code = compileShader(sourceFile);
+            std::lock_guard<std::mutex> lock(shaderCodeMutex);
+            shaderCode[sourceFile] = std::move(code);
+        });
+    }
+
+    waitForShaderJobs();
+}
+
+void HelloTriangleApplication::destroyShaderCompiler() {
+    stopShaderWatcher = true;
+    if (shaderWatcher.joinable()) {
+        shaderWatcher.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shaderJobMutex);
+        stopShaderWorkers = true;
+        shaderJobs.clear();
+    }
+    shaderJobCondition.notify_all();
+    for (auto& worker : shaderWorkers) {
+        worker.join();
+    }
+    shaderWorkers.clear();
+
+    updateReloadedPipelines(true);
+}
+
+std::vector<char> HelloTriangleApplication::loadShaderCode(const ShaderVariant& variant) {
+    if (!compileShaderSources) {
+        return readFile(variant.spirvFile);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shaderCodeMutex);
+        auto code = shaderCode.find(variant.sourceFile);
+        if (code != shaderCode.end()) {
+            return code->second;
+        }
+    }
+
+    std::vector<char> code = compileShader(variant.sourceFile);
+    std::lock_guard<std::mutex> lock(shaderCodeMutex);
+    shaderCode[variant.sourceFile] = code;
+    return code;
+}
+
+std::vector<char> HelloTriangleApplication::compileShader(const std::string& sourceFile) {
+    TraceZone zone(*this, "compileShader");
+    std::filesystem::path directory = options.shaderDirectory;
+    std::string source = readShaderSource(directory / sourceFile);
+
+    /* Cache */
+    //the key covers the compile options, the source and everything it includes -- a change to any of them is a new entry
+    //unoptimized and optimized code of a source are kept side by side, so the shader benchmark does not evict either
+    bool optimize = optimizeShaders;
+    std::set<std::string> includes;
+    uint64_t hash = hashBytes(14695981039346656037ull, &SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+    hash = hashShaderSource(hash, directory, source, includes);
+
+    {
+        std::lock_guard<std::mutex> lock(shaderCodeMutex);
+        shaderIncludes[sourceFile] = includes;
+    }
+
+    std::ostringstream cacheName;
+    cacheName << sourceFile << (optimize ? ".opt." : ".") << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+    std::filesystem::path cachePath = SHADER_CACHE_DIR / cacheName.str();
+
+    if (std::filesystem::exists(cachePath)) {
+        shaderCacheHitsMetric->increment();
+        return readFile(cachePath.string());
+    }
+    shaderCacheMissesMetric->increment();
+
+    /* Compile */
+    shaderc::Compiler compiler;
+    shaderc::CompileOptions compileOptions;
+    compileOptions.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    compileOptions.SetIncluder(std::make_unique<ShaderIncluder>(directory));
+
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, shaderKind(sourceFile), sourceFile.c_str(), compileOptions);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error("failed to compile " + sourceFile + ":\n" + result.GetErrorMessage());
+    }
+
+    std::vector<uint32_t> spirv(result.cbegin(), result.cend());
+    if (optimize) {
+        spirv = optimizeSpirv(sourceFile, spirv);
+    }
+
+    std::vector<char> code(reinterpret_cast<const char*>(spirv.data()), reinterpret_cast<const char*>(spirv.data() + spirv.size()));
+
+    //written under another name first, so that a half written entry is never read back
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        file.write(code.data(), code.size());
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+
+    //older entries of the same source and optimization are never read again
+    std::string entryPrefix = sourceFile + (optimize ? ".opt." : ".");
+    for (const auto& entry : std::filesystem::directory_iterator(SHADER_CACHE_DIR, error)) {
+        std::string name = entry.path().filename().string();
+        bool sameKind = name.rfind(entryPrefix, 0) == 0 && (optimize || name.rfind(sourceFile + ".opt.", 0) != 0);
+        if (name != cacheName.str() && sameKind && entry.path().extension() == ".spv") {
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+
+    return code;
+}
+
+/* Shader Workers */
+
+void HelloTriangleApplication::addShaderJob(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(shaderJobMutex);
+        shaderJobs.push_back(std::move(job));
+    }
+    shaderJobCondition.notify_all();
+}
+
+void HelloTriangleApplication::runShaderWorker() {
+    setTraceThreadName("shader worker");
+
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(shaderJobMutex);
+            shaderJobCondition.wait(lock, [this]() { return stopShaderWorkers || (!shaderJobsPaused && !shaderJobs.empty()); });
+            if (stopShaderWorkers) {
+                return;
+            }
+
+            job = std::move(shaderJobs.front());
+            shaderJobs.pop_front();
+            runningShaderJobs++;
+        }
+
+        //a shader that does not compile must not take the application down, the old pipelines keep running
+        try {
+            TraceZone zone(*this, "shader job");
+            job();
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shaderJobMutex);
+            runningShaderJobs--;
+        }
+        shaderJobCondition.notify_all();
+    }
+}
+
+void HelloTriangleApplication::waitForShaderJobs() {
+    std::unique_lock<std::mutex> lock(shaderJobMutex);
+    shaderJobCondition.wait(lock, [this]() { return shaderJobs.empty() && runningShaderJobs == 0; });
+}
+
+void HelloTriangleApplication::pauseShaderJobs() {
+    std::unique_lock<std::mutex> lock(shaderJobMutex);
+    shaderJobsPaused = true;
+    shaderJobCondition.wait(lock, [this]() { return runningShaderJobs == 0; });
+}
+
+void HelloTriangleApplication::resumeShaderJobs() {
+    {
+        std::lock_guard<std::mutex> lock(shaderJobMutex);
+        shaderJobsPaused = false;
+    }
+    shaderJobCondition.notify_all();
+}
+
+/* Hot Reload */
+
+void HelloTriangleApplication::watchShaderSources() {
+    setTraceThreadName("shader watcher");
+    std::filesystem::path directory = options.shaderDirectory;
+
+#ifdef __linux__
+    int watch = inotify_init1(IN_NONBLOCK);
+    if (watch < 0 || inotify_add_watch(watch, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "failed to watch " << options.shaderDirectory << ", shaders will not be reloaded" << std::endl;
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (!stopShaderWatcher) {
+        //wake up now and then to see if the application is shutting down
+        pollfd pollInfo{ watch, POLLIN, 0 };
+        if (poll(&pollInfo, 1, 100) <= 0) {
+            continue;
+        }
+
+        std::this_thread::sleep_for(SHADER_CHANGE_SETTLE_TIME);
+
+        std::set<std::string> changedFiles;
+        ssize_t length;
+        while ((length = read(watch, buffer, sizeof(buffer))) > 0) {
+            for (char* entry = buffer; entry < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(entry);
+                if (event->len > 0) {
+                    changedFiles.insert(event->name);
+                }
+                entry += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        for (const auto& changedFile : changedFiles) {
+            reloadShader(changedFile);
+        }
+    }
+
+    close(watch);
+#else
+    //no inotify: compare the modification time of every file in the directory a few times a second
+    auto readWriteTimes = [&directory]() {
+        std::map<std::string, std::filesystem::file_time_type> writeTimes;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            //a file can be in the middle of being replaced, it shows up again on the next pass
+            auto writeTime = entry.last_write_time(error);
+            if (!error) {
+                writeTimes[entry.path().filename().string()] = writeTime;
+            }
+        }
+        return writeTimes;
+    };
+
+    auto writeTimes = readWriteTimes();
+    while (!stopShaderWatcher) {
+        std::this_thread::sleep_for(SHADER_POLL_INTERVAL);
+
+        auto newWriteTimes = readWriteTimes();
+        for (const auto& file : newWriteTimes) {
+            auto previous = writeTimes.find(file.first);
+            if (previous == writeTimes.end() || previous->second != file.second) {
+                reloadShader(file.first);
+            }
+        }
+        writeTimes = std::move(newWriteTimes);
+    }
+#endif
+}
+
+void HelloTriangleApplication::reloadShader(const std::string& changedFile) {
+    std::vector<std::string> sourceFiles;
+    {
+        std::lock_guard<std::mutex> lock(shaderCodeMutex);
+        for (const auto& source : shaderIncludes) {
+            if (source.first == changedFile || source.second.count(changedFile) != 0) {
+                sourceFiles.push_back(source.first);
+            }
+        }
+    }
+
+    //nothing is made from this file (compile.bat, a temporary file of an editor, ...)
+    if (sourceFiles.empty()) {
+        return;
+    }
+
+    std::cout << "reloading " << changedFile << "\n";
+
+    auto reload = std::make_shared<ShaderReload>();
+    reload->remaining = sourceFiles.size();
+
+    for (const auto& sourceFile : sourceFiles) {
+        addShaderJob([this, reload, sourceFile]() {
+            bool compiled = false;
+            try {
+                std::vector<char> code = compileShader(sourceFile);
+                std::lock_guard<std::mutex> lock(shaderCodeMutex);
+                shaderCode[sourceFile] = std::move(code);
+                compiled = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+
+            std::set<std::string> compiledSources;
+            {
+                std::lock_guard<std::mutex> lock(reload->mutex);
+                if (compiled) {
+                    reload->compiledSources.insert(sourceFile);
+                }
+                if (--reload->remaining > 0) {
+                    return;
+                }
+                compiledSources = reload->compiledSources;
+            }
+
+            rebuildPipelines(compiledSources);
+        });
+    }
+}
+
+void HelloTriangleApplication::rebuildPipelines(const std::set<std::string>& sourceFiles) {
+    //the registry only changes while the workers are paused, during startup and while the swapchain is recreated, so a worker can read it
+    for (const auto& reloadable : reloadablePipelines) {
+        bool affected = false;
+        for (const auto& variantName : reloadable.variantNames) {
+            affected |= sourceFiles.count(shaderVariants.at(variantName).sourceFile) != 0;
+        }
+        if (!affected) {
+            continue;
+        }
+
+        addShaderJob([this, target = reloadable.pipeline, build = reloadable.build, generation = reloadable.generation]() {
+            VkPipeline pipeline = build();
+            {
+                std::lock_guard<std::mutex> lock(shaderJobMutex);
+                rebuiltPipelines.push_back({ target, pipeline, generation });
+            }
+            //queued after the fast linked pipeline, so that its optimized link is swapped in after it
+            scheduleOptimizedLink(target, pipeline, generation);
+        });
+    }
+}
+
+void HelloTriangleApplication::createReloadablePipeline(VkPipeline& pipeline, const std::vector<std::string>& variantNames, const std::function<VkPipeline()>& build) {
+    pipeline = build();
+
+    auto reloadable = std::find_if(reloadablePipelines.begin(), reloadablePipelines.end(),
+        [&pipeline](const ReloadablePipeline& entry) { return entry.pipeline == &pipeline; });
+
+    if (reloadable == reloadablePipelines.end()) {
+        reloadablePipelines.push_back({ &pipeline, variantNames, build, 0 });
+        scheduleOptimizedLink(&pipeline, pipeline, 0);
+        return;
+    }
+
+    //created again along with the swapchain, anything built for the previous one is stale
+    reloadable->variantNames = variantNames;
+    reloadable->build = build;
+    reloadable->generation++;
+    scheduleOptimizedLink(&pipeline, pipeline, reloadable->generation);
+}
+
+void HelloTriangleApplication::updateReloadedPipelines(bool deviceIdle) {
+    //swapped rather than moved out, so that neither vector has to allocate again in later frames
+    takenRebuiltPipelines.clear();
+    {
+        std::lock_guard<std::mutex> lock(shaderJobMutex);
+        takenRebuiltPipelines.swap(rebuiltPipelines);
+    }
+
+    for (const auto& pipeline : takenRebuiltPipelines) {
+        auto reloadable = std::find_if(reloadablePipelines.begin(), reloadablePipelines.end(),
+            [&pipeline](const ReloadablePipeline& entry) { return entry.pipeline == pipeline.target; });
+
+        bool replaced = (pipeline.replaces != VK_NULL_HANDLE && *pipeline.target != pipeline.replaces);
+        if (reloadable == reloadablePipelines.end() || reloadable->generation != pipeline.generation || replaced) {
+            untrackObject(VK_OBJECT_TYPE_PIPELINE, pipeline.pipeline);
+            vkDestroyPipeline(device, pipeline.pipeline, nullptr);
+            continue;
+        }
+
+        //frames before this one were recorded with the old pipeline
+        retiredPipelines.push_back({ *pipeline.target, frameNumber });
+        allocationsExpected = true;
+        *pipeline.target = pipeline.pipeline;
+    }
+
+    //every frame recorded before the swap has finished once the fence of a frame framesInFlight later has been waited on
+    auto destroyed = std::remove_if(retiredPipelines.begin(), retiredPipelines.end(), [this, deviceIdle](const RetiredPipeline& retired) {
+        if (!deviceIdle && frameNumber < retired.frame + framesInFlight) {
+            return false;
+        }
+        untrackObject(VK_OBJECT_TYPE_PIPELINE, retired.pipeline);
+        vkDestroyPipeline(device, retired.pipeline, nullptr);
+        return true;
+    });
+    retiredPipelines.erase(destroyed, retiredPipelines.end());
+}
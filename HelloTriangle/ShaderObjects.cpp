@@ -0,0 +1,447 @@
+#include "HelloTriangleApplication.h"
+
+#include <iomanip>
+
+/*
+* Shader objects
+*   With VK_EXT_shader_object the scene passes are drawn without pipelines: each shader is its own object, bound on its own, and every
+*   piece of state a pipeline would have baked in is set while recording. A new combination of shaders, blending or rasterization state
+*   is then only a different set of commands instead of another pipeline to compile. The shaders are unlinked, so any vertex shader
+*   can be bound with any fragment shader.
+*   Only the passes drawing the scene geometry use them (depth prepass, shadow cascades and the main pass), the compute passes keep
+*   their pipelines. Shader objects can only be drawn with inside of dynamic rendering, so these passes then begin their attachments
+*   with vkCmdBeginRendering instead of their render passes (beginScenePass), which leaves out the deferred path: its lighting subpass
+*   reads the G-buffer as input attachments. Shader objects are not rebuilt by the hot reload.
+*/
+
+/// <summary>
+/// Fixed function state of a scene pass, the same state its pipeline is built with (buildGraphicsPipeline, buildDepthOnlyPipeline)
+/// </summary>
+struct SceneDrawState {
+    VkCullModeFlags cullMode;
+    VkBool32 depthWriteEnable;
+    VkCompareOp depthCompareOp;
+    VkBool32 depthBiasEnable;
+    float depthBiasConstantFactor;
+    float depthBiasSlopeFactor;
+};
+
+//stages which read the prepass depth later in the frame, the same as in the dependencies of the depth prepass render pass
+const VkPipelineStageFlags DEPTH_PREPASS_READ_STAGES = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+/// <summary>
+/// Aspects a layout transition of a depth image has to cover, which include the stencil when the format has one
+/// </summary>
+static VkImageAspectFlags depthAspect(VkFormat format) {
+    if (format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT) {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+void HelloTriangleApplication::checkShaderObjectSupport(VkPhysicalDeviceShaderObjectFeaturesEXT& features, VkPhysicalDeviceDynamicRenderingFeaturesKHR& dynamicRenderingFeatures, std::vector<const char*>& extensions) {
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+    dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    shaderObjectsSupported = false;
+
+    if (!options.shaderObjects && !options.shaderObjectBenchmark) {
+        return;
+    }
+
+    //dynamic rendering has no subpasses, so there is nothing the lighting could read the G-buffer from
+    if (options.deferred) {
+        throw std::runtime_error("shader objects draw the forward path, leave out --deferred");
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    //shader objects are only drawn inside of dynamic rendering, which on the 1.1 instance needs the extensions it was built on as well
+    bool extensionsAvailable = isDeviceExtensionAvailable(VK_EXT_SHADER_OBJECT_EXTENSION_NAME) &&
+        isDeviceExtensionAvailable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+        isDeviceExtensionAvailable(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) &&
+        isDeviceExtensionAvailable(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+
+    if (extensionsAvailable && deviceProperties.apiVersion >= VK_API_VERSION_1_1) {
+        features.pNext = &dynamicRenderingFeatures;
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        shaderObjectsSupported = (features.shaderObject == VK_TRUE && dynamicRenderingFeatures.dynamicRendering == VK_TRUE);
+        features.pNext = nullptr;
+    }
+
+    if (!shaderObjectsSupported) {
+        std::cout << "VK_EXT_shader_object is not supported, the scene is drawn with pipelines \n";
+        return;
+    }
+
+    extensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+    extensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+    extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+}
+
+void HelloTriangleApplication::createShaderObjects() {
+    if (!shaderObjectsSupported) {
+        return;
+    }
+
+    /* Entry Points */
+    auto load = [this](auto& function, const char* name) {
+        function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(vkGetDeviceProcAddr(device, name));
+        if (function == nullptr) {
+            throw std::runtime_error(std::string("failed to load ") + name);
+        }
+    };
+
+    auto& functions = shaderObjectFunctions;
+    load(functions.createShaders, "vkCreateShadersEXT");
+    load(functions.destroyShader, "vkDestroyShaderEXT");
+    load(functions.cmdBindShaders, "vkCmdBindShadersEXT");
+    load(functions.cmdSetVertexInput, "vkCmdSetVertexInputEXT");
+    load(functions.cmdSetViewportWithCount, "vkCmdSetViewportWithCountEXT");
+    load(functions.cmdSetScissorWithCount, "vkCmdSetScissorWithCountEXT");
+    load(functions.cmdSetPrimitiveTopology, "vkCmdSetPrimitiveTopologyEXT");
+    load(functions.cmdSetPrimitiveRestartEnable, "vkCmdSetPrimitiveRestartEnableEXT");
+    load(functions.cmdSetRasterizerDiscardEnable, "vkCmdSetRasterizerDiscardEnableEXT");
+    load(functions.cmdSetPolygonMode, "vkCmdSetPolygonModeEXT");
+    load(functions.cmdSetRasterizationSamples, "vkCmdSetRasterizationSamplesEXT");
+    load(functions.cmdSetSampleMask, "vkCmdSetSampleMaskEXT");
+    load(functions.cmdSetAlphaToCoverageEnable, "vkCmdSetAlphaToCoverageEnableEXT");
+    load(functions.cmdSetCullMode, "vkCmdSetCullModeEXT");
+    load(functions.cmdSetFrontFace, "vkCmdSetFrontFaceEXT");
+    load(functions.cmdSetDepthTestEnable, "vkCmdSetDepthTestEnableEXT");
+    load(functions.cmdSetDepthWriteEnable, "vkCmdSetDepthWriteEnableEXT");
+    load(functions.cmdSetDepthCompareOp, "vkCmdSetDepthCompareOpEXT");
+    load(functions.cmdSetDepthBoundsTestEnable, "vkCmdSetDepthBoundsTestEnableEXT");
+    load(functions.cmdSetStencilTestEnable, "vkCmdSetStencilTestEnableEXT");
+    load(functions.cmdSetDepthBiasEnable, "vkCmdSetDepthBiasEnableEXT");
+    load(functions.cmdSetColorBlendEnable, "vkCmdSetColorBlendEnableEXT");
+    load(functions.cmdSetColorWriteMask, "vkCmdSetColorWriteMaskEXT");
+    load(functions.cmdBeginRendering, "vkCmdBeginRenderingKHR");
+    load(functions.cmdEndRendering, "vkCmdEndRenderingKHR");
+
+    /* Shaders */
+    sceneVertexShader = createShaderObject("scene", VK_SHADER_STAGE_FRAGMENT_BIT);
+    sceneFragmentShader = createShaderObject("forward", 0);
+    //nothing follows it, the depth passes are drawn without a fragment shader
+    depthOnlyVertexShader = createShaderObject("depthOnly", 0);
+
+    /* Vertex Input */
+    auto bindingDescriptions = Vertex::getBindingDescriptions();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    sceneVertexBindings.clear();
+    for (const auto& description : bindingDescriptions) {
+        VkVertexInputBindingDescription2EXT binding{};
+        binding.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+        binding.binding = description.binding;
+        binding.stride = description.stride;
+        binding.inputRate = description.inputRate;
+        binding.divisor = 1;
+        sceneVertexBindings.push_back(binding);
+    }
+
+    sceneVertexAttributes.clear();
+    for (const auto& description : attributeDescriptions) {
+        VkVertexInputAttributeDescription2EXT attribute{};
+        attribute.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+        attribute.location = description.location;
+        attribute.binding = description.binding;
+        attribute.format = description.format;
+        attribute.offset = description.offset;
+        sceneVertexAttributes.push_back(attribute);
+    }
+
+    useShaderObjects = options.shaderObjects;
+}
+
+VkShaderEXT HelloTriangleApplication::createShaderObject(const std::string& variantName, VkShaderStageFlags nextStage) {
+    ShaderStage stage;
+    createShaderStage(variantName, stage);
+
+    //same interface as the pipeline layouts of the scene, so that the descriptor sets and push constants are bound the same way
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawPushConstants);
+
+    VkShaderCreateInfoEXT shaderInfo{};
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+    shaderInfo.stage = stage.createInfo.stage;
+    shaderInfo.nextStage = nextStage;
+    shaderInfo.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+    shaderInfo.codeSize = stage.code.size();
+    shaderInfo.pCode = stage.code.data();
+    shaderInfo.pName = "main";
+    shaderInfo.setLayoutCount = 1;
+    shaderInfo.pSetLayouts = &descriptorSetLayout;
+    shaderInfo.pushConstantRangeCount = 1;
+    shaderInfo.pPushConstantRanges = &pushConstantRange;
+    shaderInfo.pSpecializationInfo = stage.createInfo.pSpecializationInfo;
+
+    VkShaderEXT shader;
+    if (shaderObjectFunctions.createShaders(device, 1, &shaderInfo, nullptr, &shader) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader object " + variantName);
+    }
+    trackObject(VK_OBJECT_TYPE_SHADER_EXT, shader, variantName);
+
+    destroyShaderStage(stage);
+
+    return shader;
+}
+
+void HelloTriangleApplication::destroyShaderObjects() {
+    if (!shaderObjectsSupported) {
+        return;
+    }
+
+    untrackObject(VK_OBJECT_TYPE_SHADER_EXT, sceneVertexShader);
+    shaderObjectFunctions.destroyShader(device, sceneVertexShader, nullptr);
+    untrackObject(VK_OBJECT_TYPE_SHADER_EXT, sceneFragmentShader);
+    shaderObjectFunctions.destroyShader(device, sceneFragmentShader, nullptr);
+    untrackObject(VK_OBJECT_TYPE_SHADER_EXT, depthOnlyVertexShader);
+    shaderObjectFunctions.destroyShader(device, depthOnlyVertexShader, nullptr);
+}
+
+void HelloTriangleApplication::bindScenePass(VkCommandBuffer commandBuffer, ScenePass pass, const VkViewport& viewport, const VkRect2D& scissor) {
+    if (!useShaderObjects) {
+        VkPipeline pipeline = graphicsPipeline;
+        if (pass == ScenePass::DepthPrepass) {
+            pipeline = depthPrepassPipeline;
+        }
+        else if (pass == ScenePass::Shadow) {
+            pipeline = shadowPipeline;
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        return;
+    }
+
+    //the main pass tests against the finished prepass depth, the depth passes write it -- the shadow pass from both sides and biased
+    SceneDrawState state{ VK_CULL_MODE_BACK_BIT, VK_TRUE, VK_COMPARE_OP_LESS, VK_FALSE, 0.0f, 0.0f };
+    if (pass == ScenePass::Main) {
+        state.depthWriteEnable = VK_FALSE;
+        state.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    }
+    else if (pass == ScenePass::Shadow) {
+        state = { VK_CULL_MODE_NONE, VK_TRUE, VK_COMPARE_OP_LESS, VK_TRUE, 1.25f, 1.75f };
+    }
+
+    const auto& functions = shaderObjectFunctions;
+    bool positionsOnly = (pass != ScenePass::Main);
+
+    /* Shaders */
+    VkShaderStageFlagBits stages[] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+    VkShaderEXT shaders[] = {
+        positionsOnly ? depthOnlyVertexShader : sceneVertexShader,
+        positionsOnly ? VK_NULL_HANDLE : sceneFragmentShader
+    };
+    functions.cmdBindShaders(commandBuffer, 2, stages, shaders);
+
+    /* Vertex Input */
+    uint32_t bindingCount = positionsOnly ? 1 : static_cast<uint32_t>(sceneVertexBindings.size());
+    uint32_t attributeCount = positionsOnly ? 1 : static_cast<uint32_t>(sceneVertexAttributes.size());
+    functions.cmdSetVertexInput(commandBuffer, bindingCount, sceneVertexBindings.data(), attributeCount, sceneVertexAttributes.data());
+    functions.cmdSetPrimitiveTopology(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    functions.cmdSetPrimitiveRestartEnable(commandBuffer, VK_FALSE);
+
+    /* Rasterization */
+    functions.cmdSetViewportWithCount(commandBuffer, 1, &viewport);
+    functions.cmdSetScissorWithCount(commandBuffer, 1, &scissor);
+    functions.cmdSetRasterizerDiscardEnable(commandBuffer, VK_FALSE);
+    functions.cmdSetPolygonMode(commandBuffer, VK_POLYGON_MODE_FILL);
+    functions.cmdSetCullMode(commandBuffer, state.cullMode);
+    functions.cmdSetFrontFace(commandBuffer, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    functions.cmdSetDepthBiasEnable(commandBuffer, state.depthBiasEnable);
+    if (state.depthBiasEnable) {
+        vkCmdSetDepthBias(commandBuffer, state.depthBiasConstantFactor, 0.0f, state.depthBiasSlopeFactor);
+    }
+
+    VkSampleMask sampleMask = ~0u;
+    functions.cmdSetRasterizationSamples(commandBuffer, VK_SAMPLE_COUNT_1_BIT);
+    functions.cmdSetSampleMask(commandBuffer, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+    functions.cmdSetAlphaToCoverageEnable(commandBuffer, VK_FALSE);
+
+    /* Depth and Stencil */
+    functions.cmdSetDepthTestEnable(commandBuffer, VK_TRUE);
+    functions.cmdSetDepthWriteEnable(commandBuffer, state.depthWriteEnable);
+    functions.cmdSetDepthCompareOp(commandBuffer, state.depthCompareOp);
+    functions.cmdSetDepthBoundsTestEnable(commandBuffer, VK_FALSE);
+    functions.cmdSetStencilTestEnable(commandBuffer, VK_FALSE);
+
+    /* Color Blending */
+    //only the main pass has a color attachment, the HDR target
+    if (pass == ScenePass::Main) {
+        VkBool32 blendEnable = VK_FALSE;
+        VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        functions.cmdSetColorBlendEnable(commandBuffer, 0, 1, &blendEnable);
+        functions.cmdSetColorWriteMask(commandBuffer, 0, 1, &writeMask);
+    }
+}
+
+void HelloTriangleApplication::beginScenePass(VkCommandBuffer commandBuffer, ScenePass pass, const VkRenderPassBeginInfo& renderPassInfo, uint32_t target) {
+    if (!useShaderObjects) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+
+    //the same attachments, load and store operations as the render passes (createRenderPass, createShadowResources).
+    //only one view is rendered, several views are refused together with shader objects
+    VkRenderingAttachmentInfoKHR colorAttachmentInfo{};
+    colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+    VkRenderingAttachmentInfoKHR depthAttachmentInfo{};
+    depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachmentInfo.clearValue = renderPassInfo.pClearValues[0];
+
+    //there is no initial layout to transition from, the attachments are written over and start out undefined as in the render passes
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    VkPipelineStageFlags srcStage;
+    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    if (pass == ScenePass::Main) {
+        //depth was left read only by the prepass and is only tested against
+        colorAttachmentInfo.imageView = hdrArrayViews[target];
+        colorAttachmentInfo.clearValue = renderPassInfo.pClearValues[0];
+        depthAttachmentInfo.imageView = depthArrayView;
+        depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+        barrier.image = hdrTargets[target].image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dstStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+    else if (pass == ScenePass::Shadow) {
+        //the previous frame may still be sampling the cascade
+        depthAttachmentInfo.imageView = shadowCascadeViews[target];
+
+        barrier.image = shadowMap.image;
+        barrier.subresourceRange = { depthAspect(shadowMap.format), 0, 1, target, 1 };
+        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    else {
+        //the previous frame may still be reading the depth
+        depthAttachmentInfo.imageView = depthArrayView;
+
+        barrier.image = depthAttachment.image;
+        barrier.subresourceRange = { depthAspect(depthAttachment.format), 0, 1, 0, 1 };
+        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        srcStage = DEPTH_PREPASS_READ_STAGES;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea = renderPassInfo.renderArea;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = (pass == ScenePass::Main) ? 1 : 0;
+    renderingInfo.pColorAttachments = &colorAttachmentInfo;
+    renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+
+    shaderObjectFunctions.cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void HelloTriangleApplication::endScenePass(VkCommandBuffer commandBuffer, ScenePass pass, uint32_t target) {
+    if (!useShaderObjects) {
+        vkCmdEndRenderPass(commandBuffer);
+        return;
+    }
+
+    shaderObjectFunctions.cmdEndRendering(commandBuffer);
+
+    //the final layouts of the render passes, made visible to whatever reads the attachment later in the frame
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    VkPipelineStageFlags dstStage;
+
+    if (pass == ScenePass::Main) {
+        //sampled by the post processing
+        barrier.image = hdrTargets[target].image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        srcStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    else if (pass == ScenePass::Shadow) {
+        //sampled by the lighting
+        barrier.image = shadowMap.image;
+        barrier.subresourceRange = { depthAspect(shadowMap.format), 0, 1, target, 1 };
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    else {
+        //read by the cascade fit and tested against by the main pass
+        barrier.image = depthAttachment.image;
+        barrier.subresourceRange = { depthAspect(depthAttachment.format), 0, 1, 0, 1 };
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        dstStage = DEPTH_PREPASS_READ_STAGES;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void HelloTriangleApplication::runShaderObjectBenchmark() {
+    if (!shaderObjectsSupported) {
+        throw std::runtime_error("the shader object benchmark needs VK_EXT_shader_object");
+    }
+    checkBenchmarkPreconditions("shader object benchmark");
+
+    //milliseconds per frame: recording the scene commands on the CPU, and the GPU time of the frame
+    double cpuTimes[2] = {};
+    double gpuTimes[2] = {};
+
+    for (int shaderObjects = 0; shaderObjects < 2; shaderObjects++) {
+        //command buffers are recorded every frame, so the next frame already uses the other path
+        useShaderObjects = (shaderObjects != 0);
+
+        measureFrames("shader object benchmark", cpuTimes[shaderObjects], gpuTimes[shaderObjects]);
+    }
+
+    vkDeviceWaitIdle(device);
+    useShaderObjects = options.shaderObjects;
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "shader object benchmark, " << sceneObjects.size() << " objects, " << BENCHMARK_FRAMES << " frames at "
+        << renderExtent.width << "x" << renderExtent.height << "\n"
+        << std::left << std::setw(20) << "" << std::setw(16) << "pipelines" << "shader objects\n"
+        << std::setw(20) << "CPU record (ms)" << std::setw(16) << cpuTimes[0] << cpuTimes[1] << "\n"
+        << std::setw(20) << "GPU frame (ms)" << std::setw(16) << gpuTimes[0] << gpuTimes[1] << std::endl;
+}
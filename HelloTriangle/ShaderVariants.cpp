@@ -0,0 +1,112 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Shader variants
+*   Shaders declare their feature toggles as specialization constants instead of being copied into a file per feature.
+*   A variant is a SPIR-V file plus the values of its constants, registered here under a name. Pipelines ask for their
+*   shaders by that name and the driver folds the constants when the pipeline is compiled, so the branches on them cost nothing.
+*   Constants which follow the startup options are filled in here; constants which follow the swapchain (the output format of
+*   the upscale pass) are registered again by the code which creates that pipeline.
+*   Every variant of a source shares its SPIR-V, so the source is compiled once however many variants are made from it.
+*/
+
+void HelloTriangleApplication::createShaderVariants() {
+    uint32_t receiveShadows = options.shadows ? VK_TRUE : VK_FALSE;
+    uint32_t debugView = static_cast<uint32_t>(options.debugView);
+    bool multiview = options.views > 1;
+
+    /* Scene */
+    //the same fragment shader lights the surface right away (forward) or only stores it in the G-buffer (deferred)
+    //several views pick their camera by gl_ViewIndex, which has a vertex shader of its own
+    shaderVariants["scene"] = multiview ? ShaderVariant{ "sceneViews.vert", "sceneViews.spv", VK_SHADER_STAGE_VERTEX_BIT, {} }
+        : ShaderVariant{ "scene.vert", "vertShader.spv", VK_SHADER_STAGE_VERTEX_BIT, {} };
+    shaderVariants["forward"] = { "scene.frag", "fragShader.spv", VK_SHADER_STAGE_FRAGMENT_BIT,
+        { { SPEC_OUTPUT_GBUFFER, VK_FALSE }, { SPEC_RECEIVE_SHADOWS, receiveShadows }, { SPEC_DEBUG_VIEW, debugView },
+          { SPEC_SHARED_CLUSTERS, multiview ? VK_TRUE : VK_FALSE } } };
+    shaderVariants["gbuffer"] = { "scene.frag", "fragShader.spv", VK_SHADER_STAGE_FRAGMENT_BIT, { { SPEC_OUTPUT_GBUFFER, VK_TRUE } } };
+
+    /* Deferred Lighting */
+    shaderVariants["fullscreen"] = { "fullscreen.vert", "fullscreen.spv", VK_SHADER_STAGE_VERTEX_BIT, {} };
+    shaderVariants["deferredLighting"] = { "deferredLighting.frag", "deferredLighting.spv", VK_SHADER_STAGE_FRAGMENT_BIT,
+        { { SPEC_RECEIVE_SHADOWS, receiveShadows }, { SPEC_DEBUG_VIEW, debugView } } };
+
+    /* Clustered Lighting */
+    //the workgroup covers one depth slice of the grid, so the grid dimensions are only defined in one place
+    shaderVariants["clusterLights"] = { "clusterLights.comp", "clusterLights.spv", VK_SHADER_STAGE_COMPUTE_BIT, { { 0, CLUSTER_GRID_X }, { 1, CLUSTER_GRID_Y } } };
+
+    /* Shadows */
+    shaderVariants["depthOnly"] = multiview ? ShaderVariant{ "depthViews.vert", "depthViews.spv", VK_SHADER_STAGE_VERTEX_BIT, {} }
+        : ShaderVariant{ "depthOnly.vert", "depthOnly.spv", VK_SHADER_STAGE_VERTEX_BIT, {} };
+    shaderVariants["shadowDepthBounds"] = { "shadowDepthBounds.comp", "shadowDepthBounds.spv", VK_SHADER_STAGE_COMPUTE_BIT, {} };
+    //the fit needs the shadow map size to snap to texels and the number of cascades it fits
+    shaderVariants["shadowCascadeFit"] = { "shadowCascadeFit.comp", "shadowCascadeFit.spv", VK_SHADER_STAGE_COMPUTE_BIT, { { 0, SHADOW_MAP_SIZE }, { 1, DYNAMIC_CASCADE_COUNT } } };
+
+    /* Post Processing */
+    shaderVariants["bloomDownsample"] = { "bloomDownsample.comp", "bloomDownsample.spv", VK_SHADER_STAGE_COMPUTE_BIT, {} };
+    shaderVariants["bloomUpsample"] = { "bloomUpsample.comp", "bloomUpsample.spv", VK_SHADER_STAGE_COMPUTE_BIT, {} };
+    //the composite pass places the views side by side
+    shaderVariants["postComposite"] = { "postComposite.comp", "postComposite.spv", VK_SHADER_STAGE_COMPUTE_BIT, { { 0, options.views } } };
+}
+
+void HelloTriangleApplication::createShaderStage(const std::string& variantName, ShaderStage& stage) {
+    auto variant = shaderVariants.find(variantName);
+    if (variant == shaderVariants.end()) {
+        throw std::runtime_error("unknown shader variant " + variantName);
+    }
+
+    createShaderStage(variant->second, stage);
+}
+
+void HelloTriangleApplication::createShaderStage(const ShaderVariant& variant, ShaderStage& stage) {
+    stage.code = loadShaderCode(variant);
+    stage.module = createShaderModule(stage.code);
+
+    //every constant is 32 bits, so each one sits at the next 4 bytes of the data block
+    stage.mapEntries.resize(variant.constants.size());
+    stage.data.resize(variant.constants.size());
+    for (size_t i = 0; i < variant.constants.size(); i++) {
+        stage.mapEntries[i].constantID = variant.constants[i].id;
+        stage.mapEntries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+        stage.mapEntries[i].size = sizeof(uint32_t);
+        stage.data[i] = variant.constants[i].value;
+    }
+
+    stage.specializationInfo.mapEntryCount = static_cast<uint32_t>(stage.mapEntries.size());
+    stage.specializationInfo.pMapEntries = stage.mapEntries.data();
+    stage.specializationInfo.dataSize = stage.data.size() * sizeof(uint32_t);
+    stage.specializationInfo.pData = stage.data.data();
+
+    stage.createInfo = {};
+    stage.createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage.createInfo.stage = variant.stage;
+    stage.createInfo.module = stage.module;
+    stage.createInfo.pName = "main";
+    //constants that are not given keep the default value written in the shader
+    stage.createInfo.pSpecializationInfo = variant.constants.empty() ? nullptr : &stage.specializationInfo;
+}
+
+void HelloTriangleApplication::destroyShaderStage(ShaderStage& stage) {
+    untrackObject(VK_OBJECT_TYPE_SHADER_MODULE, stage.module);
+    vkDestroyShaderModule(device, stage.module, nullptr);
+    stage = ShaderStage();
+}
+
+VkPipeline HelloTriangleApplication::buildComputePipeline(const std::string& variantName, VkPipelineLayout layout) {
+    ShaderStage stage;
+    createShaderStage(variantName, stage);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stage.createInfo;
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline " + variantName);
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE, pipeline, variantName);
+
+    destroyShaderStage(stage);
+
+    return pipeline;
+}
@@ -0,0 +1,615 @@
+#include "HelloTriangleApplication.h"
+
+#include <cmath>
+#include <limits>
+
+/*
+* Cascaded shadow maps
+*   The sun casts shadows through SHADOW_CASCADE_COUNT cascades, each one a layer of a single depth array, covering consecutive
+*   ranges of view depth. The cascades are split into two groups:
+*       1. dynamic cascades (near the camera): fit every frame on the GPU. A depth prepass draws the scene with nothing but the position
+*          stream, a compute pass reduces its depth buffer to the range of depth that is actually on screen and a second one splits that
+*          range between the cascades and fits an orthographic projection around each slice. Nothing is read back to the CPU.
+*       2. static cascades (from STATIC_CASCADE_SPLIT to the far plane): fixed splits, fit by the CPU to the bounding sphere of each slice
+*          and snapped to whole texels, so that their matrix only changes when the camera moves a texel or more. They are only rendered
+*          again when the matrix changes or when a dynamic object moves through them -- otherwise the layer from a previous frame is reused.
+*   The depth prepass is not only used for the fit: the main render pass loads it read only, so each pixel is shaded once (early-z).
+*/
+
+//light space z of the casters is rounded outward to steps of this size, so that small movements do not invalidate the cached cascades
+const float CASTER_RANGE_STEP = 0.5f;
+
+void HelloTriangleApplication::createDepthAttachment() {
+    //the cascade fit samples the depth buffer and the deferred lighting reads it as an input attachment
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (options.deferred) {
+        usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    }
+
+    //a layer per view, the fit only looks at the first: the main camera the cascades are fitted to
+    depthAttachment.format = findDepthFormat();
+    createImage(swapChainExtent.width, swapChainExtent.height, 1, depthAttachment.format, VK_IMAGE_TILING_OPTIMAL, usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthAttachment.image, depthAttachment.memory, {}, options.views);
+    depthAttachment.view = createImageView(depthAttachment.image, depthAttachment.format, VK_IMAGE_ASPECT_DEPTH_BIT);
+    depthArrayView = createImageView(depthAttachment.image, depthAttachment.format, VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY, options.views);
+}
+
+void HelloTriangleApplication::createShadowResources() {
+    /* Shadow Map */
+    //orthographic depth is linear, 16 bits are plenty and halve the bandwidth of the shadow passes
+    shadowMap.format = findSupportedFormat({ VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT }, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = SHADOW_CASCADE_COUNT;
+    imageInfo.format = shadowMap.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &shadowMap.image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map");
+    }
+    trackObject(VK_OBJECT_TYPE_IMAGE, shadowMap.image, "shadowMap.image");
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, shadowMap.image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &shadowMap.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate shadow map memory");
+    }
+    trackObject(VK_OBJECT_TYPE_DEVICE_MEMORY, shadowMap.memory, "shadowMap.memory");
+
+    vkBindImageMemory(device, shadowMap.image, shadowMap.memory, 0);
+
+    //lighting samples every cascade through one array view, each shadow pass renders into a view of its own layer
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = shadowMap.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = shadowMap.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = SHADOW_CASCADE_COUNT;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &shadowMap.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map view");
+    }
+    trackObject(VK_OBJECT_TYPE_IMAGE_VIEW, shadowMap.view, "shadowMap.view");
+
+    shadowCascadeViews.resize(SHADOW_CASCADE_COUNT);
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.subresourceRange.baseArrayLayer = i;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &shadowCascadeViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cascade view");
+        }
+        trackObject(VK_OBJECT_TYPE_IMAGE_VIEW, shadowCascadeViews[i], "shadowCascadeViews");
+    }
+
+    /* Sampler */
+    //hardware depth comparison: each tap returns the lit fraction of the 2x2 texels around it when linear filtering is supported
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, shadowMap.format, &formatProperties);
+    bool linearFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = linearFilter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    samplerInfo.minFilter = samplerInfo.magFilter;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    //everything outside of a cascade is lit
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow sampler");
+    }
+    trackObject(VK_OBJECT_TYPE_SAMPLER, shadowSampler, "shadowSampler");
+
+    /* Render Passes */
+    //both passes only have a depth attachment, which is cleared, written and left read only for whatever samples it afterwards
+    auto createDepthOnlyRenderPass = [this](VkFormat format, VkPipelineStageFlags readStages, VkAccessFlags readAccess, bool allViews, VkRenderPass& depthRenderPass) {
+        VkAttachmentDescription depthAttachmentDescription{};
+        depthAttachmentDescription.format = format;
+        depthAttachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        VkAttachmentReference depthRef = { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 0;
+        subpass.pDepthStencilAttachment = &depthRef;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+
+        //the previous frame may still be reading the attachment
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = readStages;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        //readers later in the frame wait for the depth to be written
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = readStages;
+        dependencies[1].dstAccessMask = readAccess;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &depthAttachmentDescription;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+        if (allViews) {
+            addRenderPassViews(renderPassInfo);
+        }
+
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &depthRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth only render pass");
+        }
+        trackObject(VK_OBJECT_TYPE_RENDER_PASS, depthRenderPass, "depthRenderPass");
+    };
+
+    //cascades are only sampled by the lighting
+    createDepthOnlyRenderPass(shadowMap.format, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false, shadowRenderPass);
+
+    //prepass depth is read by the fit, tested against by the main render pass and read as an input attachment by the deferred lighting
+    createDepthOnlyRenderPass(findDepthFormat(),
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+        true, depthPrepassRenderPass);
+
+    /* Framebuffers */
+    shadowFramebuffers.resize(SHADOW_CASCADE_COUNT);
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = shadowRenderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &shadowCascadeViews[i];
+        framebufferInfo.width = SHADOW_MAP_SIZE;
+        framebufferInfo.height = SHADOW_MAP_SIZE;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &shadowFramebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow framebuffer");
+        }
+        trackObject(VK_OBJECT_TYPE_FRAMEBUFFER, shadowFramebuffers[i], "shadowFramebuffers");
+    }
+
+    //nothing is cached yet, the first frame renders every cascade
+    cachedCascadeMatrices.assign(SHADOW_CASCADE_COUNT, glm::mat4(1.0f));
+    cascadeCached.assign(SHADOW_CASCADE_COUNT, false);
+    cascadeHasDynamic.assign(SHADOW_CASCADE_COUNT, false);
+    cascadesToRender.assign(SHADOW_CASCADE_COUNT, true);
+}
+
+void HelloTriangleApplication::destroyShadowResources() {
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, depthPrepassPipeline);
+    vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, shadowPipeline);
+    vkDestroyPipeline(device, shadowPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, depthBoundsPipeline);
+    vkDestroyPipeline(device, depthBoundsPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE, cascadeFitPipeline);
+    vkDestroyPipeline(device, cascadeFitPipeline, nullptr);
+    untrackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, depthOnlyPipelineLayout);
+    vkDestroyPipelineLayout(device, depthOnlyPipelineLayout, nullptr);
+
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        untrackObject(VK_OBJECT_TYPE_FRAMEBUFFER, shadowFramebuffers[i]);
+        vkDestroyFramebuffer(device, shadowFramebuffers[i], nullptr);
+        untrackObject(VK_OBJECT_TYPE_IMAGE_VIEW, shadowCascadeViews[i]);
+        vkDestroyImageView(device, shadowCascadeViews[i], nullptr);
+    }
+    untrackObject(VK_OBJECT_TYPE_RENDER_PASS, shadowRenderPass);
+    vkDestroyRenderPass(device, shadowRenderPass, nullptr);
+    untrackObject(VK_OBJECT_TYPE_RENDER_PASS, depthPrepassRenderPass);
+    vkDestroyRenderPass(device, depthPrepassRenderPass, nullptr);
+    untrackObject(VK_OBJECT_TYPE_SAMPLER, shadowSampler);
+    vkDestroySampler(device, shadowSampler, nullptr);
+    destroyAttachment(shadowMap);
+}
+
+void HelloTriangleApplication::createShadowPipelines() {
+    /* Pipeline Layout */
+    //same set as the main pipeline, plus the model matrix and cascade of each draw
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &depthOnlyPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth only pipeline layout");
+    }
+    trackObject(VK_OBJECT_TYPE_PIPELINE_LAYOUT, depthOnlyPipelineLayout, "depthOnlyPipelineLayout");
+
+    /* Depth Only Pipelines */
+    createReloadablePipeline(depthPrepassPipeline, { "depthOnly" }, [this]() { return buildDepthOnlyPipeline(false); });
+    createReloadablePipeline(shadowPipeline, { "depthOnly" }, [this]() { return buildDepthOnlyPipeline(true); });
+
+    /* Cascade Fit Pipelines */
+    VkPipelineLayout layout = depthOnlyPipelineLayout;
+    createReloadablePipeline(depthBoundsPipeline, { "shadowDepthBounds" }, [this, layout]() { return buildComputePipeline("shadowDepthBounds", layout); });
+    createReloadablePipeline(cascadeFitPipeline, { "shadowCascadeFit" }, [this, layout]() { return buildComputePipeline("shadowCascadeFit", layout); });
+}
+
+VkPipeline HelloTriangleApplication::buildDepthOnlyPipeline(bool shadowPass) {
+    //no fragment shader: the depth is all that is written
+    ShaderStage vertStage;
+    createShaderStage("depthOnly", vertStage);
+
+    //position stream only
+    auto bindingDescriptions = Vertex::getBindingDescriptions();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescriptions[0];
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions = &attributeDescriptions[0];
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    //viewport and scissor are set when recording: render scale for the prepass, the full layer for the cascades
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
+    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateInfo.dynamicStateCount = 2;
+    dynamicStateInfo.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &vertStage.createInfo;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
+    pipelineInfo.layout = depthOnlyPipelineLayout;
+    pipelineInfo.renderPass = depthPrepassRenderPass;
+    pipelineInfo.subpass = 0;
+
+    //casters are drawn from both sides so that thin geometry (the triangle) still casts, and biased against self shadowing
+    if (shadowPass) {
+        rasterizer.cullMode = VK_CULL_MODE_NONE;
+        rasterizer.depthBiasEnable = VK_TRUE;
+        rasterizer.depthBiasConstantFactor = 1.25f;
+        rasterizer.depthBiasClamp = 0.0f;
+        rasterizer.depthBiasSlopeFactor = 1.75f;
+        pipelineInfo.renderPass = shadowRenderPass;
+    }
+
+    VkPipeline pipeline;
+    if (linkGraphicsPipeline(pipelineInfo, &vertStage, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error(shadowPass ? "failed to create shadow pipeline" : "failed to create depth prepass pipeline");
+    }
+
+    destroyShaderStage(vertStage);
+
+    return pipeline;
+}
+
+void HelloTriangleApplication::createShadowBuffers() {
+    size_t imageCount = swapChainImages.size();
+
+    cascadeBuffers.resize(imageCount);
+    cascadeBuffersMemory.resize(imageCount);
+    cascadeBuffersMapped.resize(imageCount);
+    depthBoundsBuffers.resize(imageCount);
+    depthBoundsBuffersMemory.resize(imageCount);
+
+    VkDeviceSize cascadeBufferSize = sizeof(ShadowCascade) * SHADOW_CASCADE_COUNT;
+
+    for (size_t i = 0; i < imageCount; i++) {
+        //the CPU writes the static cascades every frame, the GPU writes the dynamic ones -- each only touches its own entries
+        createBuffer(cascadeBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, cascadeBuffers[i], cascadeBuffersMemory[i]);
+        vkMapMemory(device, cascadeBuffersMemory[i], 0, cascadeBufferSize, 0, &cascadeBuffersMapped[i]);
+
+        //min and max depth, reset with vkCmdFillBuffer every frame
+        createBuffer(sizeof(uint32_t) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthBoundsBuffers[i], depthBoundsBuffersMemory[i]);
+    }
+}
+
+void HelloTriangleApplication::updateShadowCascades(uint32_t imageIndex, UniformBufferObject& ubo) {
+    /* Light */
+    //the sun is infinitely far away, so one rotation serves every cascade and only the projections differ
+    glm::vec3 sunDirection = glm::normalize(SUN_DIRECTION);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), sunDirection, glm::vec3(0.0f, 0.0f, 1.0f));
+
+    ubo.lightView = lightView;
+    ubo.sunDirection = glm::vec4(sunDirection, 0.0f);
+    ubo.sunColor = glm::vec4(SUN_COLOR, 1.0f);
+
+    //without shadows the lighting never samples the shadow map, it is only cleared once so that it is in the layout its descriptor expects
+    if (!options.shadows) {
+        for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++) {
+            cascadesToRender[c] = !cascadeCached[c];
+            cascadeCached[c] = true;
+        }
+        return;
+    }
+
+    //light space z range of every caster, so that casters outside of a cascade slice but between it and the sun still cast into it
+    float minZ = std::numeric_limits<float>::max();
+    float maxZ = std::numeric_limits<float>::lowest();
+    for (const auto& object : sceneObjects) {
+        glm::vec4 center = lightView * object.model * glm::vec4(glm::vec3(object.boundingSphere), 1.0f);
+        minZ = std::min(minZ, center.z - object.boundingSphere.w);
+        maxZ = std::max(maxZ, center.z + object.boundingSphere.w);
+    }
+    minZ = std::floor(minZ / CASTER_RANGE_STEP) * CASTER_RANGE_STEP;
+    maxZ = std::ceil(maxZ / CASTER_RANGE_STEP) * CASTER_RANGE_STEP;
+
+    ubo.shadowParams = glm::vec4(STATIC_CASCADE_SPLIT, minZ, maxZ, 0.0f);
+
+    /* Static Cascades */
+    ShadowCascade* cascades = static_cast<ShadowCascade*>(cascadeBuffersMapped[imageIndex]);
+    uint32_t staticCount = SHADOW_CASCADE_COUNT - DYNAMIC_CASCADE_COUNT;
+
+    for (uint32_t c = DYNAMIC_CASCADE_COUNT; c < SHADOW_CASCADE_COUNT; c++) {
+        //logarithmic splits between the end of the dynamic cascades and the far plane
+        uint32_t s = c - DYNAMIC_CASCADE_COUNT;
+        float sliceNear = STATIC_CASCADE_SPLIT * std::pow(CAMERA_FAR / STATIC_CASCADE_SPLIT, static_cast<float>(s) / staticCount);
+        float sliceFar = STATIC_CASCADE_SPLIT * std::pow(CAMERA_FAR / STATIC_CASCADE_SPLIT, static_cast<float>(s + 1) / staticCount);
+
+        //corners of the slice in light space
+        std::array<glm::vec3, 8> corners;
+        for (int i = 0; i < 4; i++) {
+            glm::vec4 farCorner = ubo.invProj * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 1.0f, 1.0f);
+            glm::vec3 ray = glm::vec3(farCorner) / farCorner.w;
+            ray /= -ray.z; //view space point at a view depth of 1
+
+            corners[i * 2] = glm::vec3(lightView * ubo.invView * glm::vec4(ray * sliceNear, 1.0f));
+            corners[i * 2 + 1] = glm::vec3(lightView * ubo.invView * glm::vec4(ray * sliceFar, 1.0f));
+        }
+
+        //a sphere keeps the same size however the camera turns, and its radius is rounded up so that it does not flicker between values
+        glm::vec3 center(0.0f);
+        for (const auto& corner : corners) {
+            center += corner / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        //moving in whole texels keeps the texels of the shadow map on the same world positions, so the edges do not shimmer
+        float texel = 2.0f * radius / SHADOW_MAP_SIZE;
+        center.x = std::floor(center.x / texel) * texel;
+        center.y = std::floor(center.y / texel) * texel;
+
+        //light looks down -z in its view space
+        glm::mat4 projection = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius, -maxZ, -minZ);
+        glm::mat4 viewProj = projection * lightView;
+
+        cascades[c].viewProj = viewProj;
+        cascades[c].split = glm::vec4(sliceNear, sliceFar, texel, 0.0f);
+
+        //dynamic objects have to be rendered into each cascade they are in, and removed again once they have left it
+        bool hasDynamic = false;
+        for (const auto& object : sceneObjects) {
+            if (object.isStatic) {
+                continue;
+            }
+            glm::vec4 objectCenter = lightView * object.model * glm::vec4(glm::vec3(object.boundingSphere), 1.0f);
+            float reach = radius + object.boundingSphere.w;
+            if (std::abs(objectCenter.x - center.x) < reach && std::abs(objectCenter.y - center.y) < reach) {
+                hasDynamic = true;
+            }
+        }
+
+        cascadesToRender[c] = !cascadeCached[c] || viewProj != cachedCascadeMatrices[c] || hasDynamic || cascadeHasDynamic[c];
+        cachedCascadeMatrices[c] = viewProj;
+        cascadeHasDynamic[c] = hasDynamic;
+        cascadeCached[c] = true;
+    }
+
+    //dynamic cascades move with the depth buffer, they are rendered every frame
+    for (uint32_t c = 0; c < DYNAMIC_CASCADE_COUNT; c++) {
+        cascadesToRender[c] = true;
+    }
+}
+
+void HelloTriangleApplication::recordShadowPasses(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    /* Depth Prepass */
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = depthPrepassRenderPass;
+    renderPassInfo.framebuffer = depthPrepassFramebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = viewExtent;
+
+    VkClearValue depthClear{};
+    depthClear.depthStencil = { 1.0f, 0 };
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &depthClear;
+
+    beginPassStatistics(commandBuffer, imageIndex, ScenePass::DepthPrepass);
+    beginScenePass(commandBuffer, ScenePass::DepthPrepass, renderPassInfo, 0);
+
+    VkViewport viewport{};
+    viewport.width = (float)viewExtent.width;
+    viewport.height = (float)viewExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = viewExtent;
+
+    bindScenePass(commandBuffer, ScenePass::DepthPrepass, viewport, scissor);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnlyPipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+    recordSceneDraws(commandBuffer, depthOnlyPipelineLayout, true, CAMERA_VIEW);
+
+    endScenePass(commandBuffer, ScenePass::DepthPrepass, 0);
+    endPassStatistics(commandBuffer, imageIndex, ScenePass::DepthPrepass);
+
+    /* Cascade Fit */
+    //the cascades are only read by the lighting when it receives shadows
+    if (options.shadows) {
+        recordCascadeFit(commandBuffer, imageIndex);
+    }
+
+    /* Shadow Passes */
+    //cached cascades are skipped, their layer still holds what an earlier frame rendered
+    renderPassInfo.renderPass = shadowRenderPass;
+    renderPassInfo.renderArea.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+
+    viewport.width = (float)SHADOW_MAP_SIZE;
+    viewport.height = (float)SHADOW_MAP_SIZE;
+    scissor.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+
+    beginPassStatistics(commandBuffer, imageIndex, ScenePass::Shadow);
+    for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++) {
+        if (!cascadesToRender[c]) {
+            continue;
+        }
+
+        renderPassInfo.framebuffer = shadowFramebuffers[c];
+        beginScenePass(commandBuffer, ScenePass::Shadow, renderPassInfo, c);
+        bindScenePass(commandBuffer, ScenePass::Shadow, viewport, scissor);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthOnlyPipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+        recordSceneDraws(commandBuffer, depthOnlyPipelineLayout, true, c);
+        endScenePass(commandBuffer, ScenePass::Shadow, c);
+    }
+    endPassStatistics(commandBuffer, imageIndex, ScenePass::Shadow);
+}
+
+void HelloTriangleApplication::recordSceneDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, bool positionsOnly, uint32_t cascade) {
+    //both streams live in the same buffer, the attributes start right after the positions
+    VkBuffer vertexBuffers[] = { vertexBuffer, vertexBuffer };
+    VkDeviceSize offsets[] = { 0, vertexAttributeOffset };
+    vkCmdBindVertexBuffers(commandBuffer, 0, positionsOnly ? 1 : 2, vertexBuffers, offsets);
+
+    for (const auto& object : sceneObjects) {
+        DrawPushConstants pushConstants{};
+        pushConstants.model = object.model;
+        pushConstants.cascade = cascade;
+        vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+        vkCmdDraw(commandBuffer, object.vertexCount, 1, object.firstVertex, 0);
+    }
+}
+
+void HelloTriangleApplication::recordCascadeFit(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    //empty range: min starts at the largest value and max at the smallest
+    vkCmdFillBuffer(commandBuffer, depthBoundsBuffers[imageIndex], 0, sizeof(uint32_t), 0xFFFFFFFF);
+    vkCmdFillBuffer(commandBuffer, depthBoundsBuffers[imageIndex], sizeof(uint32_t), sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, depthOnlyPipelineLayout, 0, 1, &descriptorSets[imageIndex], 0, nullptr);
+
+    //one invocation per rendered pixel
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, depthBoundsPipeline);
+    vkCmdDispatch(commandBuffer, (viewExtent.width + 15) / 16, (viewExtent.height + 15) / 16, 1);
+
+    VkMemoryBarrier boundsBarrier{};
+    boundsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    boundsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    boundsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &boundsBarrier, 0, nullptr, 0, nullptr);
+
+    //one invocation per dynamic cascade
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cascadeFitPipeline);
+    vkCmdDispatch(commandBuffer, DYNAMIC_CASCADE_COUNT, 1, 1);
+
+    //cascades are read by the shadow passes to render and by the lighting to sample
+    VkMemoryBarrier fitBarrier{};
+    fitBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fitBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    fitBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &fitBarrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,133 @@
+#include "HelloTriangleApplication.h"
+
+/*
+* Stress scene
+*   Generated replacement for the built-in scene, for measuring how the renderer scales: --stress-meshes meshes, each drawn as
+*   --stress-instances objects scattered over the floor, with a share of them (--stress-dynamic) moving every frame.
+*   Meshes are boxes and spheres tessellated so that their triangles are about a size drawn per mesh, log-uniformly between the
+*   bounds of --stress-triangle-size: small triangles stress the rasterizer, big ones the fragment shaders.
+*   Colors come from a palette of --stress-materials entries. Everything is drawn from one generator seeded with --stress-seed,
+*   so a seed always builds the same scene, which is uploaded like any other through createVertexBuffer.
+*/
+
+//quads along an edge of a box face, bounds the vertices of a single mesh when the triangles are tiny
+const uint32_t MAX_STRESS_SUBDIVISIONS = 32;
+
+void HelloTriangleApplication::createStressScene() {
+    const StressSceneOptions& stress = options.stress;
+    std::mt19937 generator(stress.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    vertices.clear();
+    sceneObjects.clear();
+    stressMotions.clear();
+
+    /* Floor */
+    //same floor as the built-in scene, the instances stand on it
+    glm::vec3 floorCorners[] = { {-4.0f, -0.5f, 1.5f}, {4.0f, -0.5f, 1.5f}, {4.0f, -0.5f, -8.5f}, {-4.0f, -0.5f, -8.5f} };
+    addSceneQuad(floorCorners, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.6f));
+    addSceneObject(0, true);
+
+    /* Materials */
+    std::vector<glm::vec3> palette(stress.materials);
+    for (auto& color : palette) {
+        color = glm::vec3(0.2f + 0.8f * unit(generator), 0.2f + 0.8f * unit(generator), 0.2f + 0.8f * unit(generator));
+    }
+
+    /* Meshes */
+    //a box whose faces are split into a grid of quads, pushed out onto a sphere for the round ones; centered on the origin of the mesh
+    std::vector<SceneObject> meshes;
+    float logMinSize = std::log(stress.minTriangleSize);
+    float logMaxSize = std::log(stress.maxTriangleSize);
+
+    for (uint32_t mesh = 0; mesh < stress.meshes; mesh++) {
+        glm::vec3 halfExtent(0.1f + 0.25f * unit(generator), 0.1f + 0.25f * unit(generator), 0.1f + 0.25f * unit(generator));
+        bool round = unit(generator) < 0.5f;
+        float triangleSize = std::exp(logMinSize + (logMaxSize - logMinSize) * unit(generator));
+        glm::vec3 color = palette[static_cast<size_t>(unit(generator) * static_cast<float>(palette.size())) % palette.size()];
+
+        float longestEdge = 2.0f * std::max({ halfExtent.x, halfExtent.y, halfExtent.z });
+        uint32_t subdivisions = std::clamp(static_cast<uint32_t>(std::ceil(longestEdge / triangleSize)), 1u, MAX_STRESS_SUBDIVISIONS);
+
+        //point of the face at grid coordinates (u, v) in [0, 1]
+        auto facePoint = [&](int axis, int side, float u, float v) {
+            glm::vec3 point;
+            point[axis] = side ? 1.0f : -1.0f;
+            point[(axis + 1) % 3] = 2.0f * u - 1.0f;
+            point[(axis + 2) % 3] = 2.0f * v - 1.0f;
+            if (round) {
+                point = glm::normalize(point);
+            }
+            return point * halfExtent;
+        };
+
+        uint32_t first = static_cast<uint32_t>(vertices.size());
+        for (int axis = 0; axis < 3; axis++) {
+            for (int side = 0; side < 2; side++) {
+                for (uint32_t i = 0; i < subdivisions; i++) {
+                    for (uint32_t j = 0; j < subdivisions; j++) {
+                        float u0 = static_cast<float>(i) / subdivisions;
+                        float u1 = static_cast<float>(i + 1) / subdivisions;
+                        float v0 = static_cast<float>(j) / subdivisions;
+                        float v1 = static_cast<float>(j + 1) / subdivisions;
+
+                        glm::vec3 corners[4] = { facePoint(axis, side, u0, v0), facePoint(axis, side, u1, v0),
+                            facePoint(axis, side, u1, v1), facePoint(axis, side, u0, v1) };
+
+                        //flat shaded: a box face keeps its axis, a sphere quad faces away from the center
+                        glm::vec3 normal(0.0f);
+                        normal[axis] = side ? 1.0f : -1.0f;
+                        if (round) {
+                            normal = glm::normalize(corners[0] + corners[1] + corners[2] + corners[3]);
+                        }
+
+                        addSceneQuad(corners, normal, color);
+                    }
+                }
+            }
+        }
+
+        //not drawn itself, its instances are
+        addSceneObject(first, true);
+        meshes.push_back(sceneObjects.back());
+        sceneObjects.pop_back();
+    }
+
+    /* Instances */
+    //models only rotate and translate: the bounding sphere of the mesh stays valid for every instance
+    for (const auto& mesh : meshes) {
+        for (uint32_t instance = 0; instance < stress.instances; instance++) {
+            StressMotion motion{};
+            motion.position = glm::vec3(-3.5f + 7.0f * unit(generator), -0.5f + mesh.boundingSphere.w + 0.5f * unit(generator), -8.0f + 9.0f * unit(generator));
+            motion.angle = glm::radians(360.0f) * unit(generator);
+            motion.speed = 0.5f + 1.5f * unit(generator);
+            motion.phase = glm::radians(360.0f) * unit(generator);
+
+            SceneObject object = mesh;
+            object.isStatic = unit(generator) >= stress.dynamicFraction;
+            object.model = glm::rotate(glm::translate(glm::mat4(1.0f), motion.position), motion.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+
+            if (!object.isStatic) {
+                motion.object = static_cast<uint32_t>(sceneObjects.size());
+                stressMotions.push_back(motion);
+            }
+            sceneObjects.push_back(object);
+        }
+    }
+
+    size_t drawnVertices = 0;
+    for (const auto& object : sceneObjects) {
+        drawnVertices += object.vertexCount;
+    }
+    std::cout << "stress scene: " << stress.meshes << " meshes x " << stress.instances << " instances, " << stressMotions.size()
+        << " dynamic, " << vertices.size() << " vertices uploaded, " << drawnVertices / 3 << " triangles drawn per pass" << std::endl;
+}
+
+void HelloTriangleApplication::updateStressScene(float time) {
+    //dynamic instances spin around their vertical axis and bob up and down
+    for (const auto& motion : stressMotions) {
+        glm::vec3 position = motion.position + glm::vec3(0.0f, 0.1f * std::sin(time * motion.speed + motion.phase), 0.0f);
+        float angle = motion.angle + time * motion.speed;
+        sceneObjects[motion.object].model = glm::rotate(glm::translate(glm::mat4(1.0f), position), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
@@ -0,0 +1,197 @@
+#include "HelloTriangleApplication.h"
+
+#include <iomanip>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+/*
+* Tracing
+*   Timelines of the CPU threads and the GPU queues, for spotting the bubbles between copies, submits and presents that averages hide.
+*       - CPU: a TraceZone records the time its scope took into a ring of the calling thread. Every thread has its own ring and is the
+*         only one to write it, so recording is a pair of clock reads and a store, without locks.
+*       - GPU: the timestamps the frame already writes for the dynamic resolution are read back a few frames later and moved onto the
+*         CPU clock with VK_EXT_calibrated_timestamps, which samples both clocks at the same moment.
+*   The trace is written as Chrome trace JSON when F12 is pressed and at exit. Perfetto opens the same file.
+*/
+
+thread_local HelloTriangleApplication::TraceBuffer* HelloTriangleApplication::threadTraceBuffer = nullptr;
+
+//events this close to being overwritten are left out of an export, as the thread recording them may be writing over them
+const uint64_t TRACE_EXPORT_MARGIN = 1024;
+
+HelloTriangleApplication::TraceZone::TraceZone(HelloTriangleApplication& app, const char* name) : app(app), name(name), start(0) {
+    if (app.tracing) {
+        start = traceTime();
+    }
+}
+
+HelloTriangleApplication::TraceZone::~TraceZone() {
+    if (app.tracing && threadTraceBuffer != nullptr) {
+        app.recordTraceEvent(threadTraceBuffer, name, start, traceTime());
+    }
+}
+
+int64_t HelloTriangleApplication::traceTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// <summary>
+/// Value of the host time domain in nanoseconds of std::chrono::steady_clock, which reads the same clock: 
+/// the performance counter on windows, CLOCK_MONOTONIC elsewhere
+/// </summary>
+static int64_t hostTimestampToTraceTime(uint64_t timestamp) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+    return static_cast<int64_t>((timestamp / ticksPerSecond) * 1000000000ull + (timestamp % ticksPerSecond) * 1000000000ull / ticksPerSecond);
+#else
+    return static_cast<int64_t>(timestamp);
+#endif
+}
+
+void HelloTriangleApplication::checkCalibratedTimestampSupport(std::vector<const char*>& extensions) {
+    calibratedTimestamps = false;
+    if (options.traceFile.empty() || !isDeviceExtensionAvailable(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+        return;
+    }
+
+#ifdef _WIN32
+    hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+    hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+    auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+    if (getTimeDomains == nullptr) {
+        return;
+    }
+
+    uint32_t domainCount = 0;
+    getTimeDomains(physicalDevice, &domainCount, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domainCount);
+    getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+    bool deviceDomain = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+    bool hostDomain = std::find(domains.begin(), domains.end(), hostTimeDomain) != domains.end();
+    if (deviceDomain && hostDomain) {
+        calibratedTimestamps = true;
+        extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+}
+
+void HelloTriangleApplication::createTracing() {
+    if (options.traceFile.empty()) {
+        return;
+    }
+
+    traceStart = traceTime();
+    tracing = true;
+    setTraceThreadName("main");
+
+    if (calibratedTimestamps) {
+        getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+        calibratedTimestamps = (getCalibratedTimestamps != nullptr);
+    }
+
+    if (calibratedTimestamps) {
+        graphicsQueueTrace = createTraceBuffer("GPU graphics queue");
+        computeQueueTrace = createTraceBuffer("GPU compute queue");
+    }
+    else {
+        std::cout << "VK_EXT_calibrated_timestamps is not supported, the trace only holds the CPU timelines \n";
+    }
+}
+
+void HelloTriangleApplication::setTraceThreadName(const std::string& name) {
+    if (tracing && threadTraceBuffer == nullptr) {
+        threadTraceBuffer = createTraceBuffer(name);
+    }
+}
+
+HelloTriangleApplication::TraceBuffer* HelloTriangleApplication::createTraceBuffer(const std::string& name) {
+    auto buffer = std::make_unique<TraceBuffer>();
+    buffer->name = name;
+    buffer->events.resize(TRACE_BUFFER_EVENTS);
+
+    std::lock_guard<std::mutex> lock(traceBufferMutex);
+    buffer->id = static_cast<uint32_t>(traceBuffers.size());
+    traceBuffers.push_back(std::move(buffer));
+    return traceBuffers.back().get();
+}
+
+void HelloTriangleApplication::recordTraceEvent(TraceBuffer* buffer, const char* name, int64_t start, int64_t end) {
+    //only this thread writes the ring, the release makes the event visible to an export before the new head
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head % buffer->events.size()] = { name, start, end };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void HelloTriangleApplication::traceGpuTimestamps(const std::array<uint64_t, 4>& timestamps) {
+    if (!calibratedTimestamps) {
+        return;
+    }
+
+    //sampled again for every frame, so that the two clocks drifting apart does not add up over a long trace
+    VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = hostTimeDomain;
+
+    uint64_t now[2];
+    uint64_t maxDeviation;
+    if (getCalibratedTimestamps(device, 2, timestampInfos, now, &maxDeviation) != VK_SUCCESS) {
+        return;
+    }
+
+    int64_t hostNow = hostTimestampToTraceTime(now[1]);
+    auto toTraceTime = [&](uint64_t timestamp, uint64_t mask) {
+        uint64_t ticksAgo = (now[0] - timestamp) & mask;
+        return hostNow - static_cast<int64_t>(static_cast<double>(ticksAgo) * timestampPeriod);
+    };
+
+    recordTraceEvent(graphicsQueueTrace, "scene", toTraceTime(timestamps[0], graphicsTimestampMask), toTraceTime(timestamps[1], graphicsTimestampMask));
+    if (computeTimestampMask != 0) {
+        recordTraceEvent(computeQueueTrace, "post processing", toTraceTime(timestamps[2], computeTimestampMask), toTraceTime(timestamps[3], computeTimestampMask));
+    }
+}
+
+void HelloTriangleApplication::exportTrace() {
+    TraceZone zone(*this, "exportTrace");
+
+    std::ofstream file(options.traceFile);
+    if (!file) {
+        std::cerr << "failed to open trace file " << options.traceFile << std::endl;
+        return;
+    }
+
+    //chrome trace times are microseconds
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(traceBufferMutex);
+    for (const auto& buffer : traceBuffers) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+        first = false;
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t capacity = buffer->events.size();
+        uint64_t begin = (head > capacity - TRACE_EXPORT_MARGIN) ? head - (capacity - TRACE_EXPORT_MARGIN) : 0;
+
+        for (uint64_t i = begin; i < head; i++) {
+            const TraceEvent& event = buffer->events[i % capacity];
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"ts\":" << (event.start - traceStart) / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    std::cout << "trace written to " << options.traceFile << std::endl;
+}
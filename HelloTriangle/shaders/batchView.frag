@@ -0,0 +1,15 @@
+#version 450
+
+//the batch views are lit by a fixed sun and a constant ambient term, without shadows or point lights
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+const vec3 SUN_DIRECTION = normalize(vec3(-0.4, -1.0, -0.3));   //direction the sunlight travels in
+const float AMBIENT = 0.25;
+
+void main() {
+    float diffuse = max(dot(normalize(fragNormal), -SUN_DIRECTION), 0.0);
+    outColor = vec4(fragColor * (AMBIENT + diffuse), 1.0);
+}
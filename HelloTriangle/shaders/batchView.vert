@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_shader_viewport_layer_array : require
+
+//vertex shader of the batch views: every instance is a view, drawn into its own viewport of a layer of the batch target
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+
+//views per layer, a BATCH_GRID x BATCH_GRID grid
+layout(constant_id = 0) const uint BATCH_GRID = 4;
+
+layout(std430, set = 0, binding = 0) readonly buffer BatchCameras {
+    mat4 viewProjections[];
+};
+
+//must match DrawPushConstants in HelloTriangleApplication.h
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint cascade;   //unused here
+} pc;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+void main() {
+    uint view = uint(gl_InstanceIndex);
+    uint viewsPerLayer = BATCH_GRID * BATCH_GRID;
+
+    gl_Position = viewProjections[view] * (pc.model * vec4(inPosition, 1.0));
+    gl_ViewportIndex = int(view % viewsPerLayer);
+    gl_Layer = int(view / viewsPerLayer);
+
+    fragColor = inColor;
+    fragNormal = mat3(pc.model) * inNormal;
+}
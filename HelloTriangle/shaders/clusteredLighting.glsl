@@ -0,0 +1,91 @@
+//clustered light loop shared by the forward and the deferred lighting fragment shaders
+#include "common.glsl"
+#include "shadows.glsl"
+
+//feature toggles, constant_id 0 is left to the shader which includes this file
+//sun shadows can be turned off, the sun then lights every surface facing it
+layout(constant_id = 1) const bool RECEIVE_SHADOWS = true;
+//must match DebugView in HelloTriangleApplication.h: 0 none, 1 normals, 2 cascades, 3 light count
+layout(constant_id = 2) const uint DEBUG_VIEW = 0;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+};
+
+//(offset, count) into the light index list for every cluster, written by clusterLights.comp
+layout(std430, set = 0, binding = 2) readonly buffer LightGrid {
+    uvec2 lightGrid[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer LightIndexList {
+    uint lightIndices[];
+};
+
+const vec3 ambient = vec3(0.05);
+
+//light counts at or above this show as the hottest color of the light count view
+const float DEBUG_MAX_LIGHTS = 16.0;
+
+//cluster a fragment belongs to -- slices are spaced exponentially in depth
+uint findCluster(float viewDepth, vec2 fragCoord) {
+    uvec3 grid = ubo.clusterGrid.xyz;
+    float near = ubo.screenSize.z;
+    float far = ubo.screenSize.w;
+
+    uint slice = uint(clamp(log(viewDepth / near) / log(far / near) * float(grid.z), 0.0, float(grid.z - 1u)));
+    uvec2 tile = uvec2(clamp(fragCoord / ubo.screenSize.xy * vec2(grid.xy), vec2(0.0), vec2(grid.xy - 1u)));
+    return tile.x + tile.y * grid.x + slice * grid.x * grid.y;
+}
+
+//light arriving at a surface from the sun and from every light in the cluster that contains it
+vec3 shadeClustered(vec3 worldPos, vec3 normal, float viewDepth, vec2 fragCoord) {
+    uint clusterIndex = findCluster(viewDepth, fragCoord);
+
+    vec3 lighting = ambient;
+
+    //sunlight, unless one of the shadow cascades sees something between the surface and the sun
+    float sunAmount = max(dot(normal, -ubo.sunDirection.xyz), 0.0);
+    if (sunAmount > 0.0) {
+        float shadow = RECEIVE_SHADOWS ? sampleShadow(worldPos, normal, viewDepth) : 1.0;
+        lighting += ubo.sunColor.rgb * sunAmount * shadow;
+    }
+
+    //only visit the lights that were binned into this cluster
+    uvec2 range = lightGrid[clusterIndex];
+    for (uint i = 0; i < range.y; i++) {
+        PointLight light = lights[lightIndices[range.x + i]];
+
+        vec3 toLight = light.positionRadius.xyz - worldPos;
+        float dist = length(toLight);
+        float radius = light.positionRadius.w;
+
+        //smooth falloff which reaches 0 at the radius of the light, so the light never affects a cluster it was not binned into
+        float falloff = clamp(1.0 - pow(dist / radius, 4.0), 0.0, 1.0);
+        falloff = (falloff * falloff) / (dist * dist + 1.0);
+
+        lighting += light.color.rgb * light.color.a * falloff * max(dot(normal, toLight / dist), 0.0);
+    }
+
+    return lighting;
+}
+
+//color of a surface as it is written to the HDR target, or one of the debug views in its place
+vec3 shadeSurface(vec3 albedo, vec3 worldPos, vec3 normal, float viewDepth, vec2 fragCoord) {
+    if (DEBUG_VIEW == 1) {
+        return normal * 0.5 + 0.5;
+    }
+    if (DEBUG_VIEW == 2) {
+        //one tint per cascade, surfaces past the last one stay grey
+        const vec3 tints[SHADOW_CASCADE_COUNT] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        uint cascade = findCascade(viewDepth);
+        vec3 tint = (cascade < SHADOW_CASCADE_COUNT) ? tints[cascade] : vec3(0.5);
+        return tint * shadeClustered(worldPos, normal, viewDepth, fragCoord);
+    }
+    if (DEBUG_VIEW == 3) {
+        //black for no lights, through red to yellow at DEBUG_MAX_LIGHTS
+        float heat = float(lightGrid[findCluster(viewDepth, fragCoord)].y) / DEBUG_MAX_LIGHTS;
+        return vec3(clamp(heat * 2.0, 0.0, 1.0), clamp(heat * 2.0 - 1.0, 0.0, 1.0), 0.0);
+    }
+
+    return albedo * shadeClustered(worldPos, normal, viewDepth, fragCoord);
+}
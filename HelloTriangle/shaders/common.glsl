@@ -0,0 +1,26 @@
+//declarations shared by every shader which reads the camera or the lights
+//must match UniformBufferObject, PointLight and ShadowCascade in HelloTriangleApplication.h
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 invProj;
+    mat4 invView;
+    vec4 screenSize;    //xy: framebuffer size, z: near plane, w: far plane
+    uvec4 clusterGrid;  //xyz: cluster grid dimensions, w: light count
+    mat4 lightView;     //world to light space of the sun
+    vec4 sunDirection;  //xyz: direction the sunlight travels in
+    vec4 sunColor;
+    vec4 shadowParams;  //x: view depth where the static cascades start, y/z: light space z range of all casters
+    mat4 viewProjections[4];    //MAX_VIEWS: world to clip space of each multiview view, the first one is proj * view
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+struct ShadowCascade {
+    mat4 viewProj;
+    vec4 split;         //x: near view depth, y: far view depth, z: world size of a shadow map texel
+};
@@ -0,0 +1,24 @@
+@echo off
+rem compile all shaders to SPIR-V, output is placed next to the project so that it is found from the working directory
+rem -O runs the same spirv-opt performance passes as the runtime compiler
+cd /d %~dp0
+
+%VULKAN_SDK%/Bin/glslc.exe scene.vert -O -o ../vertShader.spv
+%VULKAN_SDK%/Bin/glslc.exe scene.frag -O -o ../fragShader.spv
+%VULKAN_SDK%/Bin/glslc.exe clusterLights.comp -O -o ../clusterLights.spv
+%VULKAN_SDK%/Bin/glslc.exe fullscreen.vert -O -o ../fullscreen.spv
+%VULKAN_SDK%/Bin/glslc.exe deferredLighting.frag -O -o ../deferredLighting.spv
+%VULKAN_SDK%/Bin/glslc.exe bloomDownsample.comp -O -o ../bloomDownsample.spv
+%VULKAN_SDK%/Bin/glslc.exe bloomUpsample.comp -O -o ../bloomUpsample.spv
+%VULKAN_SDK%/Bin/glslc.exe postComposite.comp -O -o ../postComposite.spv
+%VULKAN_SDK%/Bin/glslc.exe upscale.comp -O -o ../upscale.spv
+%VULKAN_SDK%/Bin/glslc.exe depthOnly.vert -O -o ../depthOnly.spv
+%VULKAN_SDK%/Bin/glslc.exe shadowDepthBounds.comp -O -o ../shadowDepthBounds.spv
+%VULKAN_SDK%/Bin/glslc.exe shadowCascadeFit.comp -O -o ../shadowCascadeFit.spv
+%VULKAN_SDK%/Bin/glslc.exe hud.comp -O -o ../hud.spv
+%VULKAN_SDK%/Bin/glslc.exe sceneViews.vert -O -o ../sceneViews.spv
+%VULKAN_SDK%/Bin/glslc.exe depthViews.vert -O -o ../depthViews.spv
+%VULKAN_SDK%/Bin/glslc.exe batchView.vert -O -o ../batchView.spv
+%VULKAN_SDK%/Bin/glslc.exe batchView.frag -O -o ../batchShade.spv
+
+pause
@@ -0,0 +1,32 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clusteredLighting.glsl"
+
+//G-buffer written by the previous subpass, only the texel of the current pixel can be read
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inDepth;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float depth = subpassLoad(inDepth).r;
+
+    //nothing was drawn to this pixel
+    if (depth >= 1.0) {
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    //rebuild the position of the surface from the depth buffer
+    vec2 ndc = gl_FragCoord.xy / ubo.screenSize.xy * 2.0 - 1.0;
+    vec4 viewPos = ubo.invProj * vec4(ndc, depth, 1.0);
+    viewPos /= viewPos.w;
+    vec3 worldPos = (ubo.invView * viewPos).xyz;
+
+    vec3 albedo = subpassLoad(inAlbedo).rgb;
+    vec3 normal = normalize(subpassLoad(inNormal).xyz);
+
+    outColor = vec4(shadeSurface(albedo, worldPos, normal, -viewPos.z, gl_FragCoord.xy), 1.0);
+}
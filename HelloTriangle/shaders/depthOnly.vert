@@ -0,0 +1,34 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+//vertex shader of the depth prepass and the shadow passes -- reads nothing but the position stream
+#include "common.glsl"
+
+layout(location = 0) in vec3 inPosition;
+
+layout(std430, set = 0, binding = 6) readonly buffer CascadeBuffer {
+    ShadowCascade cascades[];
+};
+
+//must match DrawPushConstants in HelloTriangleApplication.h
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint cascade;   //cascade to render into, or CAMERA_VIEW for the depth prepass
+} pc;
+
+const uint CAMERA_VIEW = 0xFFFFFFFFu;
+
+//must produce the same depth as scene.vert
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+
+    if (pc.cascade == CAMERA_VIEW) {
+        vec4 viewPos = ubo.view * worldPos;
+        gl_Position = ubo.proj * viewPos;
+    }
+    else {
+        gl_Position = cascades[pc.cascade].viewProj * worldPos;
+    }
+}
@@ -0,0 +1,34 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_multiview : require
+
+//depthOnly.vert for a multiview depth prepass, the shadow passes draw a single view with it
+#include "common.glsl"
+
+layout(location = 0) in vec3 inPosition;
+
+layout(std430, set = 0, binding = 6) readonly buffer CascadeBuffer {
+    ShadowCascade cascades[];
+};
+
+//must match DrawPushConstants in HelloTriangleApplication.h
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint cascade;   //cascade to render into, or CAMERA_VIEW for the depth prepass
+} pc;
+
+const uint CAMERA_VIEW = 0xFFFFFFFFu;
+
+//must produce the same depth as sceneViews.vert
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+
+    if (pc.cascade == CAMERA_VIEW) {
+        gl_Position = ubo.viewProjections[gl_ViewIndex] * worldPos;
+    }
+    else {
+        gl_Position = cascades[pc.cascade].viewProj * worldPos;
+    }
+}
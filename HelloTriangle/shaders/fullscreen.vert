@@ -0,0 +1,8 @@
+#version 450
+
+//single triangle which covers the whole screen, generated without a vertex buffer
+//(0, 0), (2, 0), (0, 2) in UV space, the part outside of the screen is clipped
+void main() {
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,38 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "clusteredLighting.glsl"
+
+//forward: light the surface right away
+//G-buffer subpass of the deferred path: only store the surface, lighting is done in the next subpass
+layout(constant_id = 0) const bool OUTPUT_GBUFFER = false;
+//several views share the light clusters of the first one: the cluster of a surface is found where it lands in that view
+layout(constant_id = 3) const bool SHARED_CLUSTERS = false;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragWorldPos;
+layout(location = 2) in float fragViewDepth;
+layout(location = 3) in vec3 fragNormal;
+
+//HDR color when forward, albedo when filling the G-buffer
+layout(location = 0) out vec4 outColor;
+//world space normal, only written to the G-buffer
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+    //interpolation shortens the normal, unless the whole face shares the same one
+    vec3 normal = normalize(fragNormal);
+
+    if (OUTPUT_GBUFFER) {
+        outColor = vec4(fragColor, 1.0);
+        outNormal = vec4(normal, 0.0);
+    }
+    else {
+        vec2 clusterCoord = gl_FragCoord.xy;
+        if (SHARED_CLUSTERS) {
+            vec4 clip = ubo.proj * ubo.view * vec4(fragWorldPos, 1.0);
+            clusterCoord = (clip.xy / clip.w * 0.5 + 0.5) * ubo.screenSize.xy;
+        }
+        outColor = vec4(shadeSurface(fragColor, fragWorldPos, normal, fragViewDepth, clusterCoord), 1.0);
+    }
+}
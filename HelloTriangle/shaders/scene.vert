@@ -0,0 +1,36 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "common.glsl"
+
+//vertex attributes specified per vertex
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+
+//must match DrawPushConstants in HelloTriangleApplication.h
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint cascade;   //unused here, only the depth only passes render into cascades
+} pc;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragWorldPos;
+//distance from the camera, used to find the depth slice of the cluster grid
+layout(location = 2) out float fragViewDepth;
+layout(location = 3) out vec3 fragNormal;
+
+//depth has to come out bit for bit the same as in depthOnly.vert, the main pass tests against the prepass depth with LESS_OR_EQUAL
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+    vec4 viewPos = ubo.view * worldPos;
+
+    gl_Position = ubo.proj * viewPos;
+    fragColor = inColor;
+    fragWorldPos = worldPos.xyz;
+    fragViewDepth = -viewPos.z;
+    //objects are only rotated and moved, so the model matrix keeps normals perpendicular
+    fragNormal = mat3(pc.model) * inNormal;
+}
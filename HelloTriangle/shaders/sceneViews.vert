@@ -0,0 +1,36 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_multiview : require
+
+//scene.vert for a multiview pass: the camera of the view being drawn comes from gl_ViewIndex
+//kept apart from scene.vert so that a single view does not need the multiview feature
+#include "common.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+
+//must match DrawPushConstants in HelloTriangleApplication.h
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint cascade;   //unused here, only the depth only passes render into cascades
+} pc;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragWorldPos;
+//distance from the main camera, the clusters and the shadow cascades are those of the first view
+layout(location = 2) out float fragViewDepth;
+layout(location = 3) out vec3 fragNormal;
+
+//depth has to come out bit for bit the same as in depthViews.vert
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+
+    gl_Position = ubo.viewProjections[gl_ViewIndex] * worldPos;
+    fragColor = inColor;
+    fragWorldPos = worldPos.xyz;
+    fragViewDepth = -(ubo.view * worldPos).z;
+    fragNormal = mat3(pc.model) * inNormal;
+}
@@ -0,0 +1,44 @@
+//sun shadows shared by the forward and the deferred lighting, expects common.glsl to be included first
+
+layout(set = 0, binding = 5) uniform sampler2DArrayShadow shadowMap;
+
+layout(std430, set = 0, binding = 6) readonly buffer CascadeBuffer {
+    ShadowCascade cascades[];
+};
+
+//must match SHADOW_CASCADE_COUNT in HelloTriangleApplication.h
+const uint SHADOW_CASCADE_COUNT = 4;
+
+//cascade covering a view depth, SHADOW_CASCADE_COUNT when it lies past the last one
+uint findCascade(float viewDepth) {
+    //cascades are ordered by depth, the first one which reaches past the surface covers it
+    uint cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT && viewDepth > cascades[cascade].split.y) {
+        cascade++;
+    }
+    return cascade;
+}
+
+//fraction of the sunlight that reaches a surface: 0 fully shadowed, 1 fully lit
+float sampleShadow(vec3 worldPos, vec3 normal, float viewDepth) {
+    uint cascade = findCascade(viewDepth);
+    if (cascade == SHADOW_CASCADE_COUNT) {
+        return 1.0;
+    }
+
+    //move the lookup off the surface by a little over a texel, so that the surface does not shadow itself (acne)
+    //texels get larger with every cascade, so the offset follows the texel size rather than being a constant
+    vec3 offsetPos = worldPos + normal * cascades[cascade].split.z * 1.5;
+    vec4 shadowPos = cascades[cascade].viewProj * vec4(offsetPos, 1.0);
+    vec2 uv = shadowPos.xy * 0.5 + 0.5;
+
+    //2x2 taps half a texel apart, each tap is itself a bilinear 2x2 comparison -- softens the edges over a 3x3 texel area
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = vec2((i & 1) != 0 ? 0.5 : -0.5, (i & 2) != 0 ? 0.5 : -0.5) * texelSize;
+        lit += texture(shadowMap, vec4(uv + offset, float(cascade), shadowPos.z));
+    }
+
+    return lit * 0.25;
+}
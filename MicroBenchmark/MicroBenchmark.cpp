@@ -0,0 +1,678 @@
+/*
+* Micro benchmarks
+*   Cost on the device at hand of the Vulkan primitives the renderer is built on, so that choices like sub-allocating memory,
+*   keeping buffers mapped or batching uploads rest on measurements of the drivers it actually runs on:
+*       - creating and destroying a buffer along with its own memory (createBuffer), by size and memory type
+*       - writing to host visible memory through vkMapMemory/vkUnmapMemory every time, against writing to a persistent mapping
+*       - one copy submitted and waited on with vkQueueWaitIdle, the way copyBuffer uploads
+*       - an empty submit until the fence wakes the waiting thread
+*       - compute pipeline creation without a pipeline cache and with a warm one
+*       - recording push constants and dispatches into a command buffer
+*   Runs headless: no window, no surface, only a queue with graphics and compute. Every result is written as JSON,
+*   to stdout or to the file given with --output.
+*/
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <utility>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock Clock;
+
+//GLSL "layout(local_size_x = 1) in; void main() {}", the smallest compute shader there is: pipeline creation is the fixed cost of the driver
+static const uint32_t EMPTY_COMPUTE_SHADER[] = {
+    0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000,     //header: magic, SPIR-V 1.0, generator, id bound, schema
+    0x00020011, 0x00000001,                                         //OpCapability Shader
+    0x0003000E, 0x00000000, 0x00000001,                             //OpMemoryModel Logical GLSL450
+    0x0005000F, 0x00000005, 0x00000001, 0x6E69616D, 0x00000000,     //OpEntryPoint GLCompute %1 "main"
+    0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001,    //OpExecutionMode %1 LocalSize 1 1 1
+    0x00020013, 0x00000002,                                         //%2 = OpTypeVoid
+    0x00030021, 0x00000003, 0x00000002,                             //%3 = OpTypeFunction %2
+    0x00050036, 0x00000002, 0x00000001, 0x00000000, 0x00000003,     //%1 = OpFunction %2 None %3
+    0x000200F8, 0x00000004,                                         //%4 = OpLabel
+    0x000100FD,                                                     //OpReturn
+    0x00010038                                                      //OpFunctionEnd
+};
+
+/// <summary>
+/// Settings which are picked at startup from the command line
+/// </summary>
+struct BenchmarkOptions {
+    std::string outputFile;         //stdout when empty
+    int deviceIndex = -1;           //the first discrete GPU when negative, or the first device when there is none
+};
+
+class MicroBenchmarks
+{
+public:
+    MicroBenchmarks(const BenchmarkOptions& options) : options(options) {}
+
+    void run();
+
+private:
+    const BenchmarkOptions options;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties deviceProperties{};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    //JSON objects of the results, in the order they were measured
+    std::vector<std::string> results;
+
+    /// <summary>
+    /// Create a headless instance and a device with one queue which does graphics and compute (and so transfers as well)
+    /// </summary>
+    void createDevice();
+    void destroyDevice();
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    /// <summary>
+    /// Buffer with its own allocation, the same as createBuffer of the renderer. Returns the error instead of throwing, large sizes may not fit.
+    /// </summary>
+    VkResult createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory);
+    void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory);
+
+    /// <summary>
+    /// Add a result: the fields naming what was measured, e.g. "\"size\": 4096", followed by the statistics of the samples (microseconds)
+    /// </summary>
+    void addResult(const std::string& benchmark, const std::string& fields, std::vector<double> samples, const std::string& extraFields = "");
+
+    void benchmarkBufferCreation();
+    void benchmarkMapping();
+    void benchmarkCopyRoundTrip();
+    void benchmarkFenceWake();
+    void benchmarkPipelineCreation();
+    void benchmarkCommandRecording();
+
+    VkPipeline createEmptyPipeline(VkShaderModule module, VkPipelineLayout layout, VkPipelineCache cache);
+    void writeResults();
+};
+
+/// <summary>
+/// Microseconds the call took
+/// </summary>
+template <typename Function>
+static double measure(Function&& function) {
+    auto start = Clock::now();
+    function();
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string escaped = "\"";
+    for (char character : text) {
+        if (character == '"' || character == '\\') {
+            escaped += '\\';
+        }
+        escaped += character;
+    }
+    return escaped + "\"";
+}
+
+void MicroBenchmarks::run() {
+    createDevice();
+
+    benchmarkBufferCreation();
+    benchmarkMapping();
+    benchmarkCopyRoundTrip();
+    benchmarkFenceWake();
+    benchmarkPipelineCreation();
+    benchmarkCommandRecording();
+
+    destroyDevice();
+    writeResults();
+}
+
+void MicroBenchmarks::createDevice() {
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Micro Benchmarks";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_1;
+
+    //no validation layers, they would be measured along with the driver
+    VkInstanceCreateInfo instanceInfo{};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance");
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    if (devices.empty()) {
+        throw std::runtime_error("failed to find a GPU with vulkan support");
+    }
+
+    if (options.deviceIndex >= 0) {
+        if (static_cast<size_t>(options.deviceIndex) >= devices.size()) {
+            throw std::runtime_error("there is no device " + std::to_string(options.deviceIndex));
+        }
+        physicalDevice = devices[options.deviceIndex];
+    }
+    else {
+        physicalDevice = devices[0];
+        for (auto candidate : devices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(candidate, &properties);
+            if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+                physicalDevice = candidate;
+                break;
+            }
+        }
+    }
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    bool found = false;
+    for (uint32_t i = 0; i < familyCount; i++) {
+        if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+            queueFamily = i;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        throw std::runtime_error("failed to find a queue family with graphics and compute");
+    }
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo{};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create logical device");
+    }
+    vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+    //same flags as the transfer pool of the renderer, whose command buffers live for a single copy
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool");
+    }
+}
+
+void MicroBenchmarks::destroyDevice() {
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+}
+
+uint32_t MicroBenchmarks::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type");
+}
+
+VkResult MicroBenchmarks::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        return result;
+    }
+
+    return vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+void MicroBenchmarks::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void MicroBenchmarks::addResult(const std::string& benchmark, const std::string& fields, std::vector<double> samples, const std::string& extraFields) {
+    if (samples.empty()) {
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    auto percentile = [&samples](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())))];
+    };
+
+    std::ostringstream result;
+    result.precision(6);
+    result << "{ \"benchmark\": " << jsonString(benchmark);
+    if (!fields.empty()) {
+        result << ", " << fields;
+    }
+    result << ", \"iterations\": " << samples.size()
+        << ", \"mean_us\": " << sum / static_cast<double>(samples.size())
+        << ", \"median_us\": " << percentile(0.5)
+        << ", \"p99_us\": " << percentile(0.99)
+        << ", \"min_us\": " << samples.front()
+        << ", \"max_us\": " << samples.back();
+    if (!extraFields.empty()) {
+        result << ", " << extraFields;
+    }
+    result << " }";
+
+    results.push_back(result.str());
+    std::cerr << result.str() << std::endl;
+}
+
+void MicroBenchmarks::benchmarkBufferCreation() {
+    const VkDeviceSize sizes[] = { 4ull << 10, 64ull << 10, 1ull << 20, 16ull << 20, 64ull << 20, 256ull << 20 };
+    const std::pair<const char*, VkMemoryPropertyFlags> memoryKinds[] = {
+        { "device_local", VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+        { "host_visible", VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT }
+    };
+
+    for (const auto& [memoryName, memoryFlags] : memoryKinds) {
+        for (VkDeviceSize size : sizes) {
+            //fewer rounds of the big ones, each of them may have to clear its memory
+            int iterations = (size >= (64ull << 20)) ? 10 : 100;
+            std::vector<double> createTimes;
+            std::vector<double> destroyTimes;
+
+            for (int i = 0; i < iterations; i++) {
+                VkBuffer buffer;
+                VkDeviceMemory memory;
+                VkResult result = VK_SUCCESS;
+                double createTime = measure([&]() {
+                    result = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, memoryFlags, buffer, memory);
+                });
+                if (result != VK_SUCCESS) {
+                    break;
+                }
+
+                createTimes.push_back(createTime);
+                destroyTimes.push_back(measure([&]() { destroyBuffer(buffer, memory); }));
+            }
+
+            std::string fields = "\"memory\": " + jsonString(memoryName) + ", \"size\": " + std::to_string(size);
+            addResult("create_buffer", fields, createTimes);
+            addResult("destroy_buffer", fields, destroyTimes);
+        }
+    }
+}
+
+void MicroBenchmarks::benchmarkMapping() {
+    const VkDeviceSize sizes[] = { 256, 64ull << 10, 4ull << 20 };
+
+    for (VkDeviceSize size : sizes) {
+        int iterations = (size >= (4ull << 20)) ? 100 : 1000;
+        std::vector<char> source(static_cast<size_t>(size), 1);
+
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        if (createBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            buffer, memory) != VK_SUCCESS) {
+            continue;
+        }
+
+        //how updateUniformBuffer writes the uniform buffer
+        std::vector<double> mapTimes;
+        for (int i = 0; i < iterations; i++) {
+            mapTimes.push_back(measure([&]() {
+                void* data;
+                vkMapMemory(device, memory, 0, size, 0, &data);
+                memcpy(data, source.data(), static_cast<size_t>(size));
+                vkUnmapMemory(device, memory);
+            }));
+        }
+
+        //how the light and HUD buffers are written
+        std::vector<double> persistentTimes;
+        void* mapped;
+        vkMapMemory(device, memory, 0, size, 0, &mapped);
+        for (int i = 0; i < iterations; i++) {
+            persistentTimes.push_back(measure([&]() { memcpy(mapped, source.data(), static_cast<size_t>(size)); }));
+        }
+        vkUnmapMemory(device, memory);
+
+        destroyBuffer(buffer, memory);
+
+        std::string fields = "\"size\": " + std::to_string(size);
+        addResult("map_write_unmap", fields, mapTimes);
+        addResult("persistent_map_write", fields, persistentTimes);
+    }
+}
+
+void MicroBenchmarks::benchmarkCopyRoundTrip() {
+    const VkDeviceSize sizes[] = { 256, 64ull << 10, 1ull << 20, 16ull << 20 };
+    const int iterations = 100;
+
+    for (VkDeviceSize size : sizes) {
+        VkBuffer staging, target;
+        VkDeviceMemory stagingMemory, targetMemory;
+        if (createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            staging, stagingMemory) != VK_SUCCESS) {
+            continue;
+        }
+        if (createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target, targetMemory) != VK_SUCCESS) {
+            destroyBuffer(staging, stagingMemory);
+            continue;
+        }
+
+        //everything copyBuffer does: allocate a command buffer, record the copy, submit it, wait for the queue and free the command buffer
+        std::vector<double> times;
+        for (int i = 0; i < iterations; i++) {
+            times.push_back(measure([&]() {
+                VkCommandBufferAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                allocInfo.commandPool = commandPool;
+                allocInfo.commandBufferCount = 1;
+
+                VkCommandBuffer commandBuffer;
+                vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+                VkBufferCopy copyRegion{};
+                copyRegion.size = size;
+                vkCmdCopyBuffer(commandBuffer, staging, target, 1, &copyRegion);
+                vkEndCommandBuffer(commandBuffer);
+
+                VkSubmitInfo submitInfo{};
+                submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = &commandBuffer;
+                vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+                vkQueueWaitIdle(queue);
+
+                vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+            }));
+        }
+
+        destroyBuffer(target, targetMemory);
+        destroyBuffer(staging, stagingMemory);
+
+        //bandwidth of the median copy, round trip included
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+        std::ostringstream bandwidth;
+        bandwidth << "\"median_gb_per_s\": " << static_cast<double>(size) / (median * 1000.0);
+        addResult("copy_buffer_round_trip", "\"size\": " + std::to_string(size), times, bandwidth.str());
+    }
+}
+
+void MicroBenchmarks::benchmarkFenceWake() {
+    const int iterations = 1000;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create fence");
+    }
+
+    //a submit without command buffers only signals the fence: what is left is the trip through the driver and the wake up of the thread
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        vkResetFences(device, 1, &fence);
+        times.push_back(measure([&]() {
+            vkQueueSubmit(queue, 0, nullptr, fence);
+            vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+        }));
+    }
+
+    vkDestroyFence(device, fence, nullptr);
+    addResult("empty_submit_fence_wake", "", times);
+}
+
+VkPipeline MicroBenchmarks::createEmptyPipeline(VkShaderModule module, VkPipelineLayout layout, VkPipelineCache cache) {
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline");
+    }
+    return pipeline;
+}
+
+void MicroBenchmarks::benchmarkPipelineCreation() {
+    const int iterations = 100;
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = sizeof(EMPTY_COMPUTE_SHADER);
+    moduleInfo.pCode = EMPTY_COMPUTE_SHADER;
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout");
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    VkPipelineCache cache;
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache");
+    }
+    //warm: the pipeline is in the cache before the first measured creation
+    vkDestroyPipeline(device, createEmptyPipeline(module, layout, cache), nullptr);
+
+    std::vector<double> uncachedTimes;
+    std::vector<double> cachedTimes;
+    for (int i = 0; i < iterations; i++) {
+        VkPipeline pipeline;
+        uncachedTimes.push_back(measure([&]() { pipeline = createEmptyPipeline(module, layout, VK_NULL_HANDLE); }));
+        vkDestroyPipeline(device, pipeline, nullptr);
+
+        cachedTimes.push_back(measure([&]() { pipeline = createEmptyPipeline(module, layout, cache); }));
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+
+    vkDestroyPipelineCache(device, cache, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+    vkDestroyShaderModule(device, module, nullptr);
+
+    //drivers keep a cache of their own as well, "none" only tells that the application did not pass one
+    addResult("create_compute_pipeline", "\"cache\": \"none\"", uncachedTimes);
+    addResult("create_compute_pipeline", "\"cache\": \"warm\"", cachedTimes);
+}
+
+void MicroBenchmarks::benchmarkCommandRecording() {
+    const uint32_t commandCounts[] = { 1000, 10000 };
+    const int iterations = 20;
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = sizeof(EMPTY_COMPUTE_SHADER);
+    moduleInfo.pCode = EMPTY_COMPUTE_SHADER;
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+
+    //the size of the per-draw push constants of the scene passes: a model matrix and a cascade index
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.size = 80;
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout");
+    }
+    VkPipeline pipeline = createEmptyPipeline(module, layout, VK_NULL_HANDLE);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+    uint8_t pushConstants[80] = {};
+    for (uint32_t commandCount : commandCounts) {
+        //one command buffer per frame which is reset and recorded again, like the graphics command buffers
+        std::vector<double> times;
+        for (int i = 0; i < iterations; i++) {
+            vkResetCommandBuffer(commandBuffer, 0);
+            times.push_back(measure([&]() {
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+                for (uint32_t command = 0; command < commandCount; command++) {
+                    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), pushConstants);
+                    vkCmdDispatch(commandBuffer, 1, 1, 1);
+                }
+
+                vkEndCommandBuffer(commandBuffer);
+            }));
+        }
+
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+        std::ostringstream throughput;
+        throughput << "\"median_draws_per_ms\": " << static_cast<double>(commandCount) / (median / 1000.0);
+        addResult("record_push_and_dispatch", "\"draws\": " + std::to_string(commandCount), times, throughput.str());
+    }
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+    vkDestroyShaderModule(device, module, nullptr);
+}
+
+void MicroBenchmarks::writeResults() {
+    std::ostringstream json;
+    json << "{\n  \"device\": { \"name\": " << jsonString(deviceProperties.deviceName)
+        << ", \"vendor_id\": " << deviceProperties.vendorID
+        << ", \"device_id\": " << deviceProperties.deviceID
+        << ", \"driver_version\": " << deviceProperties.driverVersion
+        << ", \"api_version\": \"" << VK_VERSION_MAJOR(deviceProperties.apiVersion) << "." << VK_VERSION_MINOR(deviceProperties.apiVersion)
+        << "." << VK_VERSION_PATCH(deviceProperties.apiVersion) << "\" },\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        json << "    " << results[i] << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+
+    if (options.outputFile.empty()) {
+        std::cout << json.str();
+        return;
+    }
+
+    std::ofstream file(options.outputFile, std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("failed to open " + options.outputFile);
+    }
+    file << json.str();
+}
+
+/// <summary>
+/// Read the settings from the command line arguments
+/// </summary>
+static BenchmarkOptions parseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--output") {
+            options.outputFile = nextValue();
+        }
+        else if (arg == "--device") {
+            options.deviceIndex = std::stoi(nextValue());
+        }
+        else {
+            throw std::runtime_error("unknown argument " + arg);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        MicroBenchmarks benchmarks(parseOptions(argc, argv));
+        benchmarks.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}